@@ -21,6 +21,7 @@
 
 #include <descartes_core/trajectory_pt.h>
 #include <descartes_core/robot_model.h>
+#include <chrono>
 #include <vector>
 
 namespace descartes_core
@@ -84,6 +85,18 @@ public:
    */
   virtual bool planPath(const std::vector<TrajectoryPtPtr>& traj) = 0;
 
+  /**
+   * @brief Generates a robot path from the trajectory, giving up with PLANNING_TIMEOUT once 'deadline' has passed.
+   *        Planners that can't be interrupted ignore the deadline and plan the whole path.
+   * @param traj the points used to plan the robot path
+   * @param deadline the time by which planning must finish
+   */
+  virtual bool planPath(const std::vector<TrajectoryPtPtr>& traj, std::chrono::steady_clock::time_point deadline)
+  {
+    (void)deadline;
+    return planPath(traj);
+  }
+
   /**
    * @brief Returns the last robot path generated from the input trajectory
    * @param path Array that contains the points in the robot path
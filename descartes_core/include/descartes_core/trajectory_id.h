@@ -19,6 +19,7 @@
 #ifndef TRAJECTORY_ID_H
 #define TRAJECTORY_ID_H
 
+#include <functional>
 #include <iostream>
 
 #include <boost/thread/mutex.hpp>
@@ -165,4 +166,19 @@ typedef TrajectoryID_<uint64_t> TrajectoryID;
 
 }  // end namespace descartes_core
 
+namespace std
+{
+/**
+ * @brief Allows TrajectoryIDs as keys of unordered containers
+ */
+template <typename T>
+struct hash<descartes_core::TrajectoryID_<T>>
+{
+  std::size_t operator()(descartes_core::TrajectoryID_<T> id) const noexcept
+  {
+    return std::hash<T>()(id.value());
+  }
+};
+}  // end namespace std
+
 #endif
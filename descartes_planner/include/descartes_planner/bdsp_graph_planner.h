@@ -8,9 +8,11 @@
 #ifndef INCLUDE_DESCARTES_PLANNER_GRAPH_SOLVER_H_
 #define INCLUDE_DESCARTES_PLANNER_GRAPH_SOLVER_H_
 
+#include <chrono>
 #include <memory>
 #include <boost/graph/adjacency_list.hpp>
 #include "descartes_planner/common.h"
+#include "descartes_planner/task_pool.h"
 namespace descartes_planner
 {
 
@@ -74,9 +76,20 @@ private:
   std::vector<typename PointSampleGroup<FloatT>::Ptr> sample_groups_;
 };
 
+/**
+ * @brief The graph representations BDSPGraphPlanner can search
+ */
+enum class BDSPBackend
+{
+  BOOST_DIJKSTRA, /** @brief a boost::adjacency_list searched with dijkstra_shortest_paths_no_color_map */
+  LAYERED_DAG     /** @brief the edges between each pair of consecutive points in flat arrays, searched in a single
+                             sweep from the first point to the last */
+};
+
 /**
  * @class descartes_planner::BDSPGraphPlanner
- * @brief Planner implementation that uses the dijkstra shortest path algorithm from the boost library *
+ * @brief Planner implementation that uses the dijkstra shortest path algorithm from the boost library, or a sweep
+ *        through the points in order since each sample only connects to the samples of the next point *
  * @tparam FloatT Use float or double
  *
  */
@@ -90,9 +103,11 @@ public:
    * @param container       The container implementation to use, pass nullptr to use default.
    * @param report_failures Whether or not to report failed points and edges.  Use getFailedPoints and getFailedEdges in
    *                        order to get the indices where the planner failed.
+   * @param backend         The graph representation to build and search. Both find paths of the same cost; the layered
+   *                        one uses less memory and needs no priority queue.
    */
   BDSPGraphPlanner(typename std::shared_ptr< SamplesContainer<FloatT> > container = std::make_shared< DefaultSamplesContainer<FloatT> >(),
-                   bool report_all_failures = false);
+                   bool report_all_failures = false, BDSPBackend backend = BDSPBackend::BOOST_DIJKSTRA);
 
   virtual ~BDSPGraphPlanner();
 
@@ -114,6 +129,19 @@ public:
   bool build(std::vector< typename PointSampler<FloatT>::Ptr >& points,
              std::vector<typename EdgeEvaluator<FloatT>::ConstPtr>& edge_evaluators);
 
+  /**
+   * @brief Builds the graph, giving up once 'deadline' has passed. It is checked before generating the samples of
+   *        each point and evaluating the edges of each pair of points, see timedOut().
+   * @return True on success false otherwise
+   */
+  bool build(std::vector< typename PointSampler<FloatT>::Ptr >& points,
+             typename EdgeEvaluator<FloatT>::ConstPtr edge_evaluator,
+             std::chrono::steady_clock::time_point deadline);
+
+  bool build(std::vector< typename PointSampler<FloatT>::Ptr >& points,
+             std::vector<typename EdgeEvaluator<FloatT>::ConstPtr>& edge_evaluators,
+             std::chrono::steady_clock::time_point deadline);
+
   /**
    * @brief solves the plan by searching for the lowest cost solution, use only after calling the build method
    * @param solution_points  The solution
@@ -121,18 +149,46 @@ public:
    */
   bool solve(std::vector< typename PointData<FloatT>::ConstPtr >& solution_points);
 
+  /**
+   * @brief solves the plan, giving up once 'deadline' has passed. The search checks it every few hundred vertices,
+   *        see timedOut().
+   * @param solution_points  The solution
+   * @return True on success, false otherwise
+   */
+  bool solve(std::vector< typename PointData<FloatT>::ConstPtr >& solution_points,
+             std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * @brief Whether the last build or solve failed because its deadline passed, which the planners report as
+   *        PLANNING_TIMEOUT
+   */
+  bool timedOut() const { return timed_out_; }
+
+  /**
+   * @brief Generates the samples of the points and evaluates the edges between them on the threads of 'pool', or on
+   *        the calling thread if it is null (the default). The samplers then generate through their clone() for
+   *        each worker, see PointSampler::clone(). The edge evaluators are called concurrently and must not share
+   *        mutable state, and they aren't given the source samples left disconnected by the previous segment: their
+   *        edges are filtered out afterwards. The failures reported are the same either way.
+   */
+  void setTaskPool(std::shared_ptr<TaskPool> pool) { task_pool_ = std::move(pool); }
+
   void getFailedEdges(std::vector<std::size_t>& failed_edges);
   void getFailedPoints(std::vector<std::size_t>& failed_points);
 
   std::shared_ptr< const SamplesContainer<FloatT> > getContainer() const;
 
+  BDSPBackend getBackend() const { return backend_; }
+
 private:
 
   typename EdgeEvaluator<FloatT>::ConstPtr getEdgeEvaluator(std::uint32_t idx);
 
-  std::vector< EdgeProperties<FloatT> > filterDisconnectedEdges(const std::vector< EdgeProperties<FloatT> >& edges,
-                                                                const std::map<std::size_t, VertexProperties>& connected_src_vertices,
-                                                                std::uint32_t current_vertex_count) const;
+  /**
+   * @brief removes the edges leaving the source samples that aren't flagged in 'connected_src_samples'
+   */
+  void filterDisconnectedEdges(std::vector< CompactEdge<FloatT> >& edges,
+                               const std::vector<bool>& connected_src_samples) const;
 
   void setup(std::vector< typename PointSampler<FloatT>::Ptr >& points,
              std::vector<typename EdgeEvaluator<FloatT>::ConstPtr>& edge_evaluators);
@@ -142,19 +198,26 @@ private:
                                 boost::vecS,                  /** @brief vertex_container */
                                 boost::directedS,             /** @brief allows and out_edge only */
                                 VertexProperties,     /** @brief vertex structure */
-                                EdgeProperties<FloatT>        /** @brief edge structure */
+                                CompactEdge<FloatT>           /** @brief edge structure */
                                 > GraphT;
 
   void writeGraphLogs(const std::vector<FloatT>& weights,
                     const std::vector<typename GraphT::vertex_descriptor>& predecessors);
 
+  bool solveLayers(std::vector< typename PointData<FloatT>::ConstPtr >& solution_points,
+                   std::chrono::steady_clock::time_point deadline);
+
   GraphT graph_;
+  std::vector< std::vector< CompactEdge<FloatT> > > layers_; /** @brief the edges from each point to the next one */
   std::vector< typename PointSampler<FloatT>::Ptr > points_;
   std::vector< typename EdgeEvaluator<FloatT>::ConstPtr > edge_evaluators_;
-  std::map<std::size_t, VertexProperties> end_vertices_;
+  std::vector<std::size_t> end_vertices_; /** @brief the vertices of the last point's samples reached, in order */
   typename std::shared_ptr< SamplesContainer<FloatT> > container_;
+  std::shared_ptr<TaskPool> task_pool_;
 
   bool report_all_failures_;
+  BDSPBackend backend_;
+  bool timed_out_ = false;
   std::vector<std::size_t> failed_points_;
   std::vector<std::size_t> failed_edges_;
 
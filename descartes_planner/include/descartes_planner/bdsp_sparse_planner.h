@@ -43,6 +43,7 @@ class BDSPSparsePlanner
     std::size_t max_resampling_attempts = 10;   /**@brief Number of resampling attemps whenever an edge or closest sample search failure is encountered */
     std::size_t num_resample_points_before = 2; /**@brief Number of points before failed edge points to resample */
     std::size_t num_resample_points_after = 2;  /**@brief Number of points after failed edge points to resample */
+    BDSPBackend backend = BDSPBackend::BOOST_DIJKSTRA; /**@brief The graph representation of the underlying graph planners */
   };
 
 public:
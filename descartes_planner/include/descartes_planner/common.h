@@ -12,6 +12,8 @@
 
 #include <memory>
 
+#include <cstdint>
+
 #include <console_bridge/console.h>
 
 namespace descartes_planner
@@ -82,6 +84,11 @@ namespace descartes_planner
    * @class descartes_planner::PointSampler
    * @brief the base class for trajectory point samples,  actual implementations should
    * know the details of the robot such as ik solvers, joint limits, dofs, etc
+   *
+   * When BDSPGraphPlanner is given a TaskPool, the samplers of different points generate their samples at the same
+   * time, each through the sampler clone() returns for the worker thread running it. Samplers whose generate() is
+   * reentrant need not override clone(); those that share a non-reentrant resource, such as an IK solver, should
+   * return a sampler for the same point bound to a copy of the resource kept for that worker.
    */
   template <typename FloatT = float>
   class PointSampler
@@ -95,6 +102,20 @@ namespace descartes_planner
      */
     virtual typename PointSampleGroup<FloatT>::Ptr generate() = 0;
 
+    /**
+     * @brief returns a sampler for the same point to generate its samples on the worker thread 'worker'. The planner
+     *        calls it from that worker and never runs two samplers cloned for the same worker at the same time, so
+     *        they may share per worker state. Only the clones run concurrently, this sampler is left untouched.
+     * @param worker  The worker index, in [0, TaskPool::threads())
+     * @return  The clone, or nullptr (the default) if generate() may be called on this sampler concurrently with the
+     *          generate() of any other sampler
+     */
+    virtual std::shared_ptr<PointSampler<FloatT> > clone(std::size_t worker) const
+    {
+      (void)worker;
+      return nullptr;
+    }
+
     /**
      * @brief method used by the sparse planner, gets the closets samples to the requested point
      * @param ref_point  The requested point
@@ -172,6 +193,23 @@ namespace descartes_planner
     VertexProperties dst_vtx;
   };
 
+  /**
+   * @brief a valid edge between two consecutive points, the ones it connects being implied by where it is stored
+   */
+  template <typename FloatT = float>
+  struct CompactEdge
+  {
+    std::uint32_t src;  /** sample index in the source point */
+    std::uint32_t dst;  /** sample index in the destination point */
+    FloatT weight;
+  };
+
+  /**
+   * @class descartes_planner::EdgeEvaluator
+   * @brief computes the edges between the samples of two consecutive points. Implementations override either
+   * evaluate() or evaluateCompact(), each one's default is written in terms of the other. BDSPGraphPlanner only calls
+   * evaluateCompact(), so overriding it saves making an EdgeProperties for every pair of samples.
+   */
   template <typename FloatT = float>
   class EdgeEvaluator
   {
@@ -185,12 +223,63 @@ namespace descartes_planner
      * @param s2  A point sample group with n2 samples
      * @param exclude_s1 list of indices in sample group 1 to exclude from the evaluation
      * @param exclude_s2 list of indices in sample group 2 to exclude from the evaluation
-     * @return  Returns a n1 x n2 vector of EdgeProperties objects
+     * @return  Returns a n1 x n2 vector of EdgeProperties objects. The default only returns the valid edges
+     *          evaluateCompact() finds, and none if it fails.
      */
     virtual std::vector< EdgeProperties<FloatT> > evaluate(typename PointSampleGroup<FloatT>::ConstPtr s1,
                                                             typename PointSampleGroup<FloatT>::ConstPtr s2,
                                                             const std::vector<std::size_t>& exclude_s1 = {},
-                                                            const std::vector<std::size_t>& exclude_s2 = {}) const = 0;
+                                                            const std::vector<std::size_t>& exclude_s2 = {}) const
+    {
+      std::vector< CompactEdge<FloatT> > compact_edges;
+      std::vector< EdgeProperties<FloatT> > edges;
+      if(!evaluateCompact(s1, s2, exclude_s1, compact_edges))
+      {
+        return edges;
+      }
+      edges.resize(compact_edges.size());
+      for(std::size_t i = 0; i < compact_edges.size(); i++)
+      {
+        edges[i].weight = compact_edges[i].weight;
+        edges[i].valid = true;
+        edges[i].src_vtx.point_id = s1->point_id;
+        edges[i].src_vtx.sample_index = compact_edges[i].src;
+        edges[i].dst_vtx.point_id = s2->point_id;
+        edges[i].dst_vtx.sample_index = compact_edges[i].dst;
+      }
+      return edges;
+    }
+
+    /**
+     * @brief appends the valid edges between the samples of s1 and s2 to 'edges', the invalid ones are left out.
+     * @param s1  A point sample group with n1 samples
+     * @param s2  A point sample group with n2 samples
+     * @param exclude_s1 list of indices in sample group 1 whose edges may be left out
+     * @param edges The valid edges, which may be none. It is cleared first.
+     * @return  False if the evaluation failed. The default calls evaluate() and keeps its valid edges.
+     * @note BDSPGraphPlanner calls this concurrently for different pairs of points when it is given a TaskPool
+     */
+    virtual bool evaluateCompact(typename PointSampleGroup<FloatT>::ConstPtr s1,
+                                 typename PointSampleGroup<FloatT>::ConstPtr s2,
+                                 const std::vector<std::size_t>& exclude_s1,
+                                 std::vector< CompactEdge<FloatT> >& edges) const
+    {
+      edges.clear();
+      std::vector< EdgeProperties<FloatT> > all_edges = evaluate(s1, s2, exclude_s1, {});
+      if(all_edges.empty())
+      {
+        return false;
+      }
+      for(const EdgeProperties<FloatT>& edge : all_edges)
+      {
+        if(edge.valid)
+        {
+          edges.push_back({static_cast<std::uint32_t>(edge.src_vtx.sample_index),
+                           static_cast<std::uint32_t>(edge.dst_vtx.sample_index), edge.weight});
+        }
+      }
+      return true;
+    }
 
     typedef typename std::shared_ptr<EdgeEvaluator> Ptr;
     typedef typename std::shared_ptr<const EdgeEvaluator> ConstPtr;
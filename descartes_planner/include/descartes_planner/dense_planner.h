@@ -34,9 +34,28 @@ public:
   virtual bool initialize(descartes_core::RobotModelConstPtr model);
   virtual bool initialize(descartes_core::RobotModelConstPtr model,
                           descartes_planner::CostFunction cost_function_callback);
+  virtual bool initialize(descartes_core::RobotModelConstPtr model,
+                          descartes_planner::BatchCostFunction cost_function_callback);
+  /**
+   * @brief Supported parameters:
+   *        "search_threads": threads used to search the planning graph, see PlanningGraph::setSearchThreads (1)
+   *        "implicit_edges": 1 to evaluate edges during the search, see PlanningGraph::setImplicitEdges (0)
+   *        "beam_width": vertices kept per rung by a pruned search, see PlanningGraph::setBeam, 0 for all (0)
+   *        "beam_cost_ratio": prunes vertices costing more than this multiple of the rung's cheapest, >= 1 or 0 (0)
+   *        "beam_validation": 1 to compare pruned searches with exact ones, see PlanningGraph::getBeamSearchStats (0)
+   *        "threads": threads computing IK and edges, see PlanningGraph::setTaskPool, 0 for one per hardware thread (0)
+   *        "thread_affinity": CPUs to pin those threads to, such as "0,2,4-7", empty for no pinning ("")
+   *        "max_out_edges": edges kept per vertex of untimed rungs, see PlanningGraph::setMaxOutEdges, 0 for all (0)
+   */
   virtual bool setConfig(const descartes_core::PlannerConfig& config);
   virtual void getConfig(descartes_core::PlannerConfig& config) const;
   virtual bool planPath(const std::vector<descartes_core::TrajectoryPtPtr>& traj);
+  /**
+   * @brief Plans as above, giving up with PLANNING_TIMEOUT once 'deadline' has passed. IK, edges and the search
+   *        check it before each point or rung, so planning overruns it by about the time one of them takes.
+   */
+  virtual bool planPath(const std::vector<descartes_core::TrajectoryPtPtr>& traj,
+                        std::chrono::steady_clock::time_point deadline);
   virtual bool getPath(std::vector<descartes_core::TrajectoryPtPtr>& path) const;
   virtual bool addAfter(const descartes_core::TrajectoryPt::ID& ref_id, descartes_core::TrajectoryPtPtr tp);
   virtual bool addBefore(const descartes_core::TrajectoryPt::ID& ref_id, descartes_core::TrajectoryPtPtr tp);
@@ -56,10 +75,17 @@ protected:
   descartes_core::TrajectoryPt::ID getPrevious(const descartes_core::TrajectoryPt::ID& ref_id);
   descartes_core::TrajectoryPt::ID getNext(const descartes_core::TrajectoryPt::ID& ref_id);
   descartes_core::TrajectoryPtPtr get(const descartes_core::TrajectoryPt::ID& ref_id);
-  bool updatePath();
+  bool updatePath(const CancellationToken& cancel = CancellationToken());
+
+  /** @brief Builds the graph of 'traj' and searches it, stopping when 'cancel' is cancelled */
+  bool plan(const std::vector<descartes_core::TrajectoryPtPtr>& traj, const CancellationToken& cancel);
+
+  /** @brief Pushes the configuration parameters down to the planning graph */
+  void applyConfig();
 
 protected:
   boost::shared_ptr<descartes_planner::PlanningGraph> planning_graph_;
+  std::shared_ptr<TaskPool> task_pool_;
   int error_code_;
   descartes_core::PlannerConfig config_;
   std::vector<descartes_core::TrajectoryPtPtr> path_;
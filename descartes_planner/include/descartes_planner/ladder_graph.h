@@ -20,7 +20,13 @@
 #define DESCARTES_LADDER_GRAPH_H
 
 #include "descartes_core/trajectory_id.h"
+#include "descartes_planner/trajectory_index.h"
 #include "descartes_core/trajectory_timing_constraint.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <vector>
 
 namespace descartes_planner
 {
@@ -31,26 +37,362 @@ struct __attribute__ ((__packed__)) Edge
   unsigned idx; // from THIS rung to 'idx' into the NEXT rung
 };
 
-struct Rung
+/**
+ * @brief RungEdges stores every out-edge of a rung in compressed-sparse-row (CSR) form: one contiguous
+ *        array of edges and one array of offsets into it. The out-edges of vertex 'i' are the range
+ *        [offsets[i], offsets[i + 1]) of the edge array. Edges are appended one vertex at a time with
+ *        push_back() followed by closeVertex().
+ */
+class RungEdges
 {
-  using EdgeList = std::vector<Edge>;
+public:
+  using size_type = std::size_t;
+
+  /**
+   * @brief A light-weight view of the out-edges of a single vertex
+   */
+  class Range
+  {
+  public:
+    Range(const Edge* first, const Edge* last) noexcept : first_(first), last_(last) {}
+
+    const Edge* begin() const noexcept { return first_; }
+    const Edge* end() const noexcept { return last_; }
+    size_type size() const noexcept { return static_cast<size_type>(last_ - first_); }
+    bool empty() const noexcept { return first_ == last_; }
+
+  private:
+    const Edge* first_;
+    const Edge* last_;
+  };
+
+  RungEdges()
+    : offsets_(1, 0u)
+    , dense_targets_(0)
+  {}
+
+  /**
+   * @brief reserve Pre-allocates space for 'n_vertices' source vertices with a total of 'n_edges' edges
+   */
+  void reserve(size_type n_vertices, size_type n_edges)
+  {
+    offsets_.reserve(n_vertices + 1);
+    edges_.reserve(n_edges);
+  }
+
+  /**
+   * @brief resize Discards all edges and sets the number of source vertices to 'n_vertices', each of them
+   *        with no out-edges.
+   */
+  void resize(size_type n_vertices)
+  {
+    offsets_.assign(n_vertices + 1, 0u);
+    edges_.clear();
+    dense_targets_ = 0;
+  }
+
+  /**
+   * @brief clear Discards all vertices and edges
+   */
+  void clear()
+  {
+    resize(0);
+  }
+
+  /**
+   * @brief shrink_to_fit Releases any capacity reserved beyond the edges actually stored
+   */
+  void shrink_to_fit()
+  {
+    offsets_.shrink_to_fit();
+    edges_.shrink_to_fit();
+  }
+
+  /**
+   * @brief push_back Appends an out-edge to the vertex currently being built
+   */
+  void push_back(const Edge& edge)
+  {
+    edges_.push_back(edge);
+  }
+
+  /**
+   * @brief closeVertex Finishes the vertex currently being built; subsequent edges belong to the next vertex
+   */
+  void closeVertex()
+  {
+    assert(edges_.size() <= std::numeric_limits<unsigned>::max());
+    offsets_.push_back(static_cast<unsigned>(edges_.size()));
+  }
+
+  /**
+   * @brief insertEdges Adds out-edges to vertices that have already been closed, after their other edges. The
+   *        edges are given as (source vertex, edge) pairs sorted by source. Clears the dense targets.
+   */
+  void insertEdges(const std::vector<std::pair<unsigned, Edge>>& edges)
+  {
+    if (edges.empty()) return;
+
+    std::vector<Edge> merged;
+    merged.reserve(edges_.size() + edges.size());
+    auto added = edges.begin();
+    unsigned begin = offsets_[0];
+    for (size_type v = 0; v < numVertices(); ++v)
+    {
+      const unsigned end = offsets_[v + 1];
+      merged.insert(merged.end(), edges_.begin() + begin, edges_.begin() + end);
+      for (; added != edges.end() && added->first == v; ++added)
+        merged.push_back(added->second);
+      offsets_[v + 1] = static_cast<unsigned>(merged.size());
+      begin = end;
+    }
+    assert(added == edges.end());
+
+    edges_.swap(merged);
+    dense_targets_ = 0;
+  }
+
+  /**
+   * @brief operator [] returns the out-edges of the vertex with the given index
+   */
+  Range operator[](size_type vertex) const noexcept
+  {
+    assert(vertex + 1 < offsets_.size());
+    return Range(edges_.data() + offsets_[vertex], edges_.data() + offsets_[vertex + 1]);
+  }
+
+  /**
+   * @brief numVertices The number of source vertices whose edges have been closed
+   */
+  size_type numVertices() const noexcept
+  {
+    return offsets_.size() - 1;
+  }
+
+  /**
+   * @brief numEdges The total number of edges stored for all vertices
+   */
+  size_type numEdges() const noexcept
+  {
+    return edges_.size();
+  }
+
+  bool empty() const noexcept
+  {
+    return edges_.empty();
+  }
+
+  /**
+   * @brief setDenseTargets Declares that every source vertex connects to all 'n_targets' vertices of the next rung,
+   *        with its edges pushed in target order. The edges then form a row-major matrix that DAGSearch relaxes
+   *        with a vectorized kernel. Pass 0 to clear; resize() and clear() also reset it.
+   */
+  void setDenseTargets(size_type n_targets) noexcept
+  {
+    dense_targets_ = n_targets;
+  }
+
+  /**
+   * @brief denseTargets The number of targets declared with setDenseTargets(), 0 if the edges are sparse
+   */
+  size_type denseTargets() const noexcept
+  {
+    return dense_targets_;
+  }
+
+  /**
+   * @brief memoryUsage The number of bytes currently allocated by this edge list
+   */
+  size_type memoryUsage() const noexcept
+  {
+    return offsets_.capacity() * sizeof(unsigned) + edges_.capacity() * sizeof(Edge);
+  }
+
+  const std::vector<unsigned>& offsets() const noexcept { return offsets_; }
+  const std::vector<Edge>& edges() const noexcept { return edges_; }
 
+private:
+  std::vector<unsigned> offsets_; // size numVertices() + 1, offsets_[0] == 0
+  std::vector<Edge> edges_; // out-edges of every vertex, stored back to back
+  size_type dense_targets_; // if non-zero, edges_ is a numVertices() x dense_targets_ matrix
+};
+
+struct Rung
+{
   descartes_core::TrajectoryID id; // corresponds to user's input ID
   descartes_core::TimingConstraint timing; // user input timing
   std::vector<double> data; // joint values stored in one contiguous array
-  std::vector<EdgeList> edges;
+  RungEdges edges; // out-edges of every vertex in this rung, stored in CSR form
+};
+
+/**
+ * @brief RungSequence is a gap buffer of individually allocated rungs. Inserting or erasing a rung moves the gap to
+ *        it and then takes or frees a single slot, so a series of edits at nearby positions, as a replanning sparse
+ *        planner makes, costs O(distance between them). Only the rung pointers move; a rung itself never moves, so
+ *        references to it stay valid until it is erased. Random access costs one comparison on top of a vector's.
+ */
+class RungSequence
+{
+public:
+  using size_type = std::size_t;
+
+  RungSequence() noexcept : gap_begin_(0), gap_end_(0) {}
+
+  RungSequence(const RungSequence& other) : RungSequence()
+  {
+    *this = other;
+  }
+
+  RungSequence(RungSequence&& other) noexcept : RungSequence()
+  {
+    swap(other);
+  }
+
+  RungSequence& operator=(const RungSequence& other)
+  {
+    if (this == &other) return *this;
+
+    std::vector<std::unique_ptr<Rung>> slots(other.size());
+    for (size_type i = 0; i < slots.size(); ++i)
+      slots[i].reset(new Rung(other[i]));
+    slots_.swap(slots);
+    gap_begin_ = gap_end_ = slots_.size();
+    return *this;
+  }
+
+  RungSequence& operator=(RungSequence&& other) noexcept
+  {
+    clear();
+    swap(other);
+    return *this;
+  }
+
+  void swap(RungSequence& other) noexcept
+  {
+    slots_.swap(other.slots_);
+    std::swap(gap_begin_, other.gap_begin_);
+    std::swap(gap_end_, other.gap_end_);
+  }
+
+  Rung& operator[](size_type index) noexcept
+  {
+    assert(index < size());
+    return *slots_[index < gap_begin_ ? index : index + (gap_end_ - gap_begin_)];
+  }
+
+  const Rung& operator[](size_type index) const noexcept
+  {
+    assert(index < size());
+    return *slots_[index < gap_begin_ ? index : index + (gap_end_ - gap_begin_)];
+  }
+
+  size_type size() const noexcept
+  {
+    return slots_.size() - (gap_end_ - gap_begin_);
+  }
+
+  bool empty() const noexcept
+  {
+    return size() == 0;
+  }
+
+  /**
+   * @brief insert Adds an empty rung at 'index', shifting the following ones
+   */
+  void insert(size_type index)
+  {
+    assert(index <= size());
+    if (gap_begin_ == gap_end_) grow(slots_.size() + 1);
+    moveGap(index);
+    slots_[gap_begin_++].reset(new Rung());
+  }
+
+  /**
+   * @brief erase Destroys the rung at 'index', shifting the following ones
+   */
+  void erase(size_type index)
+  {
+    assert(index < size());
+    moveGap(index);
+    slots_[gap_end_++].reset();
+  }
+
+  /**
+   * @brief resize Appends empty rungs or destroys the last ones
+   */
+  void resize(size_type n)
+  {
+    moveGap(size());
+    if (n < gap_begin_)
+    {
+      std::for_each(slots_.begin() + n, slots_.begin() + gap_begin_, [](std::unique_ptr<Rung>& r) { r.reset(); });
+      gap_begin_ = n;
+      return;
+    }
+
+    if (n > gap_begin_ + (gap_end_ - gap_begin_)) grow(n);
+    while (gap_begin_ < n)
+      slots_[gap_begin_++].reset(new Rung());
+  }
+
+  void clear() noexcept
+  {
+    slots_.clear();
+    gap_begin_ = gap_end_ = 0;
+  }
+
+private:
+  /**
+   * @brief moveGap Shifts the rungs between the gap and 'index' to the other side of it, so that it starts at 'index'
+   */
+  void moveGap(size_type index)
+  {
+    if (index < gap_begin_)
+    {
+      const auto n = gap_begin_ - index;
+      std::move_backward(slots_.begin() + index, slots_.begin() + gap_begin_, slots_.begin() + gap_end_);
+      gap_begin_ -= n;
+      gap_end_ -= n;
+    }
+    else if (index > gap_begin_)
+    {
+      const auto n = index - gap_begin_;
+      std::move(slots_.begin() + gap_end_, slots_.begin() + gap_end_ + n, slots_.begin() + gap_begin_);
+      gap_begin_ += n;
+      gap_end_ += n;
+    }
+  }
+
+  /**
+   * @brief grow Reallocates the slots so that at least 'n_rungs' fit, doubling the capacity to amortize growth
+   */
+  void grow(size_type n_rungs)
+  {
+    const auto n_after = slots_.size() - gap_end_;
+    const auto n_slots = std::max(n_rungs, 2 * slots_.size());
+
+    std::vector<std::unique_ptr<Rung>> slots(n_slots);
+    std::move(slots_.begin(), slots_.begin() + gap_begin_, slots.begin());
+    std::move(slots_.begin() + gap_end_, slots_.end(), slots.end() - n_after);
+    slots_.swap(slots);
+    gap_end_ = n_slots - n_after;
+  }
+
+  std::vector<std::unique_ptr<Rung>> slots_; // the rungs, with a gap of empty slots [gap_begin_, gap_end_)
+  size_type gap_begin_;
+  size_type gap_end_;
 };
 
 /**
  * @brief LadderGraph is an adjacency list based, directed graph structure with vertices
  *        arranged into "rungs" which have connections only to vertices in the adjacent
- *        rungs. Assumes a fixed DOF.
+ *        rungs. Assumes a fixed DOF. References to rungs returned by getRung() stay valid
+ *        while other rungs are inserted or removed.
  */
 class LadderGraph
 {
 public:
   using size_type = std::size_t;
-  using EdgeList = Rung::EdgeList;
 
   /**
    * @brief LadderGraph
@@ -68,6 +410,7 @@ public:
    */
   void resize(size_type n_rungs)
   {
+    id_index_.invalidateFrom(n_rungs);
     rungs_.resize(n_rungs);
   }
 
@@ -82,12 +425,12 @@ public:
     return rungs_[index];
   }
 
-  std::vector<EdgeList>& getEdges(size_type index) noexcept // see p.23 Effective C++ (Scott Meyers)
+  RungEdges& getEdges(size_type index) noexcept // see p.23 Effective C++ (Scott Meyers)
   {
-    return const_cast<std::vector<EdgeList>&>(static_cast<const LadderGraph&>(*this).getEdges(index));
+    return const_cast<RungEdges&>(static_cast<const LadderGraph&>(*this).getEdges(index));
   }
 
-  const std::vector<EdgeList>& getEdges(size_type index) const noexcept
+  const RungEdges& getEdges(size_type index) const noexcept
   {
     assert(index < rungs_.size());
     return rungs_[index].edges;
@@ -104,25 +447,20 @@ public:
   size_type numVertices() const noexcept
   {
     size_type count = 0; // Add the size of each rung d
-    for (const auto& rung : rungs_) count += (rung.data.size() / dof_);
+    for (size_type i = 0; i < rungs_.size(); ++i) count += (rungs_[i].data.size() / dof_);
     return count;
   }
 
   /**
    * @brief indexOf returns a pair describing whether the given ID is in the graph and if so, what
-   *        index it has.
+   *        index it has. Looks the ID up in an index kept in sync by insertRung(), removeRung() and assignRung(),
+   *        so it only finds rung IDs set through assignRung(). Not safe to call concurrently.
    * @param id The ID to
    * @return std::pair(index, was_found)
    */
-  std::pair<size_type, bool> indexOf(descartes_core::TrajectoryID id) const noexcept
+  std::pair<size_type, bool> indexOf(descartes_core::TrajectoryID id) const
   {
-    auto it = std::find_if(rungs_.cbegin(), rungs_.cend(), [id] (const Rung& r) {
-      return id == r.id;
-    });
-    if (it == rungs_.cend())
-      return {0u, false};
-    else
-      return {static_cast<size_type>(std::distance(rungs_.cbegin(), it)), true};
+    return id_index_.find(id, rungs_.size(), [this](size_type i) { return rungs_[i].id; });
   }
 
   /**
@@ -166,14 +504,16 @@ public:
   /**
    * @brief assign Consumes the given edge list and assigns it to the rung-index given by 'rung'
    */
-  void assignEdges(size_type rung, std::vector<EdgeList>&& edges) // noexcept?
+  void assignEdges(size_type rung, RungEdges&& edges) // noexcept?
   {
     getEdges(rung) = std::move(edges);
+    // Builders reserve for the worst case; the graph may hold on to these edges for a long time
+    getEdges(rung).shrink_to_fit();
   }
 
   /**
    * @brief assignRung Special helper function to assign a solution set associated with a Descartes point &
-   *        it's meta-info. Also resizes the associated edge list to the size of 'sols'.
+   *        it's meta-info. Also resets the associated edge list to 'sols.size()' vertices without edges.
    * @param sols All of the joint solutions for this point.
    */
   void assignRung(size_type index, descartes_core::TrajectoryID id, descartes_core::TimingConstraint time,
@@ -181,19 +521,33 @@ public:
   {
     Rung& r = getRung(index);
     r.id = id;
+    id_index_.assign(index, id);
     r.timing = time;
+    assignVertices(index, sols);
+  }
+
+  /**
+   * @brief assignVertices Replaces the joint solutions of a rung, keeping its ID & timing, and resets its edge list
+   *        to 'sols.size()' vertices without edges. Only touches rung 'index', so different rungs may be assigned
+   *        concurrently.
+   */
+  void assignVertices(size_type index, const std::vector<std::vector<double>>& sols)
+  {
+    Rung& r = getRung(index);
+    r.data.clear();
     r.data.reserve(sols.size() * dof_);
     for (const auto& sol : sols)
     {
       r.data.insert(r.data.end(), sol.cbegin(), sol.cend());
     }
-    // Given this new vertex set, build an edge list for each
-    getEdges(index).resize(r.data.size());
+    // Given this new vertex set, start each vertex with an empty out-edge list
+    r.edges.resize(sols.size());
   }
 
   void removeRung(size_type index)
   {
-    rungs_.erase(std::next(rungs_.begin(), index));
+    rungs_.erase(index);
+    id_index_.invalidateFrom(index);
   }
 
   void clearVertices(size_type index)
@@ -212,7 +566,8 @@ public:
    */
   void insertRung(size_type index)
   {
-    rungs_.insert(std::next(rungs_.begin(), index), Rung() );
+    rungs_.insert(index);
+    id_index_.invalidateFrom(index);
   }
 
   /**
@@ -221,11 +576,13 @@ public:
   void clear()
   {
     rungs_.clear();
+    id_index_.clear();
   }
 
 private:
   const size_type dof_;
-  std::vector<Rung> rungs_;
+  RungSequence rungs_;
+  mutable TrajectoryIndex id_index_; // updated lazily by indexOf()
 };
 } // descartes_planner
 #endif
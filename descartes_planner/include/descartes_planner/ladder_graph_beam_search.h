@@ -0,0 +1,104 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_LADDER_GRAPH_BEAM_SEARCH_H
+#define DESCARTES_LADDER_GRAPH_BEAM_SEARCH_H
+
+#include "descartes_planner/ladder_graph.h"
+
+namespace descartes_planner
+{
+
+/**
+ * @brief Limits on the vertices of a rung that survive to relax the next one
+ */
+struct BeamParameters
+{
+  std::size_t width = 0; // the number of cheapest vertices kept per rung, 0 keeps all of them
+  double cost_ratio = 0.0; // drops vertices costing more than this multiple of the cheapest one, 0 disables
+
+  bool enabled() const noexcept { return width > 0 || cost_ratio > 0.0; }
+};
+
+/**
+ * @brief pruneRung Marks the vertices of a rung that don't survive 'beam' as unreachable, by setting their distance
+ *        to std::numeric_limits<double>::max(). Of several vertices tied at the width limit, the lowest indices
+ *        survive. The cost ratio only applies when the cheapest distance is positive.
+ * @return The number of reachable vertices that were pruned
+ */
+std::size_t pruneRung(std::vector<double>& distance, const BeamParameters& beam);
+
+/**
+ * @brief A DAGSearch that only relaxes the edges out of the surviving vertices of each rung (see pruneRung). The first
+ *        rung is never pruned. The cost it returns is that of a valid path, but not necessarily of the shortest one:
+ *        the cheapest way to a rung may go through a vertex that was pruned from an earlier one. With a width of at
+ *        least the size of the widest rung and no cost ratio it returns the same cost as DAGSearch.
+ */
+class BeamDAGSearch
+{
+public:
+  using predecessor_t = unsigned;
+  using size_type = std::size_t;
+
+  BeamDAGSearch(const LadderGraph& graph, const BeamParameters& beam);
+
+  /**
+   * @return The cost of the path found, std::numeric_limits<double>::max() if pruning left none
+   */
+  double run();
+
+  std::vector<predecessor_t> shortestPath() const;
+
+  /**
+   * @brief prunedVertices The number of reachable vertices pruned by the last call to run()
+   */
+  size_type prunedVertices() const noexcept { return pruned_vertices_; }
+
+private:
+  const LadderGraph& graph_;
+  BeamParameters beam_;
+
+  struct SolutionRung
+  {
+    std::vector<double> distance;
+    std::vector<predecessor_t> predecessor;
+  };
+
+  std::vector<SolutionRung> solution_;
+  size_type pruned_vertices_;
+};
+
+/**
+ * @brief Tracks how much a pruned search loses against an exact one over a series of searches
+ */
+struct BeamSearchStats
+{
+  std::size_t searches = 0; // pruned searches run
+  std::size_t validated = 0; // pruned searches that were compared with an exact search
+  std::size_t cost_changed = 0; // validated searches that returned a more expensive path than the exact one
+  std::size_t failed = 0; // validated searches where pruning left no path but an exact search found one
+  double max_relative_increase = 0.0; // the largest (pruned - exact) / exact among the searches that found a path
+  std::size_t pruned_vertices = 0; // over all searches
+
+  /**
+   * @brief record Accounts for a pruned search, and if 'exact_cost' is given for its comparison with an exact one
+   */
+  void record(double pruned_cost, std::size_t pruned, const double* exact_cost = nullptr);
+};
+
+} // descartes_planner
+#endif
@@ -35,6 +35,25 @@ public:
 
   double run();
 
+  /**
+   * @brief runParallel Computes the same solution as run() using up to 'n_threads' threads. The ladder is split
+   *        into one block of rungs per thread, and each thread computes the min-plus transfer matrix of its block:
+   *        the cost from every vertex of the block's first rung to every vertex of its last. Since min-plus
+   *        composition is associative, chaining the matrices yields the distances at every block boundary, after
+   *        which the blocks fill in their interior distances and predecessors independently.
+   *
+   *        Computing a transfer matrix costs roughly 'n' times the sequential work of its block, where 'n' is the
+   *        number of vertices in the block's first rung, so this only pays off when the thread count exceeds the
+   *        width of the ladder at the block boundaries (e.g. the <= 8 IK solutions of a 6-DOF arm). Block
+   *        boundaries are moved to the narrowest nearby rung for this reason.
+   *
+   *        Costs and paths match run() exactly when edge costs sum without rounding; otherwise the returned cost
+   *        may differ in the last bits, which can only change the path if two paths tie to within that rounding.
+   *        Falls back to run() for a single thread or a ladder too short to split.
+   * @return The cost of the shortest path
+   */
+  double runParallel(unsigned n_threads);
+
   std::vector<predecessor_t> shortestPath() const;
 
 private:
@@ -61,6 +80,18 @@ private:
     return solution_[rung].predecessor[index];
   }
 
+  /**
+   * @brief relaxBlock Runs the sequential search over rungs [first, last] from the distances already stored in
+   *        rung 'first'. If 'exit_distance' is non-null, the distances of rung 'last' are written there instead of
+   *        to the solution (its predecessors are always written to the solution).
+   */
+  void relaxBlock(size_type first, size_type last, std::vector<double>* exit_distance);
+
+  /**
+   * @brief transferMatrix Computes the row-major min-plus transfer matrix from rung 'first' to rung 'last'
+   */
+  void transferMatrix(size_type first, size_type last, std::vector<double>& matrix) const;
+
   std::vector<SolutionRung> solution_;
 };
 } // descartes_planner
@@ -0,0 +1,51 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_LADDER_GRAPH_EDGE_FILTER_H
+#define DESCARTES_LADDER_GRAPH_EDGE_FILTER_H
+
+#include "descartes_planner/ladder_graph_relaxation.h"
+
+namespace descartes_planner
+{
+
+/**
+ * @brief transposeJoints Copies the joint values of a rung to structure-of-arrays form: joint 'k' of vertex 'j' goes
+ *        to soa[k * n_vertices + j]
+ * @param joints The vertices of the rung, 'dof' values each, as stored in LadderGraph
+ */
+void transposeJoints(const double* joints, std::size_t n_vertices, std::size_t dof, std::vector<double>& soa);
+
+/**
+ * @brief filterEdges Finds the vertices of a rung that 'start' can reach without any joint moving further than its
+ *        limit, i.e. those for which |start[k] - target[k]| <= max_delta[k] for every joint 'k', and the cost of
+ *        getting there: the sum of those joint distances. The survivors are written to 'indices' and 'costs' in
+ *        increasing index order; the vector kernels test a block of targets at once and compact the survivors with
+ *        masks. Every kernel returns the same edges, with bit-identical costs, as the scalar test of
+ *        DefaultEdgesWithTime.
+ * @param targets The joint values of the rung in the layout of transposeJoints(), where 'stride' is the number of
+ *        vertices of the rung. Pointing into a row tests the 'n_targets' vertices from there on, with indices
+ *        counted from it.
+ * @param indices,costs Room for 'n_targets' values each
+ * @return The number of survivors
+ */
+std::size_t filterEdges(RelaxationKernel kernel, const double* start, const double* targets, std::size_t n_targets,
+                        std::size_t stride, std::size_t dof, const double* max_delta, unsigned* indices,
+                        double* costs) noexcept;
+
+} // descartes_planner
+#endif
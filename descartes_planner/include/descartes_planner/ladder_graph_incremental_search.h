@@ -0,0 +1,109 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_LADDER_GRAPH_INCREMENTAL_SEARCH_H
+#define DESCARTES_LADDER_GRAPH_INCREMENTAL_SEARCH_H
+
+#include "descartes_planner/ladder_graph.h"
+
+namespace descartes_planner
+{
+class CancellationToken;
+
+/**
+ * @brief A shortest path search over a LadderGraph that persists between queries. It keeps the forward distances
+ *        (cost from the first rung) of a valid prefix of the ladder and the backward cost-to-go (cost to the last
+ *        rung) of a valid suffix. The owner of the graph reports every edit through the rung*() notifications, which
+ *        shrink the valid regions to exclude the rungs whose results depend on the edit.
+ *
+ *        A query only relaxes the rungs between the two valid regions, then joins them at a meeting rung where both
+ *        are valid. The first query costs a full search; each following one costs time proportional to the distance
+ *        between the edits and the previous meeting rung, which is placed next to the most recent edit.
+ *
+ *        Any optimal path may be returned: when several paths tie, it may differ from the one found by DAGSearch.
+ */
+class IncrementalDAGSearch
+{
+public:
+  using predecessor_t = unsigned;
+  using size_type = std::size_t;
+
+  explicit IncrementalDAGSearch(const LadderGraph& graph);
+
+  /**
+   * @brief reset Discards all results, e.g. after the graph was rebuilt or cleared
+   */
+  void reset();
+
+  /**
+   * @brief rungInserted Notifies that a rung was inserted at 'index' and the edges on either side of it assigned
+   */
+  void rungInserted(size_type index);
+
+  /**
+   * @brief rungRemoved Notifies that the rung at 'index' was removed and the edges across the gap reassigned
+   */
+  void rungRemoved(size_type index);
+
+  /**
+   * @brief rungModified Notifies that the vertices of rung 'index', or the edges into or out of it, changed
+   */
+  void rungModified(size_type index);
+
+  /**
+   * @brief run Brings the search up to date with the graph
+   * @param cancel If not null, checked before relaxing each rung; the rungs relaxed before it was cancelled are kept
+   *        for the next call
+   * @return The cost of the shortest path, std::numeric_limits<double>::max() if there is none or the search was
+   *         cancelled
+   */
+  double run(const CancellationToken* cancel = nullptr);
+
+  /**
+   * @brief shortestPath The vertex index in each rung of the path found by the last call to run()
+   */
+  std::vector<predecessor_t> shortestPath() const;
+
+  /**
+   * @brief relaxedRungs The number of rungs whose distances or cost-to-go were recomputed by the last call to run()
+   */
+  size_type relaxedRungs() const noexcept { return relaxed_rungs_; }
+
+private:
+  struct SolutionRung
+  {
+    std::vector<double> cost; // distance from the first rung, or cost-to-go to the last one
+    std::vector<predecessor_t> link; // predecessor in the previous rung, or successor in the next one
+  };
+
+  void forwardRelax(size_type rung);
+  void backwardRelax(size_type rung);
+
+  const LadderGraph& graph_;
+  std::vector<SolutionRung> forward_;
+  std::vector<SolutionRung> backward_;
+  size_type forward_valid_; // forward_[0, forward_valid_) are up to date
+  size_type backward_valid_; // backward_[backward_valid_, size) are up to date
+  size_type last_edit_;
+
+  size_type meeting_rung_;
+  predecessor_t meeting_vertex_;
+  size_type relaxed_rungs_;
+};
+
+} // descartes_planner
+#endif
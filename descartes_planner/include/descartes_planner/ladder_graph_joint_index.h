@@ -0,0 +1,80 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_LADDER_GRAPH_JOINT_INDEX_H
+#define DESCARTES_LADDER_GRAPH_JOINT_INDEX_H
+
+#include "descartes_planner/ladder_graph_edge_filter.h"
+
+namespace descartes_planner
+{
+
+/**
+ * @brief SortedJointIndex finds the vertices of a rung within a per joint distance of a point without testing all of
+ *        them. The vertices are sorted by their most selective joint, the one along which the fewest vertices are
+ *        expected within the limit of each other, so that the candidates of a query form a contiguous window found
+ *        by binary search. The window is tested with filterEdges() on a transposed copy of the rung in the same
+ *        order.
+ *
+ *        This pays off for rungs of a thousand vertices or more that spread over several times the limit along some
+ *        joint, as the finely sampled redundant solutions of a tool-axis symmetric point do. build() declines
+ *        smaller rungs, which filterEdges() scans about as fast, and rungs where a query would still test a large
+ *        fraction of the vertices.
+ */
+class SortedJointIndex
+{
+public:
+  using size_type = std::size_t;
+
+  SortedJointIndex();
+
+  /**
+   * @brief build Indexes the vertices of a rung, unless a query isn't expected to skip enough of them to pay off
+   * @param joints The vertices, 'dof' values each, as stored in LadderGraph
+   * @param max_delta The largest distance along each joint that a query accepts
+   * @return True if the index was built
+   */
+  bool build(const double* joints, size_type n_vertices, size_type dof, const double* max_delta);
+
+  /**
+   * @brief query Same as filterEdges() over the whole rung, but for the order of the results: finds the vertices for
+   *        which |point[k] - vertex[k]| <= max_delta[k] for every joint 'k', and the sums of those distances. They come
+   *        in the order of the sorted joint, which is deterministic.
+   * @param indices,costs Room for as many values as the rung has vertices
+   * @return The number of vertices found
+   */
+  size_type query(RelaxationKernel kernel, const double* point, unsigned* indices, double* costs);
+
+  /**
+   * @brief candidateFraction The fraction of the vertices a query is expected to test, as estimated by build()
+   */
+  double candidateFraction() const noexcept { return candidate_fraction_; }
+
+  size_type sortedJoint() const noexcept { return joint_; }
+
+private:
+  size_type dof_;
+  size_type joint_;
+  double candidate_fraction_;
+  std::vector<double> max_delta_;
+  std::vector<double> keys_; // the values of the sorted joint, in increasing order
+  std::vector<unsigned> order_; // the vertex at each sorted position
+  std::vector<double> targets_; // the vertices in sorted order, transposed
+};
+
+} // descartes_planner
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_LADDER_GRAPH_K_SHORTEST_PATHS_H
+#define DESCARTES_LADDER_GRAPH_K_SHORTEST_PATHS_H
+
+#include "descartes_planner/ladder_graph.h"
+
+namespace descartes_planner
+{
+
+/**
+ * @brief Enumerates the paths through a LadderGraph in order of increasing cost.
+ *
+ *        A backward pass first computes the exact cost-to-go of every vertex. Paths are then grown from the first
+ *        rung in best-first order of their cost so far plus the cost-to-go of their last vertex. As that estimate is
+ *        exact, every prefix that is expanded leads to a complete path and the complete paths come out cheapest
+ *        first. A prefix only creates its extension along its best out edge and its sibling along the next best out
+ *        edge of its parent, the out edges of a vertex being sorted by cost plus cost-to-go the first time it is
+ *        expanded. Prefixes share their common part as a tree, so each path costs O(rungs * log(frontier)) time
+ *        and O(rungs) memory on top of the backward pass, or less when it deviates late from a cheaper one.
+ *
+ *        Paths that cost the same come out in an unspecified but deterministic order.
+ */
+class KShortestPaths
+{
+public:
+  using predecessor_t = unsigned;
+  using size_type = std::size_t;
+
+  struct Path
+  {
+    double cost;
+    std::vector<predecessor_t> vertices; // the vertex index in each rung
+  };
+
+  explicit KShortestPaths(const LadderGraph& graph);
+
+  /**
+   * @brief run Finds up to 'k' paths, cheapest first
+   * @param min_differing_rungs If non-zero, a path is only accepted if it uses a different vertex than every
+   *        previously accepted path in at least this many rungs; paths too similar to those already accepted are
+   *        skipped
+   * @param max_candidates Stops after this many complete paths were considered, accepted or not, 0 for no limit.
+   *        Bounds the work when the diversity constraint rejects long runs of near identical paths.
+   * @return The paths found, fewer than 'k' if the graph doesn't have enough of them
+   */
+  std::vector<Path> run(size_type k, size_type min_differing_rungs = 0, size_type max_candidates = 0);
+
+  /**
+   * @brief candidates The number of complete paths considered by the last call to run()
+   */
+  size_type candidates() const noexcept { return candidates_; }
+
+private:
+  void computeCostToGo();
+
+  /**
+   * @brief edgeOrder The out edges of a vertex that lead to the last rung, cheapest total first, sorted on first use
+   */
+  const std::vector<unsigned>& edgeOrder(size_type rung, size_type vertex);
+
+  const LadderGraph& graph_;
+  std::vector<std::vector<double>> cost_to_go_;
+  std::vector<std::vector<std::vector<unsigned>>> edge_order_;
+  size_type candidates_;
+};
+
+} // descartes_planner
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DESCARTES_LADDER_GRAPH_RELAXATION_H
+#define DESCARTES_LADDER_GRAPH_RELAXATION_H
+
+#include "descartes_planner/ladder_graph.h"
+
+namespace descartes_planner
+{
+
+/**
+ * @brief The instruction set used to relax a dense rung pair. The best one supported by the host is picked at
+ *        runtime; every kernel produces bit-identical distances and predecessors.
+ */
+enum class RelaxationKernel
+{
+  SCALAR,
+  AVX2,
+  AVX512
+};
+
+/**
+ * @brief isKernelSupported Returns true if the host CPU can execute the given kernel
+ */
+bool isKernelSupported(RelaxationKernel kernel) noexcept;
+
+/**
+ * @brief bestRelaxationKernel The fastest kernel supported by the host CPU
+ */
+RelaxationKernel bestRelaxationKernel() noexcept;
+
+const char* toString(RelaxationKernel kernel) noexcept;
+
+/**
+ * @brief relaxDense Min-plus matrix-vector product between the distances of a rung and the dense edge matrix to the
+ *        next rung, computed in gather form. For each destination vertex 'j':
+ *
+ *          dst_distance[j] = min(dst_distance[j], min_i(src_distance[i] + edges[i * n_dst + j].cost))
+ *
+ *        and dst_predecessor[j] is set to the minimizing 'i' whenever dst_distance[j] improves. Sources are visited
+ *        in increasing order with a strict comparison, so ties resolve exactly as in the scalar scatter loop of
+ *        DAGSearch.
+ * @param edges Row-major 'n_src' x 'n_dst' edge matrix, i.e. the edges of a RungEdges with dense targets
+ */
+void relaxDense(RelaxationKernel kernel, const double* src_distance, std::size_t n_src, const Edge* edges,
+                std::size_t n_dst, double* dst_distance, unsigned* dst_predecessor) noexcept;
+
+/**
+ * @brief relaxRung Relaxes every out-edge of a rung into the distances of the next one. Dense rungs are dispatched
+ *        to the best available relaxDense kernel, others use a scalar scatter over the CSR rows.
+ */
+void relaxRung(const RungEdges& edges, const double* src_distance, std::size_t n_dst, double* dst_distance,
+               unsigned* dst_predecessor) noexcept;
+
+} // descartes_planner
+#endif
@@ -32,26 +32,98 @@
 #include "descartes_trajectory/joint_trajectory_pt.h"
 
 #include "descartes_planner/ladder_graph.h"
+#include "descartes_planner/ladder_graph_beam_search.h"
+#include "descartes_planner/ladder_graph_incremental_search.h"
+#include "descartes_planner/task_pool.h"
 
 namespace descartes_planner
 {
 
 typedef boost::function<double(const double*, const double*)> CostFunction;
 
+/**
+ * @brief BatchCostFunction computes the cost from one joint solution to each of a contiguous block of others in a
+ *        single call: costs[j] = cost(start, end_joints + j * dof) for every j < n_end, with the DOF of the robot
+ *        model. Compared to calling a CostFunction per edge, the cost can vectorize across the block and there is
+ *        one type-erased call per block rather than per edge.
+ *
+ *        It must be constructed explicitly, so that lambdas passed to the planners keep picking the CostFunction
+ *        overloads.
+ */
+class BatchCostFunction
+{
+public:
+  typedef boost::function<void(const double* start, const double* end_joints, std::size_t n_end, double* costs)>
+      Function;
+
+  BatchCostFunction() {}
+
+  explicit BatchCostFunction(Function fn) : fn_(std::move(fn)) {}
+
+  void operator()(const double* start, const double* end_joints, std::size_t n_end, double* costs) const
+  {
+    fn_(start, end_joints, n_end, costs);
+  }
+
+  explicit operator bool() const noexcept { return !fn_.empty(); }
+
+private:
+  Function fn_;
+};
+
+/**
+ * @brief toBatchCostFunction Adapts a per edge cost for a robot with 'dof' joints, calling it once per vertex of
+ *        the block. Returns an empty function if 'fn' is empty.
+ */
+BatchCostFunction toBatchCostFunction(CostFunction fn, std::size_t dof);
+
+/**
+ * @brief BuildFailure tells why PlanningGraph::insertGraph() failed
+ */
+struct BuildFailure
+{
+  enum Reason
+  {
+    NONE,
+    TOO_FEW_POINTS, // fewer than two points were given
+    IK_FAILED,      // a point has no joint solution
+    NO_EDGES,       // no pair of solutions of two consecutive points satisfies the joint velocity limits
+    CANCELLED       // the caller's token was cancelled or its deadline passed, 'rung' and 'id' aren't set
+  };
+
+  Reason reason = NONE;
+  std::size_t rung = 0;            // the point without solutions, or the first of the pair without edges
+  descartes_core::TrajectoryPt::ID id; // the ID of that point
+};
+
+const char* toString(BuildFailure::Reason reason) noexcept;
 
 class PlanningGraph
 {
 public:
   PlanningGraph(descartes_core::RobotModelConstPtr model, CostFunction cost_function_callback = CostFunction{});
 
+  PlanningGraph(descartes_core::RobotModelConstPtr model, BatchCostFunction cost_function_callback);
+
+  // The search keeps a reference to graph_
+  PlanningGraph(const PlanningGraph&) = delete;
+  PlanningGraph& operator=(const PlanningGraph&) = delete;
+
   /** \brief Clear all previous graph data */
-  void clear() { graph_.clear(); }
+  void clear() { graph_.clear(); search_.reset(); }
 
   /** @brief initial population of graph trajectory elements
    * @param points list of trajectory points to be used to construct the graph
-   * @return True if the graph was successfully created
+   * @return True if the graph was successfully created. Otherwise the graph is cleared and getBuildFailure() tells
+   *         why: the first point without IK solutions or pair of points without edges stops the other threads, so
+   *         the build fails as soon as either is found. With several of them, which one is reported depends on
+   *         the order the threads find them in. Edges aren't built with setImplicitEdges(true), so pairs without
+   *         any are only found by the search.
+   * @param cancel Stops the build, which then fails with BuildFailure::CANCELLED, when it is cancelled or its
+   *        deadline passes. It is checked before computing the solutions of each point and the edges of each pair.
    */
-  bool insertGraph(const std::vector<descartes_core::TrajectoryPtPtr>& points);
+  bool insertGraph(const std::vector<descartes_core::TrajectoryPtPtr>& points,
+                   const CancellationToken& cancel = CancellationToken());
 
   /** @brief adds a single trajectory point to the graph
    * @param point The new point to add to the graph
@@ -66,6 +138,89 @@ public:
 
   bool getShortestPath(double &cost, std::list<descartes_trajectory::JointTrajectoryPt> &path);
 
+  /**
+   * @brief getShortestPath As above, giving up when 'cancel' is cancelled or its deadline passes. The default and
+   *        implicit edge searches check it before each rung, keeping the rungs the default search relaxed for the
+   *        next call; the parallel and beam searches only check it before they start.
+   * @return False if there is no path or the search was cancelled, which cancel.cancelled() tells apart
+   */
+  bool getShortestPath(double &cost, std::list<descartes_trajectory::JointTrajectoryPt> &path,
+                       const CancellationToken& cancel);
+
+  /**
+   * @brief getShortestPaths Returns up to 'k' alternative paths through the current graph, cheapest first, without
+   *        rebuilding it. See KShortestPaths. Requires stored edges, i.e. not setImplicitEdges(true).
+   * @param min_differing_points If non-zero, every returned path uses a different joint solution than each cheaper
+   *        returned path for at least this many points
+   * @param max_candidates Limits the number of paths considered while looking for diverse ones, 0 for no limit
+   * @return False if there is no path at all
+   */
+  bool getShortestPaths(std::size_t k, std::size_t min_differing_points, std::size_t max_candidates,
+                        std::vector<double>& costs,
+                        std::vector<std::list<descartes_trajectory::JointTrajectoryPt>>& paths) const;
+
+  /**
+   * @brief setSearchThreads Sets the number of threads used by getShortestPath(). With one thread (the default)
+   *        the graph is searched incrementally, only re-relaxing the rungs affected by edits since the last search.
+   *        With more than one thread every search starts over with DAGSearch::runParallel(), see there for when
+   *        this pays off.
+   */
+  void setSearchThreads(unsigned n_threads) { search_threads_ = n_threads > 0 ? n_threads : 1; }
+
+  unsigned getSearchThreads() const noexcept { return search_threads_; }
+
+  /**
+   * @brief setTaskPool Sets the threads that compute the IK solutions and the edges of the graph. Each graph starts
+   *        out with a pool of one thread per hardware thread; a pool may be shared by several graphs, whose loops
+   *        then take turns. A null pool computes everything on the calling thread.
+   */
+  void setTaskPool(std::shared_ptr<TaskPool> pool);
+
+  const std::shared_ptr<TaskPool>& getTaskPool() const noexcept { return task_pool_; }
+
+  /**
+   * @brief setImplicitEdges Switches between storing the edges of the graph (the default) and evaluating them on the
+   *        fly. With implicit edges the graph only stores vertices: getShortestPath() evaluates the edges between
+   *        each pair of rungs while relaxing them, trading the edge memory and the separate build for having to
+   *        re-evaluate every edge on every search. Switching discards or rebuilds the edges of the current graph.
+   */
+  void setImplicitEdges(bool implicit);
+
+  bool getImplicitEdges() const noexcept { return implicit_edges_; }
+
+  /**
+   * @brief setMaxOutEdges Keeps only the 'k' cheapest edges out of each vertex between rungs without timing, plus
+   *        the cheapest edge into any vertex that would otherwise have none, see BasicDefaultEdgesWithoutTime. This
+   *        bounds the edge memory of wide untimed rungs at the risk of a costlier path. Applies to the edges built
+   *        afterwards, including those evaluated on the fly; 0 (the default) keeps every edge.
+   */
+  void setMaxOutEdges(std::size_t k) { max_out_edges_ = k; }
+
+  std::size_t getMaxOutEdges() const noexcept { return max_out_edges_; }
+
+  /**
+   * @brief setBeam Prunes each rung to the survivors of 'beam' before relaxing the next one, see BeamDAGSearch. This
+   *        trades optimality for speed on very wide rungs; it takes precedence over setSearchThreads() and combines
+   *        with setImplicitEdges(), where it also skips evaluating the edges out of pruned vertices. A default
+   *        constructed BeamParameters restores the exact search.
+   */
+  void setBeam(const BeamParameters& beam) { beam_ = beam; }
+
+  const BeamParameters& getBeam() const noexcept { return beam_; }
+
+  /**
+   * @brief setBeamValidation If enabled, every pruned search is followed by an exact one and the difference in cost
+   *        is recorded in getBeamSearchStats(). Meant for tuning the beam, as it costs an exact search.
+   */
+  void setBeamValidation(bool validate) { beam_validation_ = validate; }
+
+  bool getBeamValidation() const noexcept { return beam_validation_; }
+
+  const BeamSearchStats& getBeamSearchStats() const noexcept { return beam_stats_; }
+
+  /** @brief Why the last insertGraph() failed, NONE if it succeeded */
+  const BuildFailure& getBuildFailure() const noexcept { return build_failure_; }
+
   const descartes_planner::LadderGraph& graph() const noexcept { return graph_; }
 
   descartes_core::RobotModelConstPtr getRobotModel() const { return robot_model_; }
@@ -73,7 +228,16 @@ public:
 protected:
   descartes_planner::LadderGraph graph_;
   descartes_core::RobotModelConstPtr robot_model_;
-  CostFunction custom_cost_function_;
+  BatchCostFunction custom_cost_function_;
+  unsigned search_threads_;
+  std::shared_ptr<TaskPool> task_pool_;
+  bool implicit_edges_;
+  std::size_t max_out_edges_;
+  IncrementalDAGSearch search_;
+  BeamParameters beam_;
+  bool beam_validation_;
+  BeamSearchStats beam_stats_;
+  BuildFailure build_failure_;
 
   /**
    * @brief A pair indicating the validity of the edge, and if valid, the cost associated
@@ -86,15 +250,41 @@ protected:
   bool populateGraphVertices(const std::vector<descartes_core::TrajectoryPtPtr> &points,
                              std::vector<std::vector<descartes_trajectory::JointTrajectoryPt>> &poses);
 
-  void computeAndAssignEdges(const std::size_t start_idx, const std::size_t end_idx);
+  /**
+   * @brief Builds the edges from rung 'start_idx' to 'end_idx', stopping early once 'cancel' is cancelled
+   * @return False if there are none
+   */
+  bool computeAndAssignEdges(const std::size_t start_idx, const std::size_t end_idx,
+                             const CancellationToken* cancel = nullptr);
 
+  /**
+   * @brief Calls descartes_planner::withEdgeBuilder() for the rung pair 'start_idx', 'end_idx' of the graph
+   */
+  template <typename Sink, typename Fn>
+  void withEdgeBuilder(const std::size_t start_idx, const std::size_t end_idx, Fn&& fn) const;
+
+  /** @brief Appends the joint values of the vertex chosen in each rung to 'path' */
+  void toJointPath(const std::vector<unsigned>& path_idxs,
+                   std::list<descartes_trajectory::JointTrajectoryPt>& path) const;
+
+  void recordBeamSearch(double cost, std::size_t pruned, const double* exact_cost);
+
+  /**
+   * @brief Searches the graph while evaluating its edges on the fly, see setImplicitEdges(), pruning each rung with
+   *        'beam' if it is enabled
+   * @param pruned The number of vertices pruned
+   * @return The cost of the shortest path, whose vertex indices are returned in 'path'
+   */
+  double searchImplicitEdges(std::vector<unsigned>& path, const BeamParameters& beam, std::size_t& pruned,
+                             const CancellationToken* cancel = nullptr) const;
 
   template <typename EdgeBuilder>
-  std::vector<LadderGraph::EdgeList> calculateEdgeWeights(EdgeBuilder&& builder,
-                                                          const std::vector<double> &start_joints,
-                                                          const std::vector<double> &end_joints,
-                                                          const size_t dof,
-                                                          bool& has_edges) const;
+  RungEdges calculateEdgeWeights(EdgeBuilder&& builder,
+                                 const std::vector<double> &start_joints,
+                                 const std::vector<double> &end_joints,
+                                 const size_t dof,
+                                 const CancellationToken* cancel,
+                                 bool& has_edges) const;
 
 };
 
@@ -20,26 +20,144 @@
 #define PLANNING_GRAPH_EDGE_POLICY_H
 
 #include "descartes_planner/ladder_graph.h"
+#include "descartes_planner/ladder_graph_edge_filter.h"
+#include "descartes_planner/ladder_graph_joint_index.h"
+#include <cassert>
 #include <numeric>
 
 namespace descartes_planner
 {
 
-struct DefaultEdgesWithTime
+/**
+ * @brief RelaxingSink can stand in for RungEdges as the result of the edge builders below. Rather than storing the
+ *        edges it relaxes each one into the distances of the next rung as soon as it is built, fusing edge
+ *        evaluation and search into a single pass that needs no edge memory. Vertices are numbered in the order
+ *        they are closed, so it must be attach()ed before the builder is used.
+ */
+class RelaxingSink
 {
- DefaultEdgesWithTime(const size_t n_start,
-                      const size_t n_end,
-                      const size_t dof,
-                      const double upper_tm,
-                      const std::vector<double>& joint_vel_limits)
-    : results_(n_start)
-    , edge_scratch_(n_end)
-    , max_dtheta_(dof)
+public:
+  using size_type = std::size_t;
+
+  RelaxingSink()
+    : src_distance_(nullptr), dst_distance_(nullptr), dst_predecessor_(nullptr), vertex_(0), n_edges_(0)
+  {}
+
+  /**
+   * @brief attach Sets the distances of the source rung, and the distances & predecessors of the destination rung
+   *        that edges are relaxed into
+   */
+  void attach(const double* src_distance, double* dst_distance, unsigned* dst_predecessor) noexcept
+  {
+    src_distance_ = src_distance;
+    dst_distance_ = dst_distance;
+    dst_predecessor_ = dst_predecessor;
+    vertex_ = 0;
+    n_edges_ = 0;
+  }
+
+  // Nothing is stored, so there's nothing to allocate
+  void reserve(size_type, size_type) noexcept {}
+  void setDenseTargets(size_type) noexcept {}
+
+  void push_back(const Edge& edge) noexcept
+  {
+    ++n_edges_;
+    const double dv = src_distance_[vertex_] + edge.cost;
+    if (dv < dst_distance_[edge.idx])
+    {
+      dst_distance_[edge.idx] = dv;
+      dst_predecessor_[edge.idx] = vertex_;
+    }
+  }
+
+  void closeVertex() noexcept { ++vertex_; }
+
+  // Edges out of vertices already closed are relaxed the same way, from the distance of their source
+  void insertEdges(const std::vector<std::pair<unsigned, Edge>>& edges) noexcept
+  {
+    for (const auto& e : edges)
+    {
+      ++n_edges_;
+      const double dv = src_distance_[e.first] + e.second.cost;
+      if (dv < dst_distance_[e.second.idx])
+      {
+        dst_distance_[e.second.idx] = dv;
+        dst_predecessor_[e.second.idx] = e.first;
+      }
+    }
+  }
+
+  size_type numEdges() const noexcept { return n_edges_; }
+
+  bool empty() const noexcept { return n_edges_ == 0; }
+
+private:
+  const double* src_distance_;
+  double* dst_distance_;
+  unsigned* dst_predecessor_;
+  unsigned vertex_;
+  size_type n_edges_;
+};
+
+/**
+ * @brief FixedDof gives the edge builders their number of joints at compile time, so that their joint loops unroll
+ */
+template <std::size_t N>
+struct FixedDof
+{
+  explicit FixedDof(std::size_t dof) noexcept
+  {
+    assert(dof == N);
+    (void)dof;
+  }
+
+  constexpr operator std::size_t() const noexcept { return N; }
+};
+
+/**
+ * @brief DynamicDof gives the edge builders their number of joints at run time
+ */
+struct DynamicDof
+{
+  explicit DynamicDof(std::size_t dof) noexcept : value(dof) {}
+
+  operator std::size_t() const noexcept { return value; }
+
+  std::size_t value;
+};
+
+/**
+ * The timed edge builders look for the edges of EDGE_TILE_SOURCES source vertices at once, testing them against
+ * EDGE_TILE_BYTES of the destination rung at a time so that it is read from L1 rather than once per source.
+ */
+const std::size_t EDGE_TILE_SOURCES = 8;
+const std::size_t EDGE_TILE_BYTES = 16 * 1024;
+
+/**
+ * The edge builders are templated on where the edges go: RungEdges stores them, RelaxingSink relaxes them on the fly.
+ * They are also templated on their number of joints, see FixedDof, and the custom ones on the type of their cost
+ * function, which inlines if it is a functor rather than a BatchCostFunction. The Default/Custom aliases below are
+ * the storing versions for any number of joints.
+ */
+template <typename Sink, typename Dof = DynamicDof>
+struct BasicDefaultEdgesWithTime
+{
+ BasicDefaultEdgesWithTime(const size_t n_start,
+                           const size_t n_end,
+                           const size_t dof,
+                           const double upper_tm,
+                           const std::vector<double>& joint_vel_limits)
+    : max_dtheta_(dof)
     , delta_buffer_(dof)
     , dof_(dof)
-    , count_(0)
-    , has_edges_(false)
+    , end_joints_(nullptr)
+    , n_end_(0)
+    , indexed_(false)
+    , target_block_(0)
   {
+   // The number of valid edges isn't known up front, so start with room for one full row and grow as needed
+   results_.reserve(n_start, n_end);
    std::transform(joint_vel_limits.cbegin(), joint_vel_limits.cend(), max_dtheta_.begin(), [upper_tm] (double v) {
                     return v * upper_tm;
                   });
@@ -54,80 +172,243 @@ struct DefaultEdgesWithTime
     }
 
     auto cost = std::accumulate(delta_buffer_.cbegin(), delta_buffer_.cend(), 0.0);
-    edge_scratch_[count_].cost = cost;
-    edge_scratch_[count_].idx = static_cast<unsigned>(index);
-    count_++;
+    results_.push_back({cost, static_cast<unsigned>(index)});
   }
 
-  inline void next(const size_t i)
+  /**
+   * @brief setTargets Prepares the destination rung for considerAll() and findTargets(). If it is large and spreads
+   *        out enough, it is put in a SortedJointIndex, otherwise it is transposed for filterEdges(). 'end_joints'
+   *        must outlive the calls to them.
+   */
+  void setTargets(const double* const end_joints, const size_t n_end)
   {
-    results_[i].assign(edge_scratch_.cbegin(), edge_scratch_.cbegin() + count_);
-    has_edges_ = has_edges_ || count_ > 0;
-    count_ = 0;
+    end_joints_ = end_joints;
+    n_end_ = n_end;
+    indexed_ = index_.build(end_joints, n_end, dof_, max_dtheta_.data());
+    if (!indexed_) transposeJoints(end_joints, n_end, dof_, targets_);
+
+    // Whole vectors of 8 targets
+    target_block_ = EDGE_TILE_BYTES / (sizeof(double) * dof_) / 8 * 8;
+    if (target_block_ == 0) target_block_ = 8;
+    target_indices_.resize(EDGE_TILE_SOURCES * n_end);
+    target_costs_.resize(EDGE_TILE_SOURCES * n_end);
   }
 
-  inline std::vector<LadderGraph::EdgeList>& result() noexcept { return results_; }
+  /**
+   * @brief findTargets Finds the vertices of the destination rung reachable within the velocity limits from each of
+   *        'n_sources' <= EDGE_TILE_SOURCES 'starts', and the default cost to them. Those of starts[s] are the first
+   *        target_counts_[s] of row 's' of target_indices_ and target_costs_, which have n_end_ columns. The rung is
+   *        tested a block of target_block_ vertices at a time against all the sources, so their edges come in order
+   *        of target all the same. With an index, each source is looked up in turn and its edges come in the order
+   *        of the sorted joint.
+   */
+  inline void findTargets(const double* const* starts, const size_t n_sources)
+  {
+    assert(n_sources <= EDGE_TILE_SOURCES);
+    const auto kernel = bestRelaxationKernel();
+    if (indexed_)
+    {
+      for (size_t s = 0; s < n_sources; ++s)
+        target_counts_[s] = index_.query(kernel, starts[s], &target_indices_[s * n_end_], &target_costs_[s * n_end_]);
+      return;
+    }
 
-  inline bool hasEdges() const noexcept { return has_edges_; }
+    std::fill(target_counts_, target_counts_ + n_sources, 0);
+    for (size_t first = 0; first < n_end_; first += target_block_)
+    {
+      const auto n_block = n_end_ - first < target_block_ ? n_end_ - first : target_block_;
+      for (size_t s = 0; s < n_sources; ++s)
+      {
+        const auto offset = s * n_end_ + target_counts_[s];
+        const auto n = filterEdges(kernel, starts[s], targets_.data() + first, n_block, n_end_, dof_,
+                                   max_dtheta_.data(), &target_indices_[offset], &target_costs_[offset]);
+        for (size_t k = 0; k < n; ++k)
+          target_indices_[offset + k] += static_cast<unsigned>(first);
+        target_counts_[s] += n;
+      }
+    }
+  }
 
-  std::vector<LadderGraph::EdgeList> results_;
-  LadderGraph::EdgeList edge_scratch_; // pre-allocated space to work in
+  /**
+   * @brief pushTargets Adds the edges found for starts[s] by findTargets() to the current vertex
+   */
+  inline void pushTargets(const size_t s, const double* const)
+  {
+    const auto offset = s * n_end_;
+    for (size_t k = 0; k < target_counts_[s]; ++k)
+      results_.push_back({target_costs_[offset + k], target_indices_[offset + k]});
+  }
+
+  /**
+   * @brief considerAll Same as calling consider() with 'start' and each vertex of the rung given to setTargets(), but
+   *        tests blocks of them at once with the best filterEdges() kernel. Without an index the edges come in
+   *        order of target, with one they come in the order of the sorted joint.
+   */
+  inline void considerAll(const double* const start)
+  {
+    findTargets(&start, 1);
+    pushTargets(0, start);
+  }
+
+  inline void next(const size_t)
+  {
+    results_.closeVertex();
+  }
+
+  inline Sink& result() noexcept { return results_; }
+
+  inline bool hasEdges() const noexcept { return !results_.empty(); }
+
+  Sink results_;
   std::vector<double> max_dtheta_;
   std::vector<double> delta_buffer_;
-  size_t dof_;
-  unsigned count_;
-  bool has_edges_;
+  Dof dof_;
+  const double* end_joints_; // the destination rung, see setTargets()
+  size_t n_end_;
+  bool indexed_;
+  SortedJointIndex index_;
+  std::vector<double> targets_;
+  size_t target_block_;
+  std::vector<unsigned> target_indices_; // the results of findTargets()
+  std::vector<double> target_costs_;
+  size_t target_counts_[EDGE_TILE_SOURCES];
 };
 
-struct CustomEdgesWithTime : public DefaultEdgesWithTime
+template <typename Sink, typename Dof = DynamicDof, typename Cost = descartes_planner::BatchCostFunction>
+struct BasicCustomEdgesWithTime : public BasicDefaultEdgesWithTime<Sink, Dof>
 {
-  CustomEdgesWithTime(const size_t n_start,
-                      const size_t n_end,
-                      const size_t dof,
-                      const double upper_tm,
-                      const std::vector<double>& joint_vel_limits,
-                      descartes_planner::CostFunction fn)
-    : DefaultEdgesWithTime(n_start, n_end, dof, upper_tm, joint_vel_limits)
-    , custom_cost_fn(fn)
+  BasicCustomEdgesWithTime(const size_t n_start,
+                           const size_t n_end,
+                           const size_t dof,
+                           const double upper_tm,
+                           const std::vector<double>& joint_vel_limits,
+                           Cost fn)
+    : BasicDefaultEdgesWithTime<Sink, Dof>(n_start, n_end, dof, upper_tm, joint_vel_limits)
+    , custom_cost_fn(std::move(fn))
   {}
 
   inline void consider(const double * const start, const double * const stop, const size_t index) noexcept
   {
-    for (size_t i = 0; i < dof_; ++i)
+    for (size_t i = 0; i < this->dof_; ++i)
     {
-      delta_buffer_[i] = std::abs(start[i] - stop[i]);
-      if (delta_buffer_[i] > max_dtheta_[i]) return;
+      this->delta_buffer_[i] = std::abs(start[i] - stop[i]);
+      if (this->delta_buffer_[i] > this->max_dtheta_[i]) return;
+    }
+
+    double cost;
+    custom_cost_fn(start, stop, 1, &cost);
+    this->results_.push_back({cost, static_cast<unsigned>(index)});
+  }
+
+  void setTargets(const double* const end_joints, const size_t n_end)
+  {
+    BasicDefaultEdgesWithTime<Sink, Dof>::setTargets(end_joints, n_end);
+    reachable_.resize(n_end * this->dof_);
+  }
+
+  /**
+   * @brief pushTargets Gathers the vertices found for 'start' by findTargets(), in row 's', into one block for a
+   *        single call of the cost function, then adds the edges to them
+   */
+  inline void pushTargets(const size_t s, const double* const start)
+  {
+    const auto n = this->target_counts_[s];
+    if (n == 0) return;
+
+    const auto dof = this->dof_;
+    const auto* indices = &this->target_indices_[s * this->n_end_];
+    auto* costs = &this->target_costs_[s * this->n_end_];
+    for (size_t i = 0; i < n; ++i)
+    {
+      const auto* joints = this->end_joints_ + indices[i] * dof;
+      std::copy(joints, joints + dof, reachable_.begin() + i * dof);
     }
 
-    double cost = custom_cost_fn(start, stop);
-    edge_scratch_[count_++] = {cost, static_cast<unsigned>(index)};
+    custom_cost_fn(start, reachable_.data(), n, costs);
+    for (size_t i = 0; i < n; ++i)
+      this->results_.push_back({costs[i], indices[i]});
+  }
+
+  /**
+   * @brief considerAll Finds the vertices within the velocity limits like the default version, then computes their
+   *        costs with a single call of the cost function
+   */
+  inline void considerAll(const double* const start)
+  {
+    this->findTargets(&start, 1);
+    pushTargets(0, start);
   }
 
-  descartes_planner::CostFunction custom_cost_fn; // TODO: Header doesn't stand on its own
+  Cost custom_cost_fn; // TODO: Header doesn't stand on its own
+  std::vector<double> reachable_; // the joints of the vertices found by findTargets()
 };
 
-struct DefaultEdgesWithoutTime
+/**
+ * @brief BasicDefaultEdgesWithoutTime connects every vertex to every vertex of the next rung. Given 'max_out_edges',
+ *        it keeps only that many of the cheapest edges out of each vertex, which cuts the edges of a rung pair from
+ *        n_start * n_end to about n_start * max_out_edges. The candidates of a vertex are partially sorted whenever
+ *        they fill a small buffer, after which edges costlier than the last one kept are dropped without being
+ *        buffered. Should no kept edge reach a destination vertex, the cheapest edge into it is added once the last
+ *        vertex is closed, so that every destination reachable from the considered sources stays reachable.
+ */
+template <typename Sink, typename Dof = DynamicDof>
+struct BasicDefaultEdgesWithoutTime
 {
-  DefaultEdgesWithoutTime(const size_t n_start,
-                       const size_t n_end,
-                       const size_t dof)
-     : results_(n_start)
-     , dof_(dof)
-     , count_(0)
-     , layer_(0)
+  // How many candidates per kept edge are buffered before they are cut down, when the edges are capped
+  static const size_t CANDIDATES_PER_KEPT_EDGE = 4;
+
+  /**
+   * @param max_out_edges The edges kept per vertex, 0 for all of them
+   */
+  BasicDefaultEdgesWithoutTime(const size_t n_start,
+                               const size_t n_end,
+                               const size_t dof,
+                               const size_t max_out_edges = 0)
+     : dof_(dof), n_start_(n_start), max_out_edges_(max_out_edges < n_end ? max_out_edges : 0), source_(0)
+     , has_threshold_(false)
   {
-    for (auto& edges : results_)
+    if (max_out_edges_ == 0)
     {
-      edges.resize(n_end);
+      // every start vertex connects to every end vertex
+      results_.reserve(n_start, n_start * n_end);
+      results_.setDenseTargets(n_end);
+    }
+    else
+    {
+      results_.reserve(n_start, n_start * max_out_edges_);
+      row_.reserve(CANDIDATES_PER_KEPT_EDGE * max_out_edges_);
+      const Edge none = {std::numeric_limits<double>::max(), 0u};
+      cheapest_in_.assign(n_end, std::make_pair(0u, none));
+      has_incoming_.assign(n_end, 0);
     }
   }
 
   inline bool hasEdges() const { return true; }
 
-  // no-op
-  inline void next(const size_t) { layer_++; count_ = 0; }
+  inline void next(const size_t index)
+  {
+    if (max_out_edges_ == 0)
+    {
+      results_.closeVertex();
+      return;
+    }
 
-  inline std::vector<LadderGraph::EdgeList>& result() noexcept { return results_; }
+    keepCheapest();
+    std::sort(row_.begin(), row_.end(), [](const Edge& a, const Edge& b) { return a.idx < b.idx; });
+    for (const auto& edge : row_)
+    {
+      results_.push_back(edge);
+      has_incoming_[edge.idx] = 1;
+    }
+    row_.clear();
+    has_threshold_ = false;
+    results_.closeVertex();
+
+    source_ = static_cast<unsigned>(index + 1);
+    if (source_ == n_start_) addIncomingGuards();
+  }
+
+  inline Sink& result() noexcept { return results_; }
 
   inline void consider(const double* const start, const double* const stop, const size_t index) noexcept
   {
@@ -135,36 +416,346 @@ struct DefaultEdgesWithoutTime
     for (size_t i = 0; i < dof_; ++i)
       cost += std::abs(start[i] - stop[i]);
 
-    results_[layer_][count_].cost = cost;
-    results_[layer_][count_].idx = static_cast<unsigned>(index);
-    count_++;
+    push({cost, static_cast<unsigned>(index)});
+  }
+
+  Sink results_;
+  Dof dof_;
+
+protected:
+  inline void push(const Edge& edge)
+  {
+    if (max_out_edges_ == 0)
+    {
+      results_.push_back(edge);
+      return;
+    }
+
+    auto& in = cheapest_in_[edge.idx];
+    if (edge.cost < in.second.cost) in = std::make_pair(source_, edge);
+
+    if (has_threshold_ && !cheaper(edge, threshold_)) return;
+    row_.push_back(edge);
+    if (row_.size() == CANDIDATES_PER_KEPT_EDGE * max_out_edges_)
+    {
+      keepCheapest();
+      threshold_ = row_.back();
+      has_threshold_ = true;
+    }
+  }
+
+private:
+  // Ties go to the lower target, so that the edges kept don't depend on the order they come in
+  static bool cheaper(const Edge& a, const Edge& b) noexcept
+  {
+    return a.cost < b.cost || (a.cost == b.cost && a.idx < b.idx);
+  }
+
+  // Cuts the candidates down to the cheapest, leaving the costliest of those last and the others before it
+  void keepCheapest()
+  {
+    if (row_.size() <= max_out_edges_) return;
+    const auto last_kept = row_.begin() + (max_out_edges_ - 1);
+    std::nth_element(row_.begin(), last_kept, row_.end(), cheaper);
+    row_.erase(last_kept + 1, row_.end());
+  }
+
+  void addIncomingGuards()
+  {
+    std::vector<std::pair<unsigned, Edge>> guards;
+    for (size_t j = 0; j < has_incoming_.size(); ++j)
+    {
+      if (!has_incoming_[j] && cheapest_in_[j].second.cost != std::numeric_limits<double>::max())
+        guards.push_back(cheapest_in_[j]);
+    }
+    std::stable_sort(guards.begin(), guards.end(),
+                     [](const std::pair<unsigned, Edge>& a, const std::pair<unsigned, Edge>& b) {
+                       return a.first < b.first;
+                     });
+    results_.insertEdges(guards);
   }
 
-  std::vector<LadderGraph::EdgeList> results_;
-  size_t dof_;
-  size_t count_;
-  size_t layer_;
+  size_t n_start_;
+  size_t max_out_edges_;
+  unsigned source_; // the vertex whose edges are being built
+  std::vector<Edge> row_; // the candidate edges of the current vertex, when they are capped
+  Edge threshold_; // the costliest edge kept so far, once the candidates have been cut
+  bool has_threshold_;
+  std::vector<std::pair<unsigned, Edge>> cheapest_in_; // the cheapest edge into each target & its source
+  std::vector<char> has_incoming_; // whether a kept edge reaches each target
 };
 
-struct CustomEdgesWithoutTime : public DefaultEdgesWithoutTime
+template <typename Sink, typename Dof = DynamicDof, typename Cost = descartes_planner::BatchCostFunction>
+struct BasicCustomEdgesWithoutTime : public BasicDefaultEdgesWithoutTime<Sink, Dof>
 {
-  CustomEdgesWithoutTime(const size_t n_start,
-                       const size_t n_end,
-                       const size_t dof,
-                          descartes_planner::CostFunction fn)
-    : DefaultEdgesWithoutTime(n_start, n_end, dof), custom_cost_fn(fn)
+  BasicCustomEdgesWithoutTime(const size_t n_start,
+                              const size_t n_end,
+                              const size_t dof,
+                              Cost fn,
+                              const size_t max_out_edges = 0)
+    : BasicDefaultEdgesWithoutTime<Sink, Dof>(n_start, n_end, dof, max_out_edges), custom_cost_fn(std::move(fn))
+    , end_joints_(nullptr)
   {}
 
-  inline void consider(const double* const start, const double* const stop, const size_t index) noexcept
+  inline void consider(const double * const start, const double * const stop, const size_t index) noexcept
+  {
+    double cost;
+    custom_cost_fn(start, stop, 1, &cost);
+    this->push({cost, static_cast<unsigned>(index)});
+  }
+
+  /**
+   * @brief setTargets Sets the destination rung for considerAll(). 'end_joints' must outlive the calls to it.
+   */
+  void setTargets(const double* const end_joints, const size_t n_end)
+  {
+    end_joints_ = end_joints;
+    costs_.resize(n_end);
+  }
+
+  /**
+   * @brief considerAll Connects 'start' to every vertex of the destination rung with a single call of the cost
+   *        function
+   */
+  inline void considerAll(const double* const start)
   {
-    results_[layer_][count_].cost = custom_cost_fn(start, stop);
-    results_[layer_][count_].idx = static_cast<unsigned>(index);
-    count_++;
+    custom_cost_fn(start, end_joints_, costs_.size(), costs_.data());
+    for (size_t j = 0; j < costs_.size(); ++j)
+      this->push({costs_[j], static_cast<unsigned>(j)});
   }
 
-  descartes_planner::CostFunction custom_cost_fn; // TODO: Header doesn't stand on its own
+  Cost custom_cost_fn; // TODO: Header doesn't stand on its own
+  const double* end_joints_;
+  std::vector<double> costs_;
 };
 
+/**
+ * @brief buildEdges Passes every pair of vertices from two rungs to an edge builder, row by row. The rows of the
+ *        sources for which 'skip_source(i)' returns true are closed without edges.
+ */
+template <typename Builder, typename SkipSource>
+void buildEdges(Builder& builder, const std::vector<double>& start_joints, const std::vector<double>& end_joints,
+                const size_t dof, SkipSource&& skip_source)
+{
+  const auto n_start = start_joints.size() / dof;
+  const auto n_end = end_joints.size() / dof;
+  for (size_t i = 0; i < n_start; ++i)
+  {
+    if (!skip_source(i))
+    {
+      for (size_t j = 0; j < n_end; ++j)
+        builder.consider(&start_joints[i * dof], &end_joints[j * dof], j);
+    }
+    builder.next(i);
+  }
+}
+
+namespace detail
+{
+template <typename Builder, typename SkipSource>
+void buildEdgeRows(Builder& builder, const std::vector<double>& start_joints, const std::vector<double>& end_joints,
+                   const size_t dof, SkipSource&& skip_source)
+{
+  const auto n_start = start_joints.size() / dof;
+  builder.setTargets(end_joints.data(), end_joints.size() / dof);
+  for (size_t i = 0; i < n_start; ++i)
+  {
+    if (!skip_source(i)) builder.considerAll(&start_joints[i * dof]);
+    builder.next(i);
+  }
+}
+
+// The same for the timed builders, which look for the edges of EDGE_TILE_SOURCES sources at a time
+template <typename Builder, typename SkipSource>
+void buildEdgeTiles(Builder& builder, const std::vector<double>& start_joints, const std::vector<double>& end_joints,
+                    const size_t dof, SkipSource&& skip_source)
+{
+  const auto n_start = start_joints.size() / dof;
+  builder.setTargets(end_joints.data(), end_joints.size() / dof);
+
+  const double* starts[EDGE_TILE_SOURCES];
+  for (size_t first = 0; first < n_start; first += EDGE_TILE_SOURCES)
+  {
+    const auto last = n_start - first < EDGE_TILE_SOURCES ? n_start : first + EDGE_TILE_SOURCES;
+    size_t n_sources = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+      if (!skip_source(i)) starts[n_sources++] = &start_joints[i * dof];
+    }
+
+    builder.findTargets(starts, n_sources);
+    size_t s = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+      if (!skip_source(i))
+      {
+        builder.pushTargets(s, starts[s]);
+        ++s;
+      }
+      builder.next(i);
+    }
+  }
+}
+}
+
+/**
+ * @brief buildEdges With timing, only a few vertex pairs usually satisfy the velocity limits. Sources are tested a
+ *        tile at a time with findTargets(), which looks the destination rung up in a SortedJointIndex when it is
+ *        large and spreads out enough. The edges are those of the pairwise loop, though the index orders the edges of
+ *        a vertex by the sorted joint rather than by target.
+ */
+template <typename Sink, typename Dof, typename SkipSource>
+void buildEdges(BasicDefaultEdgesWithTime<Sink, Dof>& builder, const std::vector<double>& start_joints,
+                const std::vector<double>& end_joints, const size_t dof, SkipSource&& skip_source)
+{
+  detail::buildEdgeTiles(builder, start_joints, end_joints, dof, skip_source);
+}
+
+/**
+ * @brief buildEdges With a custom cost, the cost function is called once per row on the vertices that passed the
+ *        velocity limits
+ */
+template <typename Sink, typename Dof, typename Cost, typename SkipSource>
+void buildEdges(BasicCustomEdgesWithTime<Sink, Dof, Cost>& builder, const std::vector<double>& start_joints,
+                const std::vector<double>& end_joints, const size_t dof, SkipSource&& skip_source)
+{
+  detail::buildEdgeTiles(builder, start_joints, end_joints, dof, skip_source);
+}
+
+template <typename Sink, typename Dof, typename Cost, typename SkipSource>
+void buildEdges(BasicCustomEdgesWithoutTime<Sink, Dof, Cost>& builder, const std::vector<double>& start_joints,
+                const std::vector<double>& end_joints, const size_t dof, SkipSource&& skip_source)
+{
+  detail::buildEdgeRows(builder, start_joints, end_joints, dof, skip_source);
+}
+
+template <typename Builder>
+void buildEdges(Builder& builder, const std::vector<double>& start_joints, const std::vector<double>& end_joints,
+                const size_t dof)
+{
+  buildEdges(builder, start_joints, end_joints, dof, [](size_t) { return false; });
+}
+
+using DefaultEdgesWithTime = BasicDefaultEdgesWithTime<RungEdges>;
+using CustomEdgesWithTime = BasicCustomEdgesWithTime<RungEdges>;
+using DefaultEdgesWithoutTime = BasicDefaultEdgesWithoutTime<RungEdges>;
+using CustomEdgesWithoutTime = BasicCustomEdgesWithoutTime<RungEdges>;
+
+namespace detail
+{
+template <typename Sink, typename Dof, typename Cost, typename Fn>
+void withEdgeBuilder(const size_t n_start,
+                     const size_t n_end,
+                     const size_t dof,
+                     const descartes_core::TimingConstraint& tm,
+                     const std::vector<double>& joint_vel_limits,
+                     const Cost* cost_fn,
+                     const size_t max_out_edges,
+                     Fn&& fn)
+{
+  if (!cost_fn && tm.isSpecified())
+  {
+    BasicDefaultEdgesWithTime<Sink, Dof> builder (n_start, n_end, dof, tm.upper, joint_vel_limits);
+    fn(builder);
+  }
+  else if (cost_fn && tm.isSpecified())
+  {
+    BasicCustomEdgesWithTime<Sink, Dof, Cost> builder (n_start, n_end, dof, tm.upper, joint_vel_limits, *cost_fn);
+    fn(builder);
+  }
+  else if (!cost_fn && !tm.isSpecified())
+  {
+    BasicDefaultEdgesWithoutTime<Sink, Dof> builder (n_start, n_end, dof, max_out_edges);
+    fn(builder);
+  }
+  else
+  {
+    BasicCustomEdgesWithoutTime<Sink, Dof, Cost> builder (n_start, n_end, dof, *cost_fn, max_out_edges);
+    fn(builder);
+  }
+}
+
+// Picks the builders specialized for 6 and 7 joints, or the generic ones for any other number
+template <typename Sink, typename Cost, typename Fn>
+void withEdgeBuilderOfDof(const size_t n_start,
+                          const size_t n_end,
+                          const size_t dof,
+                          const descartes_core::TimingConstraint& tm,
+                          const std::vector<double>& joint_vel_limits,
+                          const Cost* cost_fn,
+                          const size_t max_out_edges,
+                          Fn&& fn)
+{
+  switch (dof)
+  {
+    case 6:
+      withEdgeBuilder<Sink, FixedDof<6>>(n_start, n_end, dof, tm, joint_vel_limits, cost_fn, max_out_edges,
+                                          std::forward<Fn>(fn));
+      break;
+    case 7:
+      withEdgeBuilder<Sink, FixedDof<7>>(n_start, n_end, dof, tm, joint_vel_limits, cost_fn, max_out_edges,
+                                          std::forward<Fn>(fn));
+      break;
+    default:
+      withEdgeBuilder<Sink, DynamicDof>(n_start, n_end, dof, tm, joint_vel_limits, cost_fn, max_out_edges,
+                                         std::forward<Fn>(fn));
+  }
+}
+}
+
+/**
+ * @brief withEdgeBuilder Constructs the edge builder matching the timing of the destination rung and the presence
+ *        of a custom cost function, with results going to a 'Sink', and passes it to 'fn'. Robots with 6 or 7
+ *        joints get builders specialized for them, so 'fn' must accept any builder type.
+ */
+template <typename Sink, typename Fn>
+void withEdgeBuilder(const size_t n_start,
+                     const size_t n_end,
+                     const size_t dof,
+                     const descartes_core::TimingConstraint& tm,
+                     const std::vector<double>& joint_vel_limits,
+                     const descartes_planner::BatchCostFunction& cost_fn,
+                     Fn&& fn)
+{
+  detail::withEdgeBuilderOfDof<Sink>(n_start, n_end, dof, tm, joint_vel_limits, cost_fn ? &cost_fn : nullptr, 0,
+                                     std::forward<Fn>(fn));
+}
+
+/**
+ * @brief withEdgeBuilder The same, keeping only the 'max_out_edges' cheapest edges out of each vertex when the
+ *        destination rung has no timing, see BasicDefaultEdgesWithoutTime. Timed edges are already limited by the
+ *        joint velocities and are all kept. 0 keeps every edge.
+ */
+template <typename Sink, typename Fn>
+void withEdgeBuilder(const size_t n_start,
+                     const size_t n_end,
+                     const size_t dof,
+                     const descartes_core::TimingConstraint& tm,
+                     const std::vector<double>& joint_vel_limits,
+                     const descartes_planner::BatchCostFunction& cost_fn,
+                     const size_t max_out_edges,
+                     Fn&& fn)
+{
+  detail::withEdgeBuilderOfDof<Sink>(n_start, n_end, dof, tm, joint_vel_limits, cost_fn ? &cost_fn : nullptr,
+                                     max_out_edges, std::forward<Fn>(fn));
+}
+
+/**
+ * @brief withEdgeBuilder The same with a custom cost functor, called like a BatchCostFunction, whose calls the
+ *        builders can inline
+ */
+template <typename Sink, typename Cost, typename Fn>
+void withEdgeBuilder(const size_t n_start,
+                     const size_t n_end,
+                     const size_t dof,
+                     const descartes_core::TimingConstraint& tm,
+                     const std::vector<double>& joint_vel_limits,
+                     const Cost& cost_fn,
+                     Fn&& fn)
+{
+  detail::withEdgeBuilderOfDof<Sink>(n_start, n_end, dof, tm, joint_vel_limits, &cost_fn, 0, std::forward<Fn>(fn));
+}
+
 }
 
 #endif // PLANNING_GRAPH_EDGE_POLICY_H
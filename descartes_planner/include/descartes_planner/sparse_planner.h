@@ -27,6 +27,7 @@
 
 #include <descartes_core/path_planner_base.h>
 #include <descartes_planner/planning_graph.h>
+#include <descartes_planner/trajectory_index.h>
 #include <tuple>
 
 namespace descartes_planner
@@ -45,8 +46,11 @@ public:
   virtual bool initialize(descartes_core::RobotModelConstPtr model);
   virtual bool initialize(descartes_core::RobotModelConstPtr model,
                           descartes_planner::CostFunction cost_function_callback);
+  virtual bool initialize(descartes_core::RobotModelConstPtr model,
+                          descartes_planner::BatchCostFunction cost_function_callback);
   virtual bool setConfig(const descartes_core::PlannerConfig& config);
   virtual void getConfig(descartes_core::PlannerConfig& config) const;
+  using PathPlannerBase::planPath;
   virtual bool planPath(const std::vector<descartes_core::TrajectoryPtPtr>& traj);
   virtual bool addAfter(const descartes_core::TrajectoryPt::ID& ref_id, descartes_core::TrajectoryPtPtr cp);
   virtual bool addBefore(const descartes_core::TrajectoryPt::ID& ref_id, descartes_core::TrajectoryPtPtr cp);
@@ -92,7 +96,8 @@ protected:
   descartes_core::PlannerConfig config_;
   boost::shared_ptr<PlanningGraph> planning_graph_;
   std::vector<descartes_core::TrajectoryPtPtr> cart_points_;
-  SolutionArray sparse_solution_array_;
+  TrajectoryIndex cart_points_index_; // positions in cart_points_, see getDensePointIndex()
+  SolutionArray sparse_solution_array_; // sorted by dense index
   std::map<descartes_core::TrajectoryPt::ID, descartes_trajectory::JointTrajectoryPt> joint_points_map_;
   std::vector<descartes_core::TimingConstraint> timing_cache_;
 };
@@ -0,0 +1,119 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_STREAMING_LADDER_SOLVER_H
+#define DESCARTES_STREAMING_LADDER_SOLVER_H
+
+#include "descartes_planner/planning_graph.h"
+#include <cstdint>
+#include <functional>
+
+namespace descartes_planner
+{
+
+/**
+ * @brief CompactIndexStore holds one row of vertex indices per rung, each stored with the narrowest integer type
+ *        (8, 16 or 32 bits) able to index the rung the values point into.
+ */
+class CompactIndexStore
+{
+public:
+  using size_type = std::size_t;
+
+  /**
+   * @brief append Adds a row of 'n' indices, all of which must be smaller than 'range'
+   */
+  void append(const unsigned* indices, size_type n, size_type range);
+
+  unsigned get(size_type row, size_type index) const noexcept;
+
+  size_type size() const noexcept { return rows_.size(); }
+
+  void clear();
+
+  /**
+   * @brief memoryUsage The number of bytes currently allocated by this store
+   */
+  size_type memoryUsage() const noexcept;
+
+private:
+  struct Row
+  {
+    std::uint64_t offset : 56; // byte offset into data_
+    std::uint64_t width : 8; // bytes per index
+  };
+
+  std::vector<Row> rows_;
+  std::vector<std::uint8_t> data_;
+};
+
+/**
+ * @brief StreamingLadderSolver finds the same shortest path as a PlanningGraph, but consumes the rungs one at a time
+ *        and never holds the whole ladder: only the joint solutions and distances of two consecutive rungs, plus the
+ *        predecessor of every vertex in a CompactIndexStore. Edges are evaluated on the fly as in
+ *        PlanningGraph::setImplicitEdges(). Once the last rung is relaxed, the index of the chosen vertex in each rung
+ *        is recovered from the predecessors, and a final pass asks the producer for every rung again to recover its
+ *        joint values.
+ *
+ *        Memory use is thus independent of the number of edges and a few bytes per vertex along the path, e.g. for
+ *        8 IK solutions per point 8 bytes per point, in exchange for computing IK twice.
+ */
+class StreamingLadderSolver
+{
+public:
+  /**
+   * @brief Produces the joint solutions of rung 'index', one after another in 'joints', and its timing. Must
+   *        produce the same solutions in the same order every time it is called for a given rung.
+   * @return False if the rung has no solutions
+   */
+  using RungProducer =
+      std::function<bool(std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing)>;
+
+  StreamingLadderSolver(descartes_core::RobotModelConstPtr model,
+                        CostFunction cost_function_callback = CostFunction{});
+
+  StreamingLadderSolver(descartes_core::RobotModelConstPtr model, BatchCostFunction cost_function_callback);
+
+  /**
+   * @brief solve Finds the shortest path through 'n_rungs' rungs generated by 'producer'
+   * @param cost The cost of the path
+   * @param path The chosen joint solution of each rung
+   * @return False if a rung has no solutions, if there is no path, or if the producer gives a rung a different number
+   *         of solutions on the final pass
+   */
+  bool solve(std::size_t n_rungs, const RungProducer& producer, double& cost,
+             std::list<descartes_trajectory::JointTrajectoryPt>& path);
+
+  /**
+   * @brief solve Finds the shortest path through 'points', computing their IK twice
+   */
+  bool solve(const std::vector<descartes_core::TrajectoryPtPtr>& points, double& cost,
+             std::list<descartes_trajectory::JointTrajectoryPt>& path);
+
+  /**
+   * @brief predecessorMemory The number of bytes used for predecessors by the last call to solve()
+   */
+  std::size_t predecessorMemory() const noexcept { return predecessors_.memoryUsage(); }
+
+private:
+  descartes_core::RobotModelConstPtr robot_model_;
+  BatchCostFunction custom_cost_function_;
+  CompactIndexStore predecessors_;
+};
+
+} // descartes_planner
+#endif
@@ -0,0 +1,184 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_TASK_POOL_H
+#define DESCARTES_TASK_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace descartes_planner
+{
+
+/**
+ * @brief TaskStats describes the last TaskPool::parallelFor()
+ */
+struct TaskStats
+{
+  std::size_t n_tasks = 0;
+  std::size_t n_steals = 0;               // the times a thread took tasks from the share of another
+  double seconds = 0.0;                   // wall time of the whole loop
+  std::vector<double> task_seconds;       // time spent in each task, by index
+  std::vector<double> thread_busy_seconds; // time each thread spent in tasks, the caller of parallelFor() first
+};
+
+/**
+ * @brief CancellationToken lets the tasks of a loop stop the others: once it is cancelled, TaskPool::parallelFor()
+ *        skips the tasks that haven't started yet, and long running tasks can poll cancelled() to return early. A
+ *        token can also cancel itself at a deadline, and be linked to a parent token whose cancellation it shares.
+ */
+class CancellationToken
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** @param parent If not null, this token is cancelled along with it */
+  explicit CancellationToken(const CancellationToken* parent = nullptr)
+    : cancelled_(false), has_deadline_(false), parent_(parent)
+  {}
+
+  /** @brief A token that is cancelled once 'deadline' has passed, or along with 'parent' */
+  explicit CancellationToken(Clock::time_point deadline, const CancellationToken* parent = nullptr)
+    : cancelled_(false), has_deadline_(true), deadline_(deadline), parent_(parent)
+  {}
+
+  void cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+
+  bool cancelled() const noexcept
+  {
+    return cancelled_.load(std::memory_order_relaxed) || expired() || (parent_ && parent_->cancelled());
+  }
+
+  /** @brief Whether the deadline of this token or of a parent has passed */
+  bool expired() const noexcept
+  {
+    return (has_deadline_ && Clock::now() >= deadline_) || (parent_ && parent_->expired());
+  }
+
+private:
+  std::atomic<bool> cancelled_;
+  bool has_deadline_;
+  Clock::time_point deadline_;
+  const CancellationToken* parent_;
+};
+
+/**
+ * @brief TaskPool runs the parallel loops of a planner on a fixed number of threads, so that several planners can
+ *        share a machine without each of them taking every core. The indices of a loop start out split evenly
+ *        between the threads, each working through its share in order. A thread that runs out steals the upper half
+ *        of the largest remaining share, which balances tasks of very uneven cost, such as IK that is ten times
+ *        slower for some points than for others.
+ *
+ *        The worker threads are started by the first loop that needs them. Loops of a pool run one at a time, and a
+ *        loop started from within a task runs serially on the thread of that task.
+ */
+class TaskPool
+{
+public:
+  /**
+   * @param n_threads The threads running a loop, counting the caller of parallelFor(); 0 for one per hardware thread
+   * @param cpus If not empty, the worker threads are pinned to these CPUs in turn. The caller is left alone.
+   */
+  explicit TaskPool(unsigned n_threads = 0, std::vector<int> cpus = std::vector<int>());
+  ~TaskPool();
+
+  TaskPool(const TaskPool&) = delete;
+  TaskPool& operator=(const TaskPool&) = delete;
+
+  unsigned threads() const noexcept { return n_threads_; }
+
+  const std::vector<int>& cpus() const noexcept { return cpus_; }
+
+  /**
+   * @brief parallelFor Calls fn(i) for every i in [0, n), returning once all calls have. If a call throws, the tasks
+   *        that haven't started yet are skipped and the first exception is rethrown.
+   */
+  void parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn);
+
+  /**
+   * @brief parallelFor The same, also skipping the tasks that haven't started once 'cancel' is cancelled
+   */
+  void parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn, const CancellationToken& cancel);
+
+  /**
+   * @brief currentSlot The slot, in [0, threads()), of the thread running the calling task: 0 for the caller of
+   *        parallelFor() and outside of any loop. Two tasks of a loop with the same slot never run at the same time,
+   *        so per thread resources can be indexed with it.
+   */
+  static unsigned currentSlot() noexcept;
+
+  /**
+   * @brief lastStats The timing of the last loop. Not to be called while a loop runs.
+   */
+  const TaskStats& lastStats() const noexcept { return stats_; }
+
+private:
+  struct Share;
+
+  // Destroys and frees the shares, which are allocated on cache lines by makeShares()
+  struct ShareDeleter
+  {
+    unsigned n;
+    void operator()(Share* shares) const;
+  };
+  using SharePtr = std::unique_ptr<Share[], ShareDeleter>;
+  static SharePtr makeShares(unsigned n);
+
+  void run(std::size_t n, const std::function<void(std::size_t)>& fn, const CancellationToken* cancel);
+  void startWorkers();
+  void workerLoop(unsigned slot);
+  void runShare(unsigned slot);
+  bool steal(unsigned slot, std::size_t& index);
+
+  unsigned n_threads_;
+  std::vector<int> cpus_;
+  std::vector<std::thread> workers_;
+  SharePtr shares_; // the tasks left to each thread
+
+  std::mutex run_mutex_; // held for the whole of a loop
+  std::mutex mutex_;     // guards the fields below
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::uint64_t loop_id_;
+  unsigned active_workers_;
+  bool stop_;
+  const std::function<void(std::size_t)>* fn_;
+  const CancellationToken* cancel_;
+  std::exception_ptr error_;
+  std::atomic<bool> failed_;
+  std::atomic<std::size_t> n_steals_;
+
+  TaskStats stats_;
+};
+
+/**
+ * @brief parseCpuList Reads a list of CPUs such as "0,2,4-7"; an empty string is an empty list
+ * @return False if the list is malformed
+ */
+bool parseCpuList(const std::string& list, std::vector<int>& cpus);
+
+} // descartes_planner
+#endif
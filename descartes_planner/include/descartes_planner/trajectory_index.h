@@ -0,0 +1,129 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef DESCARTES_TRAJECTORY_INDEX_H
+#define DESCARTES_TRAJECTORY_INDEX_H
+
+#include "descartes_core/trajectory_id.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace descartes_planner
+{
+
+/**
+ * @brief TrajectoryIndex maps the IDs of a sequence of points to their positions, for a container that reports its
+ *        edits. Inserting or removing an element only marks the positions after it as out of date; they are
+ *        re-indexed by the next lookup that needs them, so a series of edits followed by a lookup costs one pass
+ *        over the affected tail. Replacing the ID of an element in place costs O(1).
+ *
+ *        Entries are checked against the container before they are returned, so a stale one can never produce a
+ *        wrong position. If IDs are duplicated, the first position is returned. Nil IDs are not indexed.
+ */
+class TrajectoryIndex
+{
+public:
+  using size_type = std::size_t;
+
+  TrajectoryIndex() : valid_(0) {}
+
+  /**
+   * @brief invalidateFrom Notifies that the elements at and after 'index' moved, e.g. after an insert or erase
+   */
+  void invalidateFrom(size_type index) noexcept { valid_ = std::min(valid_, index); }
+
+  /**
+   * @brief assign Notifies that the element at 'index' now has the ID 'id', its position being unchanged
+   */
+  void assign(size_type index, descartes_core::TrajectoryID id)
+  {
+    if (index >= valid_ || id.is_nil()) return;
+
+    // Keep an earlier copy of the ID. If the entry is stale, find() notices it.
+    auto it = ids_.find(id);
+    if (it == ids_.end()) ids_.emplace(id, index);
+    else if (it->second >= index) it->second = index;
+  }
+
+  void clear()
+  {
+    ids_.clear();
+    valid_ = 0;
+  }
+
+  /**
+   * @brief find Looks up 'id' in a container of 'size' elements
+   * @param id_at Returns the ID of the element at a given position
+   * @return std::pair(index, was_found)
+   */
+  template <typename IdAt>
+  std::pair<size_type, bool> find(descartes_core::TrajectoryID id, size_type size, IdAt&& id_at)
+  {
+    valid_ = std::min(valid_, size);
+
+    auto it = ids_.find(id);
+    if (it != ids_.end() && it->second < valid_)
+    {
+      if (id_at(it->second) == id) return {it->second, true};
+
+      // The element was assigned another ID. As entries point to the first copy of an ID, any other copy comes later.
+      valid_ = it->second;
+      ids_.erase(it);
+    }
+    if (valid_ == size) return {0u, false};
+
+    // Index the out of date tail. Going backwards lets the first of duplicated IDs win, unless an earlier copy is
+    // already indexed. A stale entry met on the way may hide a copy between it and the tail, so the pass restarts
+    // from there.
+    for (;;)
+    {
+      if (valid_ == 0) ids_.clear();
+
+      size_type restart = valid_;
+      for (size_type i = size; i-- > valid_;)
+      {
+        const auto id_i = id_at(i);
+        if (id_i.is_nil()) continue;
+
+        auto inserted = ids_.emplace(id_i, i);
+        auto& entry = inserted.first->second;
+        if (inserted.second) continue;
+        if (entry < valid_)
+        {
+          if (id_at(entry) == id_i) continue;
+          restart = std::min(restart, entry);
+        }
+        entry = i;
+      }
+
+      if (restart == valid_) break;
+      valid_ = restart;
+    }
+    valid_ = size;
+
+    it = ids_.find(id);
+    if (it != ids_.end() && id_at(it->second) == id) return {it->second, true};
+    return {0u, false};
+  }
+
+private:
+  std::unordered_map<descartes_core::TrajectoryID, size_type> ids_;
+  size_type valid_; // the entries of elements [0, valid_) are up to date
+};
+
+} // descartes_planner
+#endif
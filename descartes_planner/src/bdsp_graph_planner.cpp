@@ -5,12 +5,16 @@
  *      Author: Jorge Nicho
  */
 
+#include <algorithm>
+
 #include <numeric>
 
 #include <fstream>
 
 #include <memory>
 
+#include <atomic>
+
 #include <console_bridge/console.h>
 
 #include <boost/format.hpp>
@@ -25,11 +29,49 @@ static const int VIRTUAL_VERTEX_INDEX = -1;
 namespace descartes_planner
 {
 
+namespace
+{
+// the number of vertices the search examines between two looks at the clock
+const std::size_t DEADLINE_CHECK_INTERVAL = 256;
+
+// the number of segments whose edges are evaluated ahead of the connecting pass, per thread of the pool
+const std::size_t SEGMENTS_PER_THREAD = 4;
+
+struct DeadlinePassed {};
+
+/**
+ * @brief Stops the search by throwing DeadlinePassed once the deadline has passed, the way boost graph algorithms
+ *        are meant to be interrupted
+ */
+class DeadlineVisitor: public boost::default_dijkstra_visitor
+{
+public:
+  explicit DeadlineVisitor(std::chrono::steady_clock::time_point deadline):
+    deadline_(deadline)
+  {
+  }
+
+  template<typename Vertex, typename Graph>
+  void examine_vertex(Vertex, const Graph&)
+  {
+    if(++examined_ % DEADLINE_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline_)
+    {
+      throw DeadlinePassed();
+    }
+  }
+
+private:
+  std::chrono::steady_clock::time_point deadline_;
+  std::size_t examined_ = 0;
+};
+}
+
 template<typename FloatT>
 descartes_planner::BDSPGraphPlanner<FloatT>::BDSPGraphPlanner(typename std::shared_ptr< SamplesContainer<FloatT> > container,
-                                                    bool report_all_failures):
+                                                    bool report_all_failures, BDSPBackend backend):
   container_(container),
-  report_all_failures_(report_all_failures)
+  report_all_failures_(report_all_failures),
+  backend_(backend)
 {
   if(container_ == nullptr)
   {
@@ -64,6 +106,7 @@ void descartes_planner::BDSPGraphPlanner<FloatT>::setup(std::vector< typename Po
 
   failed_points_.clear();
   failed_edges_.clear();
+  timed_out_ = false;
 
   // setting up point sampler container
   points_.clear();
@@ -103,36 +146,81 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector< typename Po
 }
 
 template<typename FloatT>
-std::vector< EdgeProperties<FloatT> > descartes_planner::BDSPGraphPlanner<FloatT>::filterDisconnectedEdges(
-    const std::vector< EdgeProperties<FloatT> >& edges,const std::map<std::size_t, VertexProperties>& connected_src_vertices,
-    std::uint32_t current_vertex_count) const
+bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector< typename PointSampler<FloatT>::Ptr >& points,
+           typename EdgeEvaluator<FloatT>::ConstPtr edge_evaluator, std::chrono::steady_clock::time_point deadline)
 {
-  auto new_edges = edges;
-  auto start_loc = new_edges.begin();
-  auto end_loc = new_edges.end();
-  auto new_end_loc = std::remove_if(new_edges.begin(), new_edges.end(), [&](const EdgeProperties<FloatT>& edge){
-    int src_idx = edge.src_vtx.sample_index + current_vertex_count;
-    return connected_src_vertices.count(src_idx) == 0;
-  });
-
-  new_edges.erase(new_end_loc, end_loc);
-  return new_edges;
+  std::vector<typename EdgeEvaluator<FloatT>::ConstPtr> edge_evaluators = {edge_evaluator};
+  return build(points, edge_evaluators, deadline);
 }
 
 template<typename FloatT>
 bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename PointSampler<FloatT>::Ptr>& points,
                                                    std::vector<typename EdgeEvaluator<FloatT>::ConstPtr>& edge_evaluators)
+{
+  return build(points, edge_evaluators, std::chrono::steady_clock::time_point::max());
+}
+
+template<typename FloatT>
+void descartes_planner::BDSPGraphPlanner<FloatT>::filterDisconnectedEdges(std::vector< CompactEdge<FloatT> >& edges,
+                                                                     const std::vector<bool>& connected_src_samples) const
+{
+  auto new_end_loc = std::remove_if(edges.begin(), edges.end(), [&](const CompactEdge<FloatT>& edge){
+    return !connected_src_samples[edge.src];
+  });
+  edges.erase(new_end_loc, edges.end());
+}
+
+template<typename FloatT>
+bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename PointSampler<FloatT>::Ptr>& points,
+                                                   std::vector<typename EdgeEvaluator<FloatT>::ConstPtr>& edge_evaluators,
+                                                   std::chrono::steady_clock::time_point deadline)
 {
   setup(points, edge_evaluators);
+  CancellationToken cancel(deadline);
+  auto timeout = [this](const char* stage){
+    CONSOLE_BRIDGE_logError("The deadline passed while %s", stage);
+    timed_out_ = true;
+    return false;
+  };
 
   //// adding virtual vertex
   graph_.clear();
+  layers_.clear();
+  if(backend_ == BDSPBackend::LAYERED_DAG)
+  {
+    layers_.resize(points_.empty() ? 0 : points_.size() - 1);
+  }
+
+  // generating samples now, in parallel if there's a pool. Points left out after a failure are generated in order
+  // below, so that the same failures are reported as without a pool.
+  std::vector<typename PointSampleGroup<FloatT>::Ptr> generated(points_.size());
+  std::vector<char> was_generated(points_.size(), 0);
+  if(task_pool_)
+  {
+    std::atomic<bool> failed(false);
+    task_pool_->parallelFor(points_.size(), [&](std::size_t i){
+      if(failed && !report_all_failures_)
+      {
+        return;
+      }
+      typename PointSampler<FloatT>::Ptr sampler = points_[i]->clone(TaskPool::currentSlot());
+      generated[i] = (sampler ? sampler : points_[i])->generate();
+      was_generated[i] = 1;
+      if(!generated[i] || generated[i]->values.empty())
+      {
+        failed = true;
+      }
+    }, cancel);
+  }
 
-  // generating samples now
   std::size_t max_num_samples = 0;
   for(std::size_t  i = 0; i < points_.size(); i++)
   {
-    typename PointSampleGroup<FloatT>::Ptr samples = points_[i]->generate();
+    if(!was_generated[i] && cancel.cancelled())
+    {
+      return timeout("generating samples");
+    }
+    typename PointSampleGroup<FloatT>::Ptr samples = was_generated[i] ? generated[i] : points_[i]->generate();
     if(!samples || samples->values.empty())
     {
       CONSOLE_BRIDGE_logError("Failed to generate samples for point %lu",i);
@@ -143,6 +231,7 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
       }
       return false;
     }
+    samples->point_id = i;
     container_->at(i) = samples;
     max_num_samples = max_num_samples < samples->num_samples ? samples->num_samples : max_num_samples;
   }
@@ -160,15 +249,51 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
 
   std::uint32_t vertex_count = 1;
   bool add_virtual_vertex = true;
-  std::map<std::size_t, VertexProperties> src_vertices_added;
-  std::map<std::size_t, VertexProperties> dst_vertices_added;
-  std::vector<bool> dst_sample_indices_added(max_num_samples, false);
+  // the samples of the source point reached by the previous segment and those of the destination point reached by
+  // the current one, by sample index
+  std::vector<bool> src_samples_reached(max_num_samples, false);
+  std::vector<bool> dst_samples_reached(max_num_samples, false);
+  std::size_t num_dst_reached = 0;
+  std::vector<bool> src_samples_added(max_num_samples, false); // connected to the virtual vertex
   std::vector<std::size_t> src_vertices_disconnected;
   src_vertices_disconnected.reserve(max_num_samples);
 
+  // With a pool the edges of a window of segments are evaluated in parallel ahead of the loop below, which then only
+  // connects them. Segment i, between points i - 1 and i, is in the window when window_begin <= i < window_end.
+  // These evaluations don't know which source samples the previous segment left disconnected, their edges are
+  // filtered out afterwards instead.
+  const bool evaluate_ahead = task_pool_ && task_pool_->threads() > 1;
+  const std::size_t window_size = evaluate_ahead ? SEGMENTS_PER_THREAD * task_pool_->threads() : 0;
+  std::vector< std::vector< CompactEdge<FloatT> > > evaluated(window_size);
+  std::vector<char> was_evaluated(window_size, 0);
+  std::vector<char> evaluation_failed(window_size, 0);
+  std::size_t window_begin = 1, window_end = 1;
+
   // use samples to populate edges in order to build the search graph
   for(std::size_t i = 1; i < points_.size(); i++)
   {
+    if(cancel.cancelled())
+    {
+      return timeout("evaluating edges");
+    }
+
+    if(evaluate_ahead && i >= window_end)
+    {
+      window_begin = i;
+      window_end = std::min(i + window_size, points_.size());
+      std::fill(was_evaluated.begin(), was_evaluated.end(), 0);
+      task_pool_->parallelFor(window_end - window_begin, [&](std::size_t w){
+        const std::size_t segment = window_begin + w;
+        const auto& s1 = (*container_)[segment - 1];
+        const auto& s2 = (*container_)[segment];
+        if(!s1 || !s2 || s1->values.empty() || s2->values.empty())
+        {
+          return; // reported below
+        }
+        evaluation_failed[w] = !getEdgeEvaluator(segment - 1)->evaluateCompact(s1, s2, {}, evaluated[w]);
+        was_evaluated[w] = 1;
+      }, cancel);
+    }
 
     // geting samples for both points
     std::size_t p1_idx = i -1;
@@ -199,13 +324,20 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
       return false;
     }
 
+    // the destination samples the previous segment reached are the source samples of this one, none were reached
+    // before the first segment
+    const bool src_reach_known = num_dst_reached > 0;
+    src_samples_reached.swap(dst_samples_reached);
+    std::fill(dst_samples_reached.begin(), dst_samples_reached.end(), false);
+    num_dst_reached = 0;
+
     // updating vector of disconnected vertices in source point
     src_vertices_disconnected.clear();
-    if(!dst_vertices_added.empty())
+    if(src_reach_known)
     {
       for(std::size_t ii = 0; ii < samples1->num_samples; ii++)
       {
-        if(!dst_sample_indices_added[ii])
+        if(!src_samples_reached[ii])
         {
           src_vertices_disconnected.push_back(ii);
         }
@@ -214,15 +346,21 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
                              src_vertices_disconnected.size(), samples1->num_samples, p1_idx);
     }
 
-    // reseting array
-    std::fill(dst_sample_indices_added.begin(), dst_sample_indices_added.end(), false);
-
-    // evaluate edges
-    using EdgeProp = EdgeProperties<FloatT>;
-    auto edge_evaluator = getEdgeEvaluator(p1_idx);
-    std::vector< EdgeProperties<FloatT> > edges = edge_evaluator->evaluate(samples1, samples2, src_vertices_disconnected, {});
+    // evaluate edges, only the valid ones are kept
+    std::vector< CompactEdge<FloatT> > edges;
+    bool evaluated_ok;
+    if(evaluate_ahead && was_evaluated[i - window_begin])
+    {
+      edges = std::move(evaluated[i - window_begin]);
+      evaluated_ok = !evaluation_failed[i - window_begin];
+    }
+    else
+    {
+      auto edge_evaluator = getEdgeEvaluator(p1_idx);
+      evaluated_ok = edge_evaluator->evaluateCompact(samples1, samples2, src_vertices_disconnected, edges);
+    }
 
-    if(edges.empty())
+    if(!evaluated_ok)
     {
       CONSOLE_BRIDGE_logError("Edge evaluation between points %lu and %lu failed", samples1->point_id,
                               samples2->point_id);
@@ -240,27 +378,22 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
       continue;
     }
 
-    CONSOLE_BRIDGE_logDebug("Found %lu edges between nodes (%i, %i)",edges.size(),samples1->point_id ,samples2->point_id );
-
     // check that at least one is valid
-    std::size_t num_valid_edges = std::accumulate(edges.begin(), edges.end(),0,[](std::size_t c, const EdgeProperties<FloatT>& edge){
-      return c + (edge.valid ? 1 : 0);
-    });
-    if(num_valid_edges == 0)
+    if(edges.empty())
     {
       CONSOLE_BRIDGE_logError("Not a single valid edge was found between points (%lu, %lu)",p1_idx,p2_idx);
       return false;
     }
     else
     {
-      CONSOLE_BRIDGE_logDebug("Point (%lu, %lu) has %lu valid edges out of %lu = %i x %i",p1_idx,p2_idx,num_valid_edges,edges.size(),
+      CONSOLE_BRIDGE_logDebug("Point (%lu, %lu) has %lu valid edges out of %lu x %lu",p1_idx,p2_idx,edges.size(),
                                samples1->num_samples, samples2->num_samples);
     }
 
     // filtering disconnected edges
-    if(!dst_vertices_added.empty())
+    if(src_reach_known)
     {
-      edges = filterDisconnectedEdges(edges, dst_vertices_added, vertex_count);
+      filterDisconnectedEdges(edges, src_samples_reached);
       if(edges.empty())
       {
         CONSOLE_BRIDGE_logError("Edge between points %lu and %lu has no continuous path", samples1->point_id,
@@ -274,15 +407,16 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
       }
     }
 
-    src_vertices_added.clear();
-    dst_vertices_added.clear();
-    for(EdgeProp& edge: edges)
+    std::size_t num_edges_added = 0;
+    VertexProperties src_vtx, dst_vtx;
+    src_vtx.point_id = p1_idx;
+    dst_vtx.point_id = p2_idx;
+    if(backend_ == BDSPBackend::LAYERED_DAG)
+    {
+      layers_[p1_idx].reserve(edges.size());
+    }
+    for(const CompactEdge<FloatT>& edge: edges)
     {
-      if(!edge.valid)
-      {
-        continue;
-      }
-
       if(edge.weight >= std::numeric_limits<FloatT>::max())
       {
         CONSOLE_BRIDGE_logError("Found edge with very high weight value between points (%lu, %lu)", p1_idx, p2_idx);
@@ -291,8 +425,10 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
 
       bool added;
 
-      std::uint32_t src_vtx_index = edge.src_vtx.sample_index + vertex_count;
-      std::uint32_t dst_vtx_index =  edge.dst_vtx.sample_index + vertex_count + samples1->num_samples;
+      std::uint32_t src_vtx_index = edge.src + vertex_count;
+      std::uint32_t dst_vtx_index =  edge.dst + vertex_count + samples1->num_samples;
+      src_vtx.sample_index = edge.src;
+      dst_vtx.sample_index = edge.dst;
 
       if(src_vtx_index >= dst_vtx_index)
       {
@@ -306,50 +442,62 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
         return false;
       }
 
-      // adding edge to virtual vertex first
-      if(add_virtual_vertex && (src_vertices_added.count(src_vtx_index) == 0))
+      if(backend_ == BDSPBackend::LAYERED_DAG)
       {
-        typename GraphT::edge_descriptor e;
+        // the layers only need the sample indices, the sweep starts from every sample of the first point
+        layers_[p1_idx].push_back(edge);
+      }
+      else
+      {
+        // adding edge to virtual vertex first
+        if(add_virtual_vertex && !src_samples_added[edge.src])
+        {
+          typename GraphT::edge_descriptor e;
+
+
+          CONSOLE_BRIDGE_logDebug("Adding edge (0, %lu) to virtual vertex",src_vtx_index);
+          CompactEdge<FloatT> virtual_edge = {0, edge.src, 0};
+          boost::tie(e,added) = boost::add_edge(0, src_vtx_index, graph_);
+          if(!added)
+          {
+            CONSOLE_BRIDGE_logWarn("Edge (%lu, %lu) has already been added to the graphs",0,
+                                   src_vtx_index);
+            return false;
+          }
+          graph_[e] = virtual_edge;
+          graph_[0].point_id = VIRTUAL_VERTEX_INDEX;
+          graph_[0].sample_index = 0;
+          src_samples_added[edge.src] = true;
 
+        }
 
-        CONSOLE_BRIDGE_logDebug("Adding edge (0, %lu) to virtual vertex",src_vtx_index);
-        VertexProperties virtual_vertex_props;
-        virtual_vertex_props.point_id = VIRTUAL_VERTEX_INDEX;
-        virtual_vertex_props.sample_index = 0;
-        EdgeProperties<FloatT> virtual_edge= { .weight = 0, .valid = edge.valid,
-                                               .src_vtx = virtual_vertex_props, .dst_vtx = edge.src_vtx};
-        boost::tie(e,added) = boost::add_edge(0, src_vtx_index, graph_);
+        typename GraphT::edge_descriptor e;
+        boost::tie(e,added) = boost::add_edge(src_vtx_index, dst_vtx_index, graph_);
+        CONSOLE_BRIDGE_logDebug("Added edge (%lu, %lu)",src_vtx_index, dst_vtx_index);
         if(!added)
         {
-          CONSOLE_BRIDGE_logWarn("Edge (%lu, %lu) has already been added to the graphs",0,
-                                 src_vtx_index);
+          CONSOLE_BRIDGE_logError("Edge (%lu, %lu) has already been added to the graphs",src_vtx_index,
+                                  dst_vtx_index);
           return false;
         }
-        graph_[e] = virtual_edge;
-
+        else
+        {
+          // setting edge and vertex properties
+          graph_[e]= edge;
+          graph_[src_vtx_index] = src_vtx;
+          graph_[dst_vtx_index] = dst_vtx;
+        }
       }
 
-      typename GraphT::edge_descriptor e;
-      boost::tie(e,added) = boost::add_edge(src_vtx_index, dst_vtx_index, graph_);
-      CONSOLE_BRIDGE_logDebug("Added edge (%lu, %lu)",src_vtx_index, dst_vtx_index);
-      if(!added)
-      {
-        CONSOLE_BRIDGE_logError("Edge (%lu, %lu) has already been added to the graphs",src_vtx_index,
-                                dst_vtx_index);
-        return false;
-      }
-      else
+      num_edges_added++;
+      if(!dst_samples_reached[edge.dst])
       {
-        // setting edge properties
-        graph_[e]= edge;
+        dst_samples_reached[edge.dst] = true;
+        num_dst_reached++;
       }
-
-      src_vertices_added[src_vtx_index] = edge.src_vtx;
-      dst_vertices_added[dst_vtx_index] = edge.dst_vtx;
-      dst_sample_indices_added[edge.dst_vtx.sample_index] = true;
     }
 
-    if(src_vertices_added.empty() || dst_vertices_added.empty())
+    if(num_edges_added == 0)
     {
       CONSOLE_BRIDGE_logError("No continuous path could be found between points %i and %i",p1_idx, p2_idx);
       failed_edges_.push_back(p1_idx);
@@ -371,7 +519,15 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::build(std::vector<typename Poi
     return false;
   }
 
-  end_vertices_ = dst_vertices_added;
+  // the vertices of the last point's samples reached, vertex_count is now the first of them
+  end_vertices_.clear();
+  for(std::size_t ii = 0; samples2 && ii < samples2->num_samples; ii++)
+  {
+    if(dst_samples_reached[ii])
+    {
+      end_vertices_.push_back(vertex_count + ii);
+    }
+  }
   return true;
 }
 
@@ -416,11 +572,11 @@ void descartes_planner::BDSPGraphPlanner<FloatT>::writeGraphLogs(const std::vect
   for (boost::tie(ei, ei_end) = edges(graph_); ei != ei_end; ++ei) {
     typename GraphTraits::edge_descriptor e = *ei;
     typename GraphTraits::vertex_descriptor u = source(e, graph_), v = target(e, graph_);
-    EdgeProperties<FloatT> edge_props = graph_[e];
-    VertexProperties u_vertex = edge_props.src_vtx;
-    VertexProperties v_vertex = edge_props.dst_vtx;
+    const CompactEdge<FloatT>& edge_props = graph_[e];
+    const VertexProperties& u_vertex = graph_[u];
+    const VertexProperties& v_vertex = graph_[v];
 
-    if(u_vertex.point_id < 0 || v_vertex.point_id < 0)
+    if(static_cast<int>(u_vertex.point_id) < 0 || static_cast<int>(v_vertex.point_id) < 0)
     {
       continue;
     }
@@ -456,21 +612,44 @@ template<typename FloatT>
 bool descartes_planner::BDSPGraphPlanner<FloatT>::solve(
     std::vector<typename PointData<FloatT>::ConstPtr>& solution_points)
 {
+  return solve(solution_points, std::chrono::steady_clock::time_point::max());
+}
+
+template<typename FloatT>
+bool descartes_planner::BDSPGraphPlanner<FloatT>::solve(
+    std::vector<typename PointData<FloatT>::ConstPtr>& solution_points, std::chrono::steady_clock::time_point deadline)
+{
+  timed_out_ = false;
+  if(backend_ == BDSPBackend::LAYERED_DAG)
+  {
+    return solveLayers(solution_points, deadline);
+  }
+
   typename GraphT::vertex_descriptor virtual_vertex = vertex(0, graph_), current_vertex;
   std::size_t num_vert = boost::num_vertices(graph_);
   std::vector<typename GraphT::vertex_descriptor> predecessors(num_vert);
   std::vector<FloatT> weights(num_vert, 0.0);
 
 /*  boost::dijkstra_shortest_paths(graph_, virtual_vertex,
-    weight_map(get(&EdgeProperties<FloatT>::weight, graph_))
+    weight_map(get(&CompactEdge<FloatT>::weight, graph_))
     .distance_map(boost::make_iterator_property_map(weights.begin(),get(boost::vertex_index, graph_)))
     .predecessor_map(&predecessors[0]));*/
 
   CONSOLE_BRIDGE_logDebug("Descartes Searching through graph now ...");
-  boost::dijkstra_shortest_paths_no_color_map(graph_, virtual_vertex,
-   weight_map(get(&EdgeProperties<FloatT>::weight, graph_))
-   .distance_map(boost::make_iterator_property_map(weights.begin(),get(boost::vertex_index, graph_)))
-   .predecessor_map(boost::make_iterator_property_map(predecessors.begin(),get(boost::vertex_index, graph_))));
+  try
+  {
+    boost::dijkstra_shortest_paths_no_color_map(graph_, virtual_vertex,
+     weight_map(get(&CompactEdge<FloatT>::weight, graph_))
+     .distance_map(boost::make_iterator_property_map(weights.begin(),get(boost::vertex_index, graph_)))
+     .predecessor_map(boost::make_iterator_property_map(predecessors.begin(),get(boost::vertex_index, graph_)))
+     .visitor(DeadlineVisitor(deadline)));
+  }
+  catch(const DeadlinePassed&)
+  {
+    CONSOLE_BRIDGE_logError("The deadline passed while searching the graph");
+    timed_out_ = true;
+    return false;
+  }
   CONSOLE_BRIDGE_logDebug("Descartes graph search completed");
 
   CONSOLE_BRIDGE_logDebug("Num vertices %i", num_vert);
@@ -483,9 +662,9 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::solve(
   typename GraphT::vertex_descriptor cheapest_end_vertex = -1;
   double cost = std::numeric_limits<FloatT>::infinity();
 
-  for(const auto& kv: end_vertices_)
+  for(std::size_t end_vertex : end_vertices_)
   {
-    typename GraphT::vertex_descriptor candidate_vertex = kv.first;
+    typename GraphT::vertex_descriptor candidate_vertex = end_vertex;
     CONSOLE_BRIDGE_logDebug("Searching end vertex %i with cost %f", candidate_vertex,
                            weights[candidate_vertex]);
     if(weights[candidate_vertex] > cost)
@@ -571,12 +750,12 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::solve(
         current_vertex = prev_vertex;
 
         // grab sampler
-        EdgeProperties<FloatT> edge_props = graph_[e];
+        VertexProperties src_vtx = graph_[prev_vertex];
+        VertexProperties dst_vtx = graph_[targ];
         CONSOLE_BRIDGE_logDebug("Points %lu and %lu connected by edge (%lu, %lu)",
-                                 edge_props.src_vtx.point_id, edge_props.dst_vtx.point_id,
-                                 prev_vertex, targ);
+                                 src_vtx.point_id, dst_vtx.point_id, prev_vertex, targ);
 
-        if( !(add_solution(edge_props.dst_vtx) && add_solution(edge_props.src_vtx)))
+        if( !(add_solution(dst_vtx) && add_solution(src_vtx)))
         {
           break;
         }
@@ -605,6 +784,78 @@ bool descartes_planner::BDSPGraphPlanner<FloatT>::solve(
   return true;
 }
 
+template<typename FloatT>
+bool descartes_planner::BDSPGraphPlanner<FloatT>::solveLayers(
+    std::vector<typename PointData<FloatT>::ConstPtr>& solution_points, std::chrono::steady_clock::time_point deadline)
+{
+  const std::size_t num_points = container_->size();
+  if(num_points < 2 || layers_.size() != num_points - 1)
+  {
+    CONSOLE_BRIDGE_logError("The graph has not been built");
+    return false;
+  }
+
+  // cost of the cheapest path to each sample of the current point, and for each sample of every point the sample of
+  // the previous point that path comes from
+  const FloatT unreached = std::numeric_limits<FloatT>::infinity();
+  std::vector<FloatT> cost((*container_)[0]->num_samples, 0.0);
+  std::vector<FloatT> next_cost;
+  std::vector< std::vector<std::uint32_t> > predecessors(num_points);
+
+  CONSOLE_BRIDGE_logDebug("Descartes Searching through graph now ...");
+  for(std::size_t i = 0; i < layers_.size(); i++)
+  {
+    if(std::chrono::steady_clock::now() >= deadline)
+    {
+      CONSOLE_BRIDGE_logError("The deadline passed while searching the graph");
+      timed_out_ = true;
+      return false;
+    }
+
+    std::vector<std::uint32_t>& predecessor = predecessors[i + 1];
+    next_cost.assign((*container_)[i + 1]->num_samples, unreached);
+    predecessor.assign(next_cost.size(), 0);
+    for(const CompactEdge<FloatT>& edge : layers_[i])
+    {
+      const FloatT c = cost[edge.src] + edge.weight;
+      if(c < next_cost[edge.dst])
+      {
+        next_cost[edge.dst] = c;
+        predecessor[edge.dst] = edge.src;
+      }
+    }
+    cost.swap(next_cost);
+  }
+  CONSOLE_BRIDGE_logDebug("Descartes graph search completed");
+
+  auto cheapest = std::min_element(cost.begin(), cost.end());
+  if(cheapest == cost.end() || *cheapest == unreached)
+  {
+    CONSOLE_BRIDGE_logError("Found no continuous solution path through graph");
+    return false;
+  }
+
+  std::uint32_t sample = static_cast<std::uint32_t>(std::distance(cost.begin(), cheapest));
+  CONSOLE_BRIDGE_logInform("Found valid shortest path with end sample: %u and cost %f", sample, *cheapest);
+
+  solution_points.assign(num_points, nullptr);
+  for(std::size_t i = num_points; i-- > 0;)
+  {
+    typename PointData<FloatT>::ConstPtr point_data = container_->at(i)->at(sample);
+    if(!point_data)
+    {
+      CONSOLE_BRIDGE_logError("SampleGroup %lu has no sample %u", i, sample);
+      return false;
+    }
+    solution_points[i] = point_data;
+    if(i > 0)
+    {
+      sample = predecessors[i][sample];
+    }
+  }
+  return true;
+}
+
 // explicit specializations
 template class BDSPGraphPlanner<float>;
 template class BDSPGraphPlanner<double>;
@@ -53,7 +53,7 @@ template<typename FloatT>
 BDSPSparsePlanner<FloatT>::BDSPSparsePlanner(typename std::shared_ptr< SamplesContainer<FloatT> > container,
                                              Config cfg):
   container_(container),
-  graph_planner_(container, cfg_.report_all_failures),
+  graph_planner_(container, cfg.report_all_failures, cfg.backend),
   cfg_(cfg)
 {
 
@@ -128,7 +128,7 @@ bool BDSPSparsePlanner<FloatT>::build(std::vector< typename PointSampler<FloatT>
   // build and solve for selected sparse points now
   std::vector< typename PointData<FloatT>::ConstPtr > sparse_solution_points;
   {
-    BDSPGraphPlanner<FloatT> graph_planner(container_, cfg_.report_all_failures);
+    BDSPGraphPlanner<FloatT> graph_planner(container_, cfg_.report_all_failures, cfg_.backend);
     if(!graph_planner.build(selected_sparse_points, selected_sparsed_edge_evaluators ))
     {
       CONSOLE_BRIDGE_logError("Failed to build sparse graph");
@@ -226,7 +226,7 @@ bool BDSPSparsePlanner<FloatT>::build(std::vector< typename PointSampler<FloatT>
   {
 
     bool report_failures = current_resampling_attempts == cfg_.max_resampling_attempts ? cfg_.report_all_failures : false;
-    graph_planner_ = BDSPGraphPlanner<FloatT>(container_, report_failures);
+    graph_planner_ = BDSPGraphPlanner<FloatT>(container_, report_failures, cfg_.backend);
     succeeded = graph_planner_.build(dense_point_samplers, edge_evaluators);
 
     if(!succeeded)
@@ -17,18 +17,42 @@
  */
 #include <descartes_planner/dense_planner.h>
 #include <boost/make_shared.hpp>
+#include <stdexcept>
 
 namespace descartes_planner
 {
 using namespace descartes_core;
+
+const std::string SEARCH_THREADS_CONFIG = "search_threads";
+const std::string IMPLICIT_EDGES_CONFIG = "implicit_edges";
+const std::string BEAM_WIDTH_CONFIG = "beam_width";
+const std::string BEAM_COST_RATIO_CONFIG = "beam_cost_ratio";
+const std::string BEAM_VALIDATION_CONFIG = "beam_validation";
+const std::string THREADS_CONFIG = "threads";
+const std::string THREAD_AFFINITY_CONFIG = "thread_affinity";
+const std::string MAX_OUT_EDGES_CONFIG = "max_out_edges";
+
 DensePlanner::DensePlanner() : planning_graph_(), error_code_(descartes_core::PlannerError::UNINITIALIZED)
 {
+  config_ = { { SEARCH_THREADS_CONFIG, "1" },
+              { IMPLICIT_EDGES_CONFIG, "0" },
+              { BEAM_WIDTH_CONFIG, "0" },
+              { BEAM_COST_RATIO_CONFIG, "0" },
+              { BEAM_VALIDATION_CONFIG, "0" },
+              { THREADS_CONFIG, "0" },
+              { THREAD_AFFINITY_CONFIG, "" },
+              { MAX_OUT_EDGES_CONFIG, "0" } };
+
   error_map_ = { { PlannerError::OK, "OK" },
                  { PlannerError::EMPTY_PATH, "No path plan has been generated" },
                  { PlannerError::INVALID_ID, "ID is nil or isn't part of the path" },
                  { PlannerError::IK_NOT_AVAILABLE, "One or more ik solutions could not be found" },
                  { PlannerError::UNINITIALIZED, "Planner has not been initialized with a robot model" },
-                 { PlannerError::INCOMPLETE_PATH, "Input trajectory and output path point cound differ" } };
+                 { PlannerError::INCOMPLETE_PATH, "Input trajectory and output path point cound differ" },
+                 { PlannerError::SPEED_LIMIT_EXCEEDED, "No joint solutions of two consecutive points satisfy the joint "
+                                                       "velocity limits, see PlanningGraph::getBuildFailure" },
+                 { PlannerError::PLANNING_TIMEOUT, "The deadline passed before planning finished" },
+                 { PlannerError::INVALID_CONFIGURATION_PARAMETER, "Invalid configuration parameter" } };
 }
 
 DensePlanner::~DensePlanner()
@@ -39,6 +63,7 @@ bool DensePlanner::initialize(descartes_core::RobotModelConstPtr model)
 {
   planning_graph_ =
       boost::shared_ptr<descartes_planner::PlanningGraph>(new descartes_planner::PlanningGraph(std::move(model)));
+  applyConfig();
   error_code_ = descartes_core::PlannerErrors::EMPTY_PATH;
   return true;
 }
@@ -48,17 +73,120 @@ bool DensePlanner::initialize(descartes_core::RobotModelConstPtr model,
 {
   planning_graph_ = boost::shared_ptr<descartes_planner::PlanningGraph>(
       new descartes_planner::PlanningGraph(std::move(model), cost_function_callback));
+  applyConfig();
+  error_code_ = descartes_core::PlannerErrors::EMPTY_PATH;
+  return true;
+}
+
+bool DensePlanner::initialize(descartes_core::RobotModelConstPtr model,
+                              descartes_planner::BatchCostFunction cost_function_callback)
+{
+  planning_graph_ = boost::shared_ptr<descartes_planner::PlanningGraph>(
+      new descartes_planner::PlanningGraph(std::move(model), std::move(cost_function_callback)));
+  applyConfig();
   error_code_ = descartes_core::PlannerErrors::EMPTY_PATH;
   return true;
 }
 
 bool DensePlanner::setConfig(const descartes_core::PlannerConfig& config)
 {
-  config_ = config;
-  config_.clear();
+  // verifying keys, any subset of the known parameters may be given
+  for (const auto& kv : config)
+  {
+    if (config_.count(kv.first) == 0)
+    {
+      ROS_ERROR_STREAM("Unknown configuration parameter '" << kv.first << "'");
+      error_code_ = descartes_core::PlannerError::INVALID_CONFIGURATION_PARAMETER;
+      return false;
+    }
+  }
+
+  // translating string values
+  try
+  {
+    if (config.count(SEARCH_THREADS_CONFIG) && std::stoi(config.at(SEARCH_THREADS_CONFIG)) < 1)
+    {
+      throw std::invalid_argument(SEARCH_THREADS_CONFIG);
+    }
+
+    if (config.count(IMPLICIT_EDGES_CONFIG) && std::stoi(config.at(IMPLICIT_EDGES_CONFIG)) != 0 &&
+        std::stoi(config.at(IMPLICIT_EDGES_CONFIG)) != 1)
+    {
+      throw std::invalid_argument(IMPLICIT_EDGES_CONFIG);
+    }
+
+    if (config.count(BEAM_WIDTH_CONFIG) && std::stoi(config.at(BEAM_WIDTH_CONFIG)) < 0)
+    {
+      throw std::invalid_argument(BEAM_WIDTH_CONFIG);
+    }
+
+    if (config.count(BEAM_COST_RATIO_CONFIG))
+    {
+      const double ratio = std::stod(config.at(BEAM_COST_RATIO_CONFIG));
+      if (ratio != 0.0 && !(ratio >= 1.0)) throw std::invalid_argument(BEAM_COST_RATIO_CONFIG);
+    }
+
+    if (config.count(BEAM_VALIDATION_CONFIG) && std::stoi(config.at(BEAM_VALIDATION_CONFIG)) != 0 &&
+        std::stoi(config.at(BEAM_VALIDATION_CONFIG)) != 1)
+    {
+      throw std::invalid_argument(BEAM_VALIDATION_CONFIG);
+    }
+
+    if (config.count(THREADS_CONFIG) && std::stoi(config.at(THREADS_CONFIG)) < 0)
+    {
+      throw std::invalid_argument(THREADS_CONFIG);
+    }
+
+    std::vector<int> cpus;
+    if (config.count(THREAD_AFFINITY_CONFIG) && !parseCpuList(config.at(THREAD_AFFINITY_CONFIG), cpus))
+    {
+      throw std::invalid_argument(THREAD_AFFINITY_CONFIG);
+    }
+
+    if (config.count(MAX_OUT_EDGES_CONFIG) && std::stoi(config.at(MAX_OUT_EDGES_CONFIG)) < 0)
+    {
+      throw std::invalid_argument(MAX_OUT_EDGES_CONFIG);
+    }
+  }
+  catch (std::logic_error& exp)
+  {
+    ROS_ERROR_STREAM("Unable to parse configuration value(s)");
+    error_code_ = descartes_core::PlannerError::INVALID_CONFIGURATION_PARAMETER;
+    return false;
+  }
+
+  for (const auto& kv : config)
+  {
+    config_[kv.first] = kv.second;
+  }
+
+  if (planning_graph_) applyConfig();
   return true;
 }
 
+void DensePlanner::applyConfig()
+{
+  planning_graph_->setSearchThreads(static_cast<unsigned>(std::stoi(config_.at(SEARCH_THREADS_CONFIG))));
+  planning_graph_->setImplicitEdges(std::stoi(config_.at(IMPLICIT_EDGES_CONFIG)) != 0);
+
+  BeamParameters beam;
+  beam.width = static_cast<std::size_t>(std::stoi(config_.at(BEAM_WIDTH_CONFIG)));
+  beam.cost_ratio = std::stod(config_.at(BEAM_COST_RATIO_CONFIG));
+  planning_graph_->setBeam(beam);
+  planning_graph_->setBeamValidation(std::stoi(config_.at(BEAM_VALIDATION_CONFIG)) != 0);
+  planning_graph_->setMaxOutEdges(static_cast<std::size_t>(std::stoi(config_.at(MAX_OUT_EDGES_CONFIG))));
+
+  // The pool is only replaced when its parameters change, as that stops its threads
+  const auto n_threads = static_cast<unsigned>(std::stoi(config_.at(THREADS_CONFIG)));
+  std::vector<int> cpus;
+  parseCpuList(config_.at(THREAD_AFFINITY_CONFIG), cpus);
+  if (!task_pool_ || (n_threads > 0 && n_threads != task_pool_->threads()) || cpus != task_pool_->cpus())
+  {
+    task_pool_ = std::make_shared<TaskPool>(n_threads, std::move(cpus));
+  }
+  planning_graph_->setTaskPool(task_pool_);
+}
+
 void DensePlanner::getConfig(descartes_core::PlannerConfig& config) const
 {
   config = config_;
@@ -66,33 +194,24 @@ void DensePlanner::getConfig(descartes_core::PlannerConfig& config) const
 
 descartes_core::TrajectoryPt::ID DensePlanner::getPrevious(const descartes_core::TrajectoryPt::ID& ref_id)
 {
-  descartes_core::TrajectoryPt::ID id;
-  auto predicate = [&ref_id](descartes_core::TrajectoryPtPtr p)
-  {
-    return ref_id == p->getID();
-  };
-
-  auto pos = std::find_if(path_.begin()++, path_.end(), predicate);
-  if (pos == path_.end())
+  const auto& graph = planning_graph_->graph();
+  auto s = graph.indexOf(ref_id);
+  if (!s.second || graph.isFirst(s.first))
   {
-    id = descartes_core::TrajectoryID::make_nil();
-  }
-  else
-  {
-    pos--;
-    id = (*pos)->getID();
+    return descartes_core::TrajectoryID::make_nil();
   }
 
-  return id;
+  return graph.getRung(s.first - 1).id;
 }
 
-bool DensePlanner::updatePath()
+bool DensePlanner::updatePath(const CancellationToken& cancel)
 {
   double c;
   std::list<descartes_trajectory::JointTrajectoryPt> list;
-  if (planning_graph_->getShortestPath(c, list))
+  if (planning_graph_->getShortestPath(c, list, cancel))
   {
     error_code_ = descartes_core::PlannerErrors::OK;
+    path_.clear();
     for (auto&& p : list)
     {
       path_.push_back(boost::make_shared<descartes_trajectory::JointTrajectoryPt>(std::move(p)));
@@ -101,53 +220,48 @@ bool DensePlanner::updatePath()
   }
   else
   {
-    error_code_ = descartes_core::PlannerErrors::UKNOWN;
+    error_code_ = cancel.expired() ? descartes_core::PlannerErrors::PLANNING_TIMEOUT
+                                   : descartes_core::PlannerErrors::UKNOWN;
     return false;
   }
 }
 
 descartes_core::TrajectoryPt::ID DensePlanner::getNext(const descartes_core::TrajectoryPt::ID& ref_id)
 {
-  descartes_core::TrajectoryPt::ID id;
-  auto predicate = [&ref_id](descartes_core::TrajectoryPtPtr p)
-  {
-    return ref_id == p->getID();
-  };
-
-  auto pos = std::find_if(path_.begin(), path_.end() - 2, predicate);
-  if (pos == path_.end())
+  const auto& graph = planning_graph_->graph();
+  auto s = graph.indexOf(ref_id);
+  if (!s.second || graph.isLast(s.first))
   {
-    id = descartes_core::TrajectoryID::make_nil();
+    return descartes_core::TrajectoryID::make_nil();
   }
-  else
-  {
-    pos++;
-    id = (*pos)->getID();
-  }
-  return id;
+
+  return graph.getRung(s.first + 1).id;
 }
 
 descartes_core::TrajectoryPtPtr DensePlanner::get(const descartes_core::TrajectoryPt::ID& ref_id)
 {
-  descartes_core::TrajectoryPtPtr p;
-  auto predicate = [&ref_id](descartes_core::TrajectoryPtPtr p)
-  {
-    return ref_id == p->getID();
-  };
-
-  auto pos = std::find_if(path_.begin(), path_.end() - 2, predicate);
-  if (pos == path_.end())
+  // The path holds one point per rung of the graph, in the same order
+  auto s = planning_graph_->graph().indexOf(ref_id);
+  if (!s.second || s.first >= path_.size())
   {
-    p.reset();
+    return descartes_core::TrajectoryPtPtr();
   }
-  else
-  {
-    p = *pos;
-  }
-  return p;
+
+  return path_[s.first];
 }
 
 bool DensePlanner::planPath(const std::vector<descartes_core::TrajectoryPtPtr>& traj)
+{
+  return plan(traj, CancellationToken());
+}
+
+bool DensePlanner::planPath(const std::vector<descartes_core::TrajectoryPtPtr>& traj,
+                            std::chrono::steady_clock::time_point deadline)
+{
+  return plan(traj, CancellationToken(deadline));
+}
+
+bool DensePlanner::plan(const std::vector<descartes_core::TrajectoryPtPtr>& traj, const CancellationToken& cancel)
 {
   if (error_code_ == descartes_core::PlannerError::UNINITIALIZED)
   {
@@ -158,9 +272,17 @@ bool DensePlanner::planPath(const std::vector<descartes_core::TrajectoryPtPtr>&
   path_.clear();
   error_code_ = descartes_core::PlannerError::EMPTY_PATH;
 
-  if (planning_graph_->insertGraph(traj))
+  if (planning_graph_->insertGraph(traj, cancel))
+  {
+    updatePath(cancel);
+  }
+  else if (planning_graph_->getBuildFailure().reason == BuildFailure::NO_EDGES)
+  {
+    error_code_ = descartes_core::PlannerError::SPEED_LIMIT_EXCEEDED;
+  }
+  else if (planning_graph_->getBuildFailure().reason == BuildFailure::CANCELLED)
   {
-    updatePath();
+    error_code_ = descartes_core::PlannerError::PLANNING_TIMEOUT;
   }
   else
   {
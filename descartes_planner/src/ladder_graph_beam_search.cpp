@@ -0,0 +1,156 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_beam_search.h"
+#include <algorithm>
+
+namespace descartes_planner
+{
+
+std::size_t pruneRung(std::vector<double>& distance, const BeamParameters& beam)
+{
+  const double unreachable = std::numeric_limits<double>::max();
+
+  std::vector<double> reachable;
+  reachable.reserve(distance.size());
+  for (double d : distance)
+  {
+    if (d != unreachable) reachable.push_back(d);
+  }
+  if (reachable.empty()) return 0;
+
+  const double best = *std::min_element(reachable.begin(), reachable.end());
+  const double cutoff = beam.cost_ratio > 0.0 && best > 0.0 ? best * beam.cost_ratio : unreachable;
+
+  // Everything cheaper than the width-th smallest distance survives, plus as many of the vertices tied with it as
+  // there is room for
+  double limit = unreachable;
+  std::size_t n_at_limit = reachable.size();
+  if (beam.width > 0 && reachable.size() > beam.width)
+  {
+    const auto kth = reachable.begin() + (beam.width - 1);
+    std::nth_element(reachable.begin(), kth, reachable.end());
+    limit = *kth;
+    n_at_limit = beam.width - std::count_if(reachable.begin(), kth, [limit](double d) { return d < limit; });
+  }
+
+  std::size_t pruned = 0;
+  for (auto& d : distance)
+  {
+    if (d == unreachable) continue;
+
+    bool keep = d <= cutoff && d <= limit;
+    if (keep && d == limit)
+    {
+      keep = n_at_limit > 0;
+      if (keep) --n_at_limit;
+    }
+
+    if (!keep)
+    {
+      d = unreachable;
+      ++pruned;
+    }
+  }
+  return pruned;
+}
+
+BeamDAGSearch::BeamDAGSearch(const LadderGraph& graph, const BeamParameters& beam)
+  : graph_(graph), beam_(beam), pruned_vertices_(0)
+{
+  solution_.resize(graph.size());
+  for (size_type i = 0; i < graph.size(); ++i)
+  {
+    solution_[i].distance.resize(graph.rungSize(i));
+    solution_[i].predecessor.resize(graph.rungSize(i));
+  }
+}
+
+double BeamDAGSearch::run()
+{
+  pruned_vertices_ = 0;
+  if (solution_.empty()) return std::numeric_limits<double>::max();
+
+  std::fill(solution_.front().distance.begin(), solution_.front().distance.end(), 0.0);
+  for (size_type rung = 1; rung < solution_.size(); ++rung)
+  {
+    auto& next = solution_[rung];
+    std::fill(next.distance.begin(), next.distance.end(), std::numeric_limits<double>::max());
+
+    // Only walk the edges out of the survivors: once the beam is narrow, skipping whole rows beats the dense
+    // kernels, which scan every source
+    const auto& prev = solution_[rung - 1].distance;
+    const auto& edges = graph_.getEdges(rung - 1);
+    for (size_type i = 0; i < prev.size(); ++i)
+    {
+      const double u_cost = prev[i];
+      if (u_cost == std::numeric_limits<double>::max()) continue;
+
+      for (const auto& edge : edges[i])
+      {
+        const double dv = u_cost + edge.cost;
+        if (dv < next.distance[edge.idx])
+        {
+          next.distance[edge.idx] = dv;
+          next.predecessor[edge.idx] = static_cast<predecessor_t>(i);
+        }
+      }
+    }
+
+    // The last rung is left whole: only its cheapest vertex matters
+    if (rung + 1 < solution_.size()) pruned_vertices_ += pruneRung(next.distance, beam_);
+  }
+
+  const auto& last = solution_.back().distance;
+  return *std::min_element(last.begin(), last.end());
+}
+
+std::vector<BeamDAGSearch::predecessor_t> BeamDAGSearch::shortestPath() const
+{
+  std::vector<predecessor_t> path (solution_.size());
+  if (path.empty()) return path;
+
+  const auto& last = solution_.back().distance;
+  path.back() = static_cast<predecessor_t>(std::distance(last.begin(), std::min_element(last.begin(), last.end())));
+  for (size_type rung = path.size() - 1; rung > 0; --rung)
+  {
+    path[rung - 1] = solution_[rung].predecessor[path[rung]];
+  }
+  return path;
+}
+
+void BeamSearchStats::record(double pruned_cost, std::size_t pruned, const double* exact_cost)
+{
+  ++searches;
+  pruned_vertices += pruned;
+  if (!exact_cost) return;
+
+  ++validated;
+  const double unreachable = std::numeric_limits<double>::max();
+  if (pruned_cost == unreachable)
+  {
+    if (*exact_cost != unreachable) ++failed;
+  }
+  else if (pruned_cost > *exact_cost)
+  {
+    ++cost_changed;
+    if (*exact_cost > 0.0)
+      max_relative_increase = std::max(max_relative_increase, (pruned_cost - *exact_cost) / *exact_cost);
+  }
+}
+
+} // namespace descartes_planner
@@ -16,6 +16,8 @@
  * limitations under the License.
  */
 #include "descartes_planner/ladder_graph_dag_search.h"
+#include "descartes_planner/ladder_graph_relaxation.h"
+#include <algorithm>
 
 namespace descartes_planner
 {
@@ -34,6 +36,12 @@ DAGSearch::DAGSearch(const LadderGraph &graph)
   }
 }
 
+namespace
+{
+// A block must cover a few rungs for its transfer matrix to be worth computing
+const std::size_t MIN_BLOCK_RUNGS = 4;
+}
+
 double DAGSearch::run()
 {
   // Cost to the first rung should be set to zero
@@ -45,31 +53,134 @@ double DAGSearch::run()
   }
 
   // Now we iterate over the graph in 'topological' order
-  for (size_type rung = 0; rung < solution_.size() - 1; ++rung)
+  relaxBlock(0, solution_.size() - 1, nullptr);
+
+  return *std::min_element(solution_.back().distance.begin(), solution_.back().distance.end());
+}
+
+double DAGSearch::runParallel(unsigned n_threads)
+{
+  const size_type n_rungs = solution_.size();
+  const size_type n_blocks = std::min<size_type>(n_threads, (n_rungs - 1) / MIN_BLOCK_RUNGS);
+  if (n_blocks < 2) return run();
+
+  // Split the ladder evenly, then move each interior boundary to the narrowest rung nearby: the work needed for a
+  // block's transfer matrix is proportional to the size of its first rung
+  std::vector<size_type> bounds(n_blocks + 1);
+  const size_type block_size = (n_rungs - 1) / n_blocks;
+  const size_type slack = block_size / 4;
+  bounds.front() = 0;
+  bounds.back() = n_rungs - 1;
+  for (size_type k = 1; k < n_blocks; ++k)
   {
-    const auto n_vertices = graph_.rungSize(rung);
-    const auto next_rung = rung + 1;
-    // For each vertex in the out edge list
-    for (size_t index = 0; index < n_vertices; ++index)
+    const size_type nominal = k * (n_rungs - 1) / n_blocks;
+    size_type best = nominal;
+    for (size_type r = nominal - slack; r <= nominal + slack; ++r)
+    {
+      if (graph_.rungSize(r) < graph_.rungSize(best)) best = r;
+    }
+    bounds[k] = best;
+  }
+
+  std::fill(solution_.front().distance.begin(), solution_.front().distance.end(), 0.0);
+  for (size_type i = 1; i < n_rungs; ++i)
+  {
+    std::fill(solution_[i].distance.begin(), solution_[i].distance.end(), std::numeric_limits<double>::max());
+  }
+
+  // Phase 1: the first block has known entry distances and is searched directly, the others compute their
+  // transfer matrices
+  std::vector<std::vector<double>> transfer(n_blocks);
+  #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+  for (size_type k = 0; k < n_blocks; ++k)
+  {
+    if (k == 0)
+      relaxBlock(bounds[0], bounds[1], nullptr);
+    else
+      transferMatrix(bounds[k], bounds[k + 1], transfer[k]);
+  }
+
+  // Phase 2: chain the transfer matrices to get the distances at every block boundary
+  for (size_type k = 1; k < n_blocks; ++k)
+  {
+    const auto& entry = solution_[bounds[k]].distance;
+    auto& exit = solution_[bounds[k + 1]].distance;
+    const auto n_exit = exit.size();
+
+    for (size_type a = 0; a < entry.size(); ++a)
     {
-      const auto u_cost = distance(rung, index);
-      const auto& edges = graph_.getEdges(rung)[index];
-      // for each out edge
-      for (const auto& edge : edges)
+      if (entry[a] == std::numeric_limits<double>::max()) continue;
+      const double* row = transfer[k].data() + a * n_exit;
+      for (size_type c = 0; c < n_exit; ++c)
       {
-        auto dv = u_cost + edge.cost; // new cost
-        if (dv < distance(next_rung, edge.idx))
-        {
-          distance(next_rung, edge.idx) = dv;
-          predecessor(next_rung, edge.idx) = index; // the predecessor's rung is implied to be the current rung
-        }
+        const double dv = entry[a] + row[c];
+        if (dv < exit[c]) exit[c] = dv;
       }
-    } // vertex for loop
-  } // rung for loop
+    }
+  }
+
+  // Phase 3: with their entry distances known, the remaining blocks fill in their interior. The distances of a
+  // block's last rung are already final and being read by the next block, so they're relaxed into a scratch row.
+  #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+  for (size_type k = 1; k < n_blocks; ++k)
+  {
+    std::vector<double> exit_distance;
+    relaxBlock(bounds[k], bounds[k + 1], &exit_distance);
+  }
 
   return *std::min_element(solution_.back().distance.begin(), solution_.back().distance.end());
 }
 
+void DAGSearch::relaxBlock(size_type first, size_type last, std::vector<double>* exit_distance)
+{
+  for (size_type rung = first; rung < last; ++rung)
+  {
+    const auto next_rung = rung + 1;
+    auto& next = solution_[next_rung];
+    double* dst_distance = next.distance.data();
+    if (next_rung == last && exit_distance)
+    {
+      exit_distance->assign(next.distance.size(), std::numeric_limits<double>::max());
+      dst_distance = exit_distance->data();
+    }
+
+    // Relax the out edges of this rung's vertices into the distances of the next rung
+    relaxRung(graph_.getEdges(rung), solution_[rung].distance.data(), next.distance.size(), dst_distance,
+              next.predecessor.data());
+  } // rung for loop
+}
+
+void DAGSearch::transferMatrix(size_type first, size_type last, std::vector<double>& matrix) const
+{
+  const auto n_entry = graph_.rungSize(first);
+  const auto n_exit = graph_.rungSize(last);
+  matrix.assign(n_entry * n_exit, std::numeric_limits<double>::max());
+
+  std::vector<double> current, next;
+  std::vector<predecessor_t> unused;
+
+  for (size_type a = 0; a < n_entry; ++a)
+  {
+    // The first step only has a single source, so relax its out edges directly
+    current.assign(graph_.rungSize(first + 1), std::numeric_limits<double>::max());
+    for (const auto& edge : graph_.getEdges(first)[a])
+    {
+      if (edge.cost < current[edge.idx]) current[edge.idx] = edge.cost;
+    }
+
+    for (size_type rung = first + 1; rung < last; ++rung)
+    {
+      const auto n_next = graph_.rungSize(rung + 1);
+      next.assign(n_next, std::numeric_limits<double>::max());
+      unused.resize(n_next);
+      relaxRung(graph_.getEdges(rung), current.data(), n_next, next.data(), unused.data());
+      current.swap(next);
+    }
+
+    std::copy(current.begin(), current.end(), matrix.begin() + a * n_exit);
+  }
+}
+
 std::vector<DAGSearch::predecessor_t> DAGSearch::shortestPath() const
 {
   auto min_it = std::min_element(solution_.back().distance.begin(), solution_.back().distance.end());
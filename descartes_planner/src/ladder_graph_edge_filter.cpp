@@ -0,0 +1,162 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_edge_filter.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DESCARTES_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace descartes_planner
+{
+
+namespace
+{
+
+// Tests the targets [first, n_targets) one at a time, giving up on each at the first joint out of its limit
+std::size_t filterEdgesScalar(const double* start, const double* targets, std::size_t first, std::size_t n_targets,
+                              std::size_t stride, std::size_t dof, const double* max_delta, unsigned* indices,
+                              double* costs) noexcept
+{
+  std::size_t n = 0;
+  for (std::size_t j = first; j < n_targets; ++j)
+  {
+    double cost = 0.0;
+    std::size_t k = 0;
+    for (; k < dof; ++k)
+    {
+      const double delta = std::abs(start[k] - targets[k * stride + j]);
+      if (delta > max_delta[k]) break;
+      cost += delta;
+    }
+
+    if (k == dof)
+    {
+      indices[n] = static_cast<unsigned>(j);
+      costs[n] = cost;
+      ++n;
+    }
+  }
+  return n;
+}
+
+#ifdef DESCARTES_X86_KERNELS
+
+// A block of targets is tested joint by joint, the joint distances being summed in the same order as the scalar
+// test. A target is kept unless a distance compares greater than its limit, which keeps NaNs as the scalar test does.
+// Once no target of the block is left, its remaining joints are skipped.
+
+__attribute__((target("avx2")))
+std::size_t filterEdgesAVX2(const double* start, const double* targets, std::size_t n_targets, std::size_t stride,
+                            std::size_t dof, const double* max_delta, unsigned* indices, double* costs) noexcept
+{
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const std::size_t n_tiled = n_targets - n_targets % 4;
+
+  std::size_t n = 0;
+  for (std::size_t j = 0; j < n_tiled; j += 4)
+  {
+    __m256d cost = _mm256_setzero_pd();
+    int keep = 0xF;
+    for (std::size_t k = 0; k < dof && keep; ++k)
+    {
+      const __m256d value = _mm256_loadu_pd(targets + k * stride + j);
+      const __m256d delta = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_set1_pd(start[k]), value));
+      keep &= ~_mm256_movemask_pd(_mm256_cmp_pd(delta, _mm256_set1_pd(max_delta[k]), _CMP_GT_OQ));
+      cost = _mm256_add_pd(cost, delta);
+    }
+    if (!keep) continue;
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, cost);
+    for (; keep; keep &= keep - 1)
+    {
+      const int l = __builtin_ctz(keep);
+      indices[n] = static_cast<unsigned>(j + l);
+      costs[n] = lanes[l];
+      ++n;
+    }
+  }
+
+  return n + filterEdgesScalar(start, targets, n_tiled, n_targets, stride, dof, max_delta, indices + n, costs + n);
+}
+
+__attribute__((target("avx512f")))
+std::size_t filterEdgesAVX512(const double* start, const double* targets, std::size_t n_targets, std::size_t stride,
+                              std::size_t dof, const double* max_delta, unsigned* indices, double* costs) noexcept
+{
+  const std::size_t n_tiled = n_targets - n_targets % 8;
+  const __m512i lane_index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  std::size_t n = 0;
+  for (std::size_t j = 0; j < n_tiled; j += 8)
+  {
+    __m512d cost = _mm512_setzero_pd();
+    __mmask8 keep = 0xFF;
+    for (std::size_t k = 0; k < dof && keep; ++k)
+    {
+      const __m512d value = _mm512_loadu_pd(targets + k * stride + j);
+      const __m512d delta = _mm512_abs_pd(_mm512_sub_pd(_mm512_set1_pd(start[k]), value));
+      keep = _mm512_mask_cmp_pd_mask(keep, delta, _mm512_set1_pd(max_delta[k]), _CMP_NGT_UQ);
+      cost = _mm512_add_pd(cost, delta);
+    }
+    if (!keep) continue;
+
+    const __m512i index = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(j)), lane_index);
+    _mm512_mask_compressstoreu_epi32(indices + n, keep, index);
+    _mm512_mask_compressstoreu_pd(costs + n, keep, cost);
+    n += __builtin_popcount(keep);
+  }
+
+  return n + filterEdgesScalar(start, targets, n_tiled, n_targets, stride, dof, max_delta, indices + n, costs + n);
+}
+
+#endif // DESCARTES_X86_KERNELS
+
+} // anonymous namespace
+
+void transposeJoints(const double* joints, std::size_t n_vertices, std::size_t dof, std::vector<double>& soa)
+{
+  soa.resize(n_vertices * dof);
+  for (std::size_t j = 0; j < n_vertices; ++j)
+  {
+    for (std::size_t k = 0; k < dof; ++k)
+      soa[k * n_vertices + j] = joints[j * dof + k];
+  }
+}
+
+std::size_t filterEdges(RelaxationKernel kernel, const double* start, const double* targets, std::size_t n_targets,
+                        std::size_t stride, std::size_t dof, const double* max_delta, unsigned* indices,
+                        double* costs) noexcept
+{
+  assert(isKernelSupported(kernel));
+  switch (kernel)
+  {
+#ifdef DESCARTES_X86_KERNELS
+    case RelaxationKernel::AVX512:
+      return filterEdgesAVX512(start, targets, n_targets, stride, dof, max_delta, indices, costs);
+    case RelaxationKernel::AVX2:
+      return filterEdgesAVX2(start, targets, n_targets, stride, dof, max_delta, indices, costs);
+#endif
+    default:
+      return filterEdgesScalar(start, targets, 0, n_targets, stride, dof, max_delta, indices, costs);
+  }
+}
+
+} // namespace descartes_planner
@@ -0,0 +1,221 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_incremental_search.h"
+#include "descartes_planner/ladder_graph_relaxation.h"
+#include "descartes_planner/task_pool.h"
+#include <algorithm>
+
+namespace descartes_planner
+{
+
+namespace
+{
+const std::size_t NO_EDIT = std::numeric_limits<std::size_t>::max();
+
+inline std::size_t distanceBetween(std::size_t a, std::size_t b) noexcept
+{
+  return a > b ? a - b : b - a;
+}
+}
+
+IncrementalDAGSearch::IncrementalDAGSearch(const LadderGraph& graph)
+  : graph_(graph)
+  , meeting_rung_(0)
+  , meeting_vertex_(0)
+  , relaxed_rungs_(0)
+{
+  reset();
+}
+
+void IncrementalDAGSearch::reset()
+{
+  forward_.assign(graph_.size(), SolutionRung());
+  backward_.assign(graph_.size(), SolutionRung());
+  forward_valid_ = 0;
+  backward_valid_ = graph_.size();
+  last_edit_ = NO_EDIT;
+}
+
+void IncrementalDAGSearch::rungInserted(size_type index)
+{
+  forward_.insert(std::next(forward_.begin(), index), SolutionRung());
+  backward_.insert(std::next(backward_.begin(), index), SolutionRung());
+
+  // The new rung and everything after it needs new distances, while the cost-to-go of the rung before it uses the
+  // new edges into it
+  forward_valid_ = std::min(forward_valid_, index);
+  if (backward_valid_ >= index) ++backward_valid_;
+  backward_valid_ = std::max(backward_valid_, index + 1);
+  last_edit_ = index;
+}
+
+void IncrementalDAGSearch::rungRemoved(size_type index)
+{
+  forward_.erase(std::next(forward_.begin(), index));
+  backward_.erase(std::next(backward_.begin(), index));
+
+  // The rungs on either side of the removed one are now connected by new edges
+  forward_valid_ = std::min(forward_valid_, index);
+  if (backward_valid_ > index) --backward_valid_;
+  backward_valid_ = std::max(backward_valid_, index);
+  last_edit_ = index;
+}
+
+void IncrementalDAGSearch::rungModified(size_type index)
+{
+  forward_valid_ = std::min(forward_valid_, index);
+  backward_valid_ = std::max(backward_valid_, index + 1);
+  last_edit_ = index;
+}
+
+double IncrementalDAGSearch::run(const CancellationToken* cancel)
+{
+  relaxed_rungs_ = 0;
+
+  // An edit we weren't told about changed the shape of the graph, start over
+  if (forward_.size() != graph_.size()) reset();
+  if (graph_.size() == 0) return std::numeric_limits<double>::max();
+
+  const size_type n_rungs = graph_.size();
+
+  // Cost to the first rung and cost-to-go from the last one are both zero
+  if (forward_valid_ == 0)
+  {
+    forward_.front().cost.assign(graph_.rungSize(0), 0.0);
+    forward_.front().link.assign(graph_.rungSize(0), 0);
+    forward_valid_ = 1;
+  }
+
+  if (backward_valid_ == n_rungs)
+  {
+    backward_.back().cost.assign(graph_.rungSize(n_rungs - 1), 0.0);
+    backward_.back().link.assign(graph_.rungSize(n_rungs - 1), 0);
+    backward_valid_ = n_rungs - 1;
+  }
+
+  if (forward_valid_ <= backward_valid_)
+  {
+    // The valid regions don't overlap. Closing the gap costs the same from either side, so meet on the side of the
+    // most recent edit: subsequent edits tend to be close to it.
+    const size_type forward_meet = backward_valid_;
+    const size_type backward_meet = forward_valid_ - 1;
+
+    if (last_edit_ != NO_EDIT &&
+        distanceBetween(last_edit_, backward_meet) < distanceBetween(last_edit_, forward_meet))
+    {
+      while (backward_valid_ > backward_meet)
+      {
+        if (cancel && cancel->cancelled()) return std::numeric_limits<double>::max();
+        backwardRelax(--backward_valid_);
+      }
+      meeting_rung_ = backward_meet;
+    }
+    else
+    {
+      while (forward_valid_ <= forward_meet)
+      {
+        if (cancel && cancel->cancelled()) return std::numeric_limits<double>::max();
+        forwardRelax(forward_valid_++);
+      }
+      meeting_rung_ = forward_meet;
+    }
+  }
+  else
+  {
+    // Both are valid over [backward_valid_, forward_valid_), nothing to relax
+    const size_type edit = last_edit_ == NO_EDIT ? n_rungs - 1 : last_edit_;
+    meeting_rung_ = std::max(backward_valid_, std::min(edit, forward_valid_ - 1));
+  }
+
+  // Join the two halves
+  const auto& distance = forward_[meeting_rung_].cost;
+  const auto& cost_to_go = backward_[meeting_rung_].cost;
+
+  double best = std::numeric_limits<double>::max();
+  meeting_vertex_ = 0;
+  for (size_type i = 0; i < distance.size(); ++i)
+  {
+    const double cost = distance[i] + cost_to_go[i];
+    if (cost < best)
+    {
+      best = cost;
+      meeting_vertex_ = static_cast<predecessor_t>(i);
+    }
+  }
+
+  return best;
+}
+
+std::vector<IncrementalDAGSearch::predecessor_t> IncrementalDAGSearch::shortestPath() const
+{
+  std::vector<predecessor_t> path (forward_.size());
+  if (path.empty()) return path;
+
+  path[meeting_rung_] = meeting_vertex_;
+  for (size_type rung = meeting_rung_; rung > 0; --rung)
+  {
+    path[rung - 1] = forward_[rung].link[path[rung]];
+  }
+  for (size_type rung = meeting_rung_; rung + 1 < path.size(); ++rung)
+  {
+    path[rung + 1] = backward_[rung].link[path[rung]];
+  }
+
+  return path;
+}
+
+void IncrementalDAGSearch::forwardRelax(size_type rung)
+{
+  auto& solution = forward_[rung];
+  const auto n_vertices = graph_.rungSize(rung);
+  solution.cost.assign(n_vertices, std::numeric_limits<double>::max());
+  solution.link.resize(n_vertices);
+
+  relaxRung(graph_.getEdges(rung - 1), forward_[rung - 1].cost.data(), n_vertices, solution.cost.data(),
+            solution.link.data());
+  ++relaxed_rungs_;
+}
+
+void IncrementalDAGSearch::backwardRelax(size_type rung)
+{
+  auto& solution = backward_[rung];
+  const auto& next_cost = backward_[rung + 1].cost;
+  const auto& edges = graph_.getEdges(rung);
+  const auto n_vertices = graph_.rungSize(rung);
+  assert(edges.numVertices() == n_vertices);
+
+  solution.cost.assign(n_vertices, std::numeric_limits<double>::max());
+  solution.link.assign(n_vertices, 0);
+
+  // Pull the cost-to-go of the next rung back along each vertex's out edges
+  for (size_type index = 0; index < n_vertices; ++index)
+  {
+    for (const auto& edge : edges[index])
+    {
+      const double cost = edge.cost + next_cost[edge.idx];
+      if (cost < solution.cost[index])
+      {
+        solution.cost[index] = cost;
+        solution.link[index] = edge.idx;
+      }
+    }
+  }
+  ++relaxed_rungs_;
+}
+
+} // namespace descartes_planner
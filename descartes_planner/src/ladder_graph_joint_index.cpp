@@ -0,0 +1,137 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_joint_index.h"
+#include <algorithm>
+#include <cmath>
+
+namespace descartes_planner
+{
+
+namespace
+{
+// Below this size, or if queries are expected to test more than this fraction of the vertices, filterEdges() over
+// the whole rung is about as fast as sorting it and searching it
+const std::size_t MIN_VERTICES = 1000;
+const double MAX_CANDIDATE_FRACTION = 0.25;
+
+/**
+ * Estimates the fraction of 'n' values within 'max_delta' of one another from a histogram with bins of that width:
+ * a value has about as many neighbours as its own and adjacent bins hold
+ */
+double neighbourFraction(const double* values, std::size_t n, std::size_t stride, double max_delta,
+                         std::vector<unsigned>& bins)
+{
+  double lo = values[0], hi = values[0];
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    const double v = values[j * stride];
+    if (std::isnan(v)) return 1.0; // NaNs pass any limit test and don't sort
+    lo = std::min(lo, v);
+    hi = std::max(hi, v);
+  }
+
+  const double width = std::max(max_delta, (hi - lo) / n);
+  if (!(width > 0.0) || !std::isfinite(hi - lo)) return 1.0;
+
+  bins.assign(static_cast<std::size_t>((hi - lo) / width) + 1, 0u);
+  for (std::size_t j = 0; j < n; ++j)
+    ++bins[std::min(bins.size() - 1, static_cast<std::size_t>((values[j * stride] - lo) / width))];
+
+  double pairs = 0.0;
+  for (std::size_t b = 0; b < bins.size(); ++b)
+  {
+    const double around = bins[b] + (b > 0 ? bins[b - 1] : 0u) + (b + 1 < bins.size() ? bins[b + 1] : 0u);
+    pairs += bins[b] * around;
+  }
+  return std::min(1.0, pairs / (static_cast<double>(n) * n));
+}
+
+// Widens the window past the rounding of 'point +/- max_delta', so that a vertex passing the exact test is never
+// left out of it
+double reach(double max_delta) noexcept
+{
+  return max_delta * (1.0 + 1e-9) + 1e-12;
+}
+}
+
+SortedJointIndex::SortedJointIndex() : dof_(0), joint_(0), candidate_fraction_(1.0)
+{
+}
+
+bool SortedJointIndex::build(const double* joints, size_type n_vertices, size_type dof, const double* max_delta)
+{
+  candidate_fraction_ = 1.0;
+  if (n_vertices < MIN_VERTICES) return false;
+
+  std::vector<unsigned> bins;
+  for (size_type k = 0; k < dof; ++k)
+  {
+    if (!std::isfinite(max_delta[k])) continue;
+    const double fraction = neighbourFraction(joints + k, n_vertices, dof, max_delta[k], bins);
+    if (fraction < candidate_fraction_)
+    {
+      candidate_fraction_ = fraction;
+      joint_ = k;
+    }
+  }
+  if (candidate_fraction_ > MAX_CANDIDATE_FRACTION) return false;
+
+  dof_ = dof;
+  max_delta_.assign(max_delta, max_delta + dof);
+
+  order_.resize(n_vertices);
+  for (size_type j = 0; j < n_vertices; ++j)
+    order_[j] = static_cast<unsigned>(j);
+  // Stable, so that vertices with equal keys stay in increasing order
+  std::stable_sort(order_.begin(), order_.end(), [joints, dof, this](unsigned a, unsigned b) {
+    return joints[a * dof + joint_] < joints[b * dof + joint_];
+  });
+
+  keys_.resize(n_vertices);
+  targets_.resize(n_vertices * dof);
+  for (size_type j = 0; j < n_vertices; ++j)
+  {
+    keys_[j] = joints[order_[j] * dof + joint_];
+    for (size_type k = 0; k < dof; ++k)
+      targets_[k * n_vertices + j] = joints[order_[j] * dof + k];
+  }
+  return true;
+}
+
+SortedJointIndex::size_type SortedJointIndex::query(RelaxationKernel kernel, const double* point, unsigned* indices,
+                                                    double* costs)
+{
+  const double value = point[joint_];
+  size_type first = 0, last = keys_.size();
+  if (!std::isnan(value)) // a NaN is within any distance
+  {
+    first = std::lower_bound(keys_.begin(), keys_.end(), value - reach(max_delta_[joint_])) - keys_.begin();
+    last = std::upper_bound(keys_.begin() + first, keys_.end(), value + reach(max_delta_[joint_])) - keys_.begin();
+  }
+  if (first == last) return 0;
+
+  const auto n = filterEdges(kernel, point, targets_.data() + first, last - first, keys_.size(), dof_,
+                             max_delta_.data(), indices, costs);
+
+  // Back to vertex indices
+  for (size_type i = 0; i < n; ++i)
+    indices[i] = order_[first + indices[i]];
+  return n;
+}
+
+} // namespace descartes_planner
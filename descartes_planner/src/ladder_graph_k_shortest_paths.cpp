@@ -0,0 +1,177 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_k_shortest_paths.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace descartes_planner
+{
+
+namespace
+{
+const std::size_t NO_PARENT = std::numeric_limits<std::size_t>::max();
+
+// A prefix of a path: its last vertex, the prefix it extends, and which of the sorted out edges of the parent's last
+// vertex it took
+struct Prefix
+{
+  double cost;
+  std::size_t parent;
+  unsigned rung;
+  unsigned vertex;
+  unsigned rank;
+};
+
+// Orders the frontier by estimated total cost, then by creation so that ties resolve deterministically
+struct Candidate
+{
+  double estimate;
+  std::size_t prefix;
+
+  bool operator>(const Candidate& other) const noexcept
+  {
+    return estimate > other.estimate || (estimate == other.estimate && prefix > other.prefix);
+  }
+};
+
+std::size_t countDifferences(const std::vector<unsigned>& a, const std::vector<unsigned>& b) noexcept
+{
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    n += a[i] != b[i];
+  return n;
+}
+}
+
+KShortestPaths::KShortestPaths(const LadderGraph& graph) : graph_(graph), candidates_(0)
+{
+}
+
+void KShortestPaths::computeCostToGo()
+{
+  const auto n_rungs = graph_.size();
+  cost_to_go_.resize(n_rungs);
+  cost_to_go_.back().assign(graph_.rungSize(n_rungs - 1), 0.0);
+
+  for (size_type rung = n_rungs - 1; rung-- > 0;)
+  {
+    const auto& next = cost_to_go_[rung + 1];
+    const auto& edges = graph_.getEdges(rung);
+    auto& cost = cost_to_go_[rung];
+    cost.assign(graph_.rungSize(rung), std::numeric_limits<double>::max());
+
+    for (size_type i = 0; i < cost.size(); ++i)
+    {
+      for (const auto& edge : edges[i])
+      {
+        if (next[edge.idx] == std::numeric_limits<double>::max()) continue;
+        cost[i] = std::min(cost[i], edge.cost + next[edge.idx]);
+      }
+    }
+  }
+
+  edge_order_.assign(n_rungs, std::vector<std::vector<unsigned>>());
+  for (size_type rung = 0; rung < n_rungs; ++rung)
+    edge_order_[rung].resize(graph_.rungSize(rung));
+}
+
+const std::vector<unsigned>& KShortestPaths::edgeOrder(size_type rung, size_type vertex)
+{
+  auto& order = edge_order_[rung][vertex];
+  const auto edges = graph_.getEdges(rung)[vertex];
+  if (!order.empty() || edges.empty()) return order;
+
+  const auto& next = cost_to_go_[rung + 1];
+  for (size_type e = 0; e < edges.size(); ++e)
+  {
+    if (next[edges.begin()[e].idx] != std::numeric_limits<double>::max()) order.push_back(static_cast<unsigned>(e));
+  }
+
+  auto estimate = [&](unsigned e) { return edges.begin()[e].cost + next[edges.begin()[e].idx]; };
+  std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return estimate(a) < estimate(b); });
+  return order;
+}
+
+std::vector<KShortestPaths::Path> KShortestPaths::run(size_type k, size_type min_differing_rungs,
+                                                      size_type max_candidates)
+{
+  candidates_ = 0;
+  std::vector<Path> paths;
+  if (graph_.size() == 0 || k == 0) return paths;
+
+  computeCostToGo();
+  const auto last_rung = graph_.size() - 1;
+
+  std::vector<Prefix> prefixes;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier;
+
+  auto push = [&](const Prefix& prefix) {
+    prefixes.push_back(prefix);
+    frontier.push({prefix.cost + cost_to_go_[prefix.rung][prefix.vertex], prefixes.size() - 1});
+  };
+
+  for (size_type i = 0; i < graph_.rungSize(0); ++i)
+  {
+    if (cost_to_go_[0][i] != std::numeric_limits<double>::max())
+      push({0.0, NO_PARENT, 0, static_cast<unsigned>(i), 0});
+  }
+
+  // Each prefix pushes at most two others: the one taking the next best out edge of its parent, and its own
+  // extension along its best out edge. Every path is thus generated exactly once, and the frontier only grows by two
+  // per expansion.
+  std::vector<predecessor_t> vertices (graph_.size());
+  while (!frontier.empty() && paths.size() < k && (max_candidates == 0 || candidates_ < max_candidates))
+  {
+    const auto index = frontier.top().prefix;
+    frontier.pop();
+    const Prefix prefix = prefixes[index]; // copied, push() may reallocate
+
+    if (prefix.parent != NO_PARENT)
+    {
+      const Prefix parent = prefixes[prefix.parent];
+      const auto& order = edgeOrder(parent.rung, parent.vertex);
+      if (prefix.rank + 1 < order.size())
+      {
+        const auto& edge = graph_.getEdges(parent.rung)[parent.vertex].begin()[order[prefix.rank + 1]];
+        push({parent.cost + edge.cost, prefix.parent, prefix.rung, edge.idx, prefix.rank + 1});
+      }
+    }
+
+    if (prefix.rung == last_rung)
+    {
+      ++candidates_;
+      for (auto p = index; p != NO_PARENT; p = prefixes[p].parent)
+        vertices[prefixes[p].rung] = prefixes[p].vertex;
+
+      const bool diverse = std::all_of(paths.begin(), paths.end(), [&](const Path& other) {
+        return countDifferences(vertices, other.vertices) >= min_differing_rungs;
+      });
+      if (diverse) paths.push_back({prefix.cost, vertices});
+      continue;
+    }
+
+    const auto& order = edgeOrder(prefix.rung, prefix.vertex);
+    const auto& edge = graph_.getEdges(prefix.rung)[prefix.vertex].begin()[order.front()];
+    push({prefix.cost + edge.cost, index, prefix.rung + 1, edge.idx, 0});
+  }
+
+  return paths;
+}
+
+} // namespace descartes_planner
@@ -0,0 +1,275 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/ladder_graph_relaxation.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DESCARTES_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace descartes_planner
+{
+
+namespace
+{
+
+// Byte stride between the costs of consecutive edges in a packed Edge array
+static_assert(sizeof(Edge) == 12, "Edge is expected to be packed");
+
+void relaxDenseScalar(const double* src_distance, std::size_t n_src, const Edge* edges, std::size_t n_dst,
+                      double* dst_distance, unsigned* dst_predecessor) noexcept
+{
+  // Row order walks the edge matrix contiguously; it performs the same comparisons, in the same order, as the
+  // gather form of the vector kernels
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    const double u_cost = src_distance[i];
+    const Edge* row = edges + i * n_dst;
+    for (std::size_t j = 0; j < n_dst; ++j)
+    {
+      const double dv = u_cost + row[j].cost;
+      if (dv < dst_distance[j])
+      {
+        dst_distance[j] = dv;
+        dst_predecessor[j] = static_cast<unsigned>(i);
+      }
+    }
+  }
+}
+
+// Finishes the destinations [first, n_dst) that don't fill a whole vector tile
+void relaxDenseColumns(const double* src_distance, std::size_t n_src, const Edge* edges, std::size_t n_dst,
+                       std::size_t first, double* dst_distance, unsigned* dst_predecessor) noexcept
+{
+  for (std::size_t j = first; j < n_dst; ++j)
+  {
+    double best = dst_distance[j];
+    for (std::size_t i = 0; i < n_src; ++i)
+    {
+      const double dv = src_distance[i] + edges[i * n_dst + j].cost;
+      if (dv < best)
+      {
+        best = dv;
+        dst_predecessor[j] = static_cast<unsigned>(i);
+      }
+    }
+    dst_distance[j] = best;
+  }
+}
+
+#ifdef DESCARTES_X86_KERNELS
+
+// Each tile keeps the running minimum and argmin of 16 destinations in registers while streaming over a block of
+// sources. Predecessors are tracked as doubles (exact for any realistic rung size) so they can share the comparison
+// mask; -1 marks a destination that was not improved by the block. Blocking the sources keeps the rows being
+// gathered from in cache across the tiles of a block: without it every tile walks the whole edge matrix.
+const std::size_t TILE_WIDTH = 16;
+const std::size_t SOURCE_BLOCK = 32;
+
+__attribute__((target("avx2")))
+void relaxDenseAVX2(const double* src_distance, std::size_t n_src, const Edge* edges, std::size_t n_dst,
+                    double* dst_distance, unsigned* dst_predecessor) noexcept
+{
+  const __m128i cost_offsets = _mm_setr_epi32(0, 12, 24, 36);
+  const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  const std::size_t n_tiled = n_dst - n_dst % TILE_WIDTH;
+
+  for (std::size_t i0 = 0; i0 < n_src; i0 += SOURCE_BLOCK)
+  {
+    const std::size_t i1 = std::min(n_src, i0 + SOURCE_BLOCK);
+    for (std::size_t j = 0; j < n_tiled; j += TILE_WIDTH)
+    {
+      __m256d best[4], pred[4];
+      for (int k = 0; k < 4; ++k)
+      {
+        best[k] = _mm256_loadu_pd(dst_distance + j + 4 * k);
+        pred[k] = _mm256_set1_pd(-1.0);
+      }
+
+      const Edge* column = edges + i0 * n_dst + j;
+      for (std::size_t i = i0; i < i1; ++i, column += n_dst)
+      {
+        const __m256d u_cost = _mm256_set1_pd(src_distance[i]);
+        const __m256d src_index = _mm256_set1_pd(static_cast<double>(i));
+        for (int k = 0; k < 4; ++k)
+        {
+          const __m256d cost = _mm256_mask_i32gather_pd(_mm256_setzero_pd(),
+                                                        reinterpret_cast<const double*>(column + 4 * k), cost_offsets,
+                                                        all_lanes, 1);
+          const __m256d dv = _mm256_add_pd(u_cost, cost);
+          const __m256d improved = _mm256_cmp_pd(dv, best[k], _CMP_LT_OQ);
+          best[k] = _mm256_blendv_pd(best[k], dv, improved);
+          pred[k] = _mm256_blendv_pd(pred[k], src_index, improved);
+        }
+      }
+
+      for (int k = 0; k < 4; ++k)
+      {
+        double preds[4];
+        _mm256_storeu_pd(dst_distance + j + 4 * k, best[k]);
+        _mm256_storeu_pd(preds, pred[k]);
+        for (int l = 0; l < 4; ++l)
+        {
+          if (preds[l] >= 0.0) dst_predecessor[j + 4 * k + l] = static_cast<unsigned>(preds[l]);
+        }
+      }
+    }
+  }
+
+  relaxDenseColumns(src_distance, n_src, edges, n_dst, n_tiled, dst_distance, dst_predecessor);
+}
+
+__attribute__((target("avx512f")))
+void relaxDenseAVX512(const double* src_distance, std::size_t n_src, const Edge* edges, std::size_t n_dst,
+                      double* dst_distance, unsigned* dst_predecessor) noexcept
+{
+  const __m256i cost_offsets = _mm256_setr_epi32(0, 12, 24, 36, 48, 60, 72, 84);
+  const std::size_t n_tiled = n_dst - n_dst % TILE_WIDTH;
+
+  for (std::size_t i0 = 0; i0 < n_src; i0 += SOURCE_BLOCK)
+  {
+    const std::size_t i1 = std::min(n_src, i0 + SOURCE_BLOCK);
+    for (std::size_t j = 0; j < n_tiled; j += TILE_WIDTH)
+    {
+      __m512d best[2], pred[2];
+      for (int k = 0; k < 2; ++k)
+      {
+        best[k] = _mm512_loadu_pd(dst_distance + j + 8 * k);
+        pred[k] = _mm512_set1_pd(-1.0);
+      }
+
+      const Edge* column = edges + i0 * n_dst + j;
+      for (std::size_t i = i0; i < i1; ++i, column += n_dst)
+      {
+        const __m512d u_cost = _mm512_set1_pd(src_distance[i]);
+        const __m512d src_index = _mm512_set1_pd(static_cast<double>(i));
+        for (int k = 0; k < 2; ++k)
+        {
+          const __m512d cost = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, cost_offsets, column + 8 * k, 1);
+          const __m512d dv = _mm512_add_pd(u_cost, cost);
+          const __mmask8 improved = _mm512_cmp_pd_mask(dv, best[k], _CMP_LT_OQ);
+          best[k] = _mm512_mask_blend_pd(improved, best[k], dv);
+          pred[k] = _mm512_mask_blend_pd(improved, pred[k], src_index);
+        }
+      }
+
+      for (int k = 0; k < 2; ++k)
+      {
+        double preds[8];
+        _mm512_storeu_pd(dst_distance + j + 8 * k, best[k]);
+        _mm512_storeu_pd(preds, pred[k]);
+        for (int l = 0; l < 8; ++l)
+        {
+          if (preds[l] >= 0.0) dst_predecessor[j + 8 * k + l] = static_cast<unsigned>(preds[l]);
+        }
+      }
+    }
+  }
+
+  relaxDenseColumns(src_distance, n_src, edges, n_dst, n_tiled, dst_distance, dst_predecessor);
+}
+
+#endif // DESCARTES_X86_KERNELS
+
+RelaxationKernel detectBestKernel() noexcept
+{
+#ifdef DESCARTES_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return RelaxationKernel::AVX512;
+  if (__builtin_cpu_supports("avx2")) return RelaxationKernel::AVX2;
+#endif
+  return RelaxationKernel::SCALAR;
+}
+
+} // anonymous namespace
+
+RelaxationKernel bestRelaxationKernel() noexcept
+{
+  static const RelaxationKernel best = detectBestKernel();
+  return best;
+}
+
+bool isKernelSupported(RelaxationKernel kernel) noexcept
+{
+  // The kernels are ordered by capability, each host supports everything up to its best
+  return static_cast<int>(kernel) <= static_cast<int>(bestRelaxationKernel());
+}
+
+const char* toString(RelaxationKernel kernel) noexcept
+{
+  switch (kernel)
+  {
+    case RelaxationKernel::AVX2:
+      return "avx2";
+    case RelaxationKernel::AVX512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+void relaxDense(RelaxationKernel kernel, const double* src_distance, std::size_t n_src, const Edge* edges,
+                std::size_t n_dst, double* dst_distance, unsigned* dst_predecessor) noexcept
+{
+  assert(isKernelSupported(kernel));
+  switch (kernel)
+  {
+#ifdef DESCARTES_X86_KERNELS
+    case RelaxationKernel::AVX512:
+      relaxDenseAVX512(src_distance, n_src, edges, n_dst, dst_distance, dst_predecessor);
+      break;
+    case RelaxationKernel::AVX2:
+      relaxDenseAVX2(src_distance, n_src, edges, n_dst, dst_distance, dst_predecessor);
+      break;
+#endif
+    default:
+      relaxDenseScalar(src_distance, n_src, edges, n_dst, dst_distance, dst_predecessor);
+      break;
+  }
+}
+
+void relaxRung(const RungEdges& edges, const double* src_distance, std::size_t n_dst, double* dst_distance,
+               unsigned* dst_predecessor) noexcept
+{
+  const auto n_src = edges.numVertices();
+
+  if (n_dst > 0 && edges.denseTargets() == n_dst && edges.numEdges() == n_src * n_dst)
+  {
+    relaxDense(bestRelaxationKernel(), src_distance, n_src, edges.edges().data(), n_dst, dst_distance,
+               dst_predecessor);
+    return;
+  }
+
+  for (std::size_t index = 0; index < n_src; ++index)
+  {
+    const auto u_cost = src_distance[index];
+    // for each out edge
+    for (const auto& edge : edges[index])
+    {
+      auto dv = u_cost + edge.cost; // new cost
+      if (dv < dst_distance[edge.idx])
+      {
+        dst_distance[edge.idx] = dv;
+        dst_predecessor[edge.idx] = static_cast<unsigned>(index); // the predecessor's rung is implied
+      }
+    }
+  }
+}
+
+} // namespace descartes_planner
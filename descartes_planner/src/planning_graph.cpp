@@ -25,8 +25,12 @@
 
 #include "descartes_planner/planning_graph.h"
 #include "descartes_planner/ladder_graph_dag_search.h"
+#include "descartes_planner/ladder_graph_k_shortest_paths.h"
 #include "descartes_planner/planning_graph_edge_policy.h"
 #include <ros/console.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 using namespace descartes_core;
 using namespace descartes_trajectory;
@@ -34,41 +38,122 @@ using namespace descartes_trajectory;
 namespace descartes_planner
 {
 
+BatchCostFunction toBatchCostFunction(CostFunction fn, std::size_t dof)
+{
+  if (!fn) return BatchCostFunction();
+
+  return BatchCostFunction([fn, dof](const double* start, const double* end_joints, std::size_t n_end, double* costs) {
+    for (std::size_t j = 0; j < n_end; ++j)
+      costs[j] = fn(start, end_joints + j * dof);
+  });
+}
+
+const char* toString(BuildFailure::Reason reason) noexcept
+{
+  switch (reason)
+  {
+    case BuildFailure::NONE:
+      return "none";
+    case BuildFailure::TOO_FEW_POINTS:
+      return "too few points";
+    case BuildFailure::IK_FAILED:
+      return "IK failed";
+    case BuildFailure::NO_EDGES:
+      return "no edges";
+    case BuildFailure::CANCELLED:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
 PlanningGraph::PlanningGraph(RobotModelConstPtr model, CostFunction cost_function_callback)
-  : graph_(model->getDOF()), robot_model_(std::move(model)), custom_cost_function_(cost_function_callback)
+  : PlanningGraph(model, toBatchCostFunction(cost_function_callback, model->getDOF()))
+{}
+
+PlanningGraph::PlanningGraph(RobotModelConstPtr model, BatchCostFunction cost_function_callback)
+  : graph_(model->getDOF()), robot_model_(std::move(model)), custom_cost_function_(std::move(cost_function_callback))
+  , search_threads_(1), task_pool_(std::make_shared<TaskPool>()), implicit_edges_(false), max_out_edges_(0)
+  , search_(graph_)
+  , beam_validation_(false)
 {}
 
-bool PlanningGraph::insertGraph(const std::vector<TrajectoryPtPtr>& points)
+void PlanningGraph::setTaskPool(std::shared_ptr<TaskPool> pool)
 {
+  task_pool_ = pool ? std::move(pool) : std::make_shared<TaskPool>(1);
+}
+
+bool PlanningGraph::insertGraph(const std::vector<TrajectoryPtPtr>& points, const CancellationToken& caller)
+{
+  build_failure_ = BuildFailure();
   if (points.size() < 2)
   {
     ROS_ERROR_STREAM(__FUNCTION__ << ": must provide at least 2 input trajectory points.");
+    build_failure_.reason = BuildFailure::TOO_FEW_POINTS;
     return false;
   }
 
   if (graph_.size() > 0) clear();
 
-  // generate solutions for this point
-  std::vector<std::vector<std::vector<double>>> all_joint_sols;
-  if (!calculateJointSolutions(points.data(), points.size(), all_joint_sols))
-  {
-    return false;
-  }
-
-  // insert into graph as vertices
+  // The IDs & timing go in first, the edges between two rungs depending on the timing of the second
   graph_.resize(points.size());
   for (std::size_t i = 0; i < points.size(); ++i)
   {
-    graph_.assignRung(i, points[i]->getID(), points[i]->getTiming(), all_joint_sols[i]);
+    graph_.assignRung(i, points[i]->getID(), points[i]->getTiming(), std::vector<std::vector<double>>());
   }
 
-  // now we have a graph with data in the 'rungs' and we need to compute the edges
-  #pragma omp parallel for
-  for (std::size_t i = 0; i < graph_.size() - 1; ++i)
+  // IK and edges are computed in one pipelined pass: the solutions of each point go straight into its rung, and the
+  // edges between two rungs are computed by whichever thread finishes the second of them. ready[i] counts the
+  // finished rungs of the pair (i, i + 1).
+  const std::size_t n_pairs = points.size() - 1;
+  std::unique_ptr<std::atomic<int>[]> ready(new std::atomic<int>[n_pairs]);
+  for (std::size_t i = 0; i < n_pairs; ++i)
+    ready[i] = 0;
+
+  // The first failure is recorded and cancels the rest of the build, as does the caller's token
+  CancellationToken cancel(&caller);
+  std::mutex failure_mutex;
+  auto fail = [&](BuildFailure::Reason reason, std::size_t rung) {
+    std::lock_guard<std::mutex> lock(failure_mutex);
+    if (cancel.cancelled()) return;
+    build_failure_.reason = reason;
+    build_failure_.rung = rung;
+    build_failure_.id = points[rung]->getID();
+    cancel.cancel();
+  };
+
+  task_pool_->parallelFor(points.size(), [&](std::size_t i) {
+    std::vector<std::vector<double>> joint_poses;
+    points[i]->getJointPoses(*robot_model_, joint_poses);
+    if (joint_poses.empty())
+    {
+      fail(BuildFailure::IK_FAILED, i);
+      return;
+    }
+    graph_.assignVertices(i, joint_poses);
+
+    if (i > 0 && ready[i - 1].fetch_add(1) == 1 && !computeAndAssignEdges(i - 1, i, &cancel))
+      fail(BuildFailure::NO_EDGES, i - 1);
+    if (i < n_pairs && ready[i].fetch_add(1) == 1 && !computeAndAssignEdges(i, i + 1, &cancel))
+      fail(BuildFailure::NO_EDGES, i);
+  }, cancel);
+
+  if (cancel.cancelled())
   {
-    computeAndAssignEdges(i, i + 1);
+    if (build_failure_.reason == BuildFailure::NONE)
+    {
+      build_failure_.reason = BuildFailure::CANCELLED;
+      ROS_ERROR_STREAM(__FUNCTION__ << ": cancelled" << (caller.expired() ? ", the deadline passed" : ""));
+    }
+    else
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": " << toString(build_failure_.reason) << " at input trajectory point "
+                       << build_failure_.rung << " with ID = " << build_failure_.id);
+    }
+    clear();
+    return false;
   }
 
+  search_.reset();
   return true;
 }
 
@@ -102,6 +187,7 @@ bool PlanningGraph::addTrajectory(TrajectoryPtPtr point, TrajectoryPt::ID previo
     computeAndAssignEdges(insert_idx, next_idx);
   }
 
+  search_.rungInserted(insert_idx);
   return true;
 }
 
@@ -134,6 +220,7 @@ bool PlanningGraph::modifyTrajectory(TrajectoryPtPtr point)
     computeAndAssignEdges(idx, next_idx);
   }
 
+  search_.rungModified(idx);
   return true;
 }
 
@@ -156,16 +243,110 @@ bool PlanningGraph::removeTrajectory(const TrajectoryPt::ID& point)
     computeAndAssignEdges(prev_idx, next_idx);
   }
 
+  search_.rungRemoved(s.first);
   return true;
 }
 
 bool PlanningGraph::getShortestPath(double& cost, std::list<JointTrajectoryPt>& path)
 {
-  DAGSearch search (graph_);
-  cost = search.run();
-  if (cost == std::numeric_limits<double>::max()) return false;
+  return getShortestPath(cost, path, CancellationToken());
+}
 
-  auto path_idxs = search.shortestPath();
+bool PlanningGraph::getShortestPath(double& cost, std::list<JointTrajectoryPt>& path,
+                                    const CancellationToken& cancel)
+{
+  if (cancel.cancelled())
+  {
+    ROS_ERROR_STREAM(__FUNCTION__ << ": cancelled before the search started");
+    return false;
+  }
+
+  std::vector<unsigned> path_idxs;
+  if (implicit_edges_)
+  {
+    std::size_t pruned = 0;
+    cost = searchImplicitEdges(path_idxs, beam_, pruned, &cancel);
+    if (cancel.cancelled())
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": search cancelled");
+      return false;
+    }
+    if (beam_.enabled())
+    {
+      double exact_cost = cost;
+      if (beam_validation_)
+      {
+        std::vector<unsigned> exact_path;
+        std::size_t none_pruned;
+        exact_cost = searchImplicitEdges(exact_path, BeamParameters(), none_pruned);
+      }
+      recordBeamSearch(cost, pruned, beam_validation_ ? &exact_cost : nullptr);
+    }
+    if (cost == std::numeric_limits<double>::max()) return false;
+  }
+  else if (beam_.enabled())
+  {
+    BeamDAGSearch search (graph_, beam_);
+    cost = search.run();
+    double exact_cost = cost;
+    if (beam_validation_) exact_cost = search_.run();
+    recordBeamSearch(cost, search.prunedVertices(), beam_validation_ ? &exact_cost : nullptr);
+    if (cost == std::numeric_limits<double>::max()) return false;
+    path_idxs = search.shortestPath();
+  }
+  else if (search_threads_ > 1)
+  {
+    DAGSearch search (graph_);
+    cost = search.runParallel(search_threads_);
+    if (cost == std::numeric_limits<double>::max()) return false;
+    path_idxs = search.shortestPath();
+  }
+  else
+  {
+    cost = search_.run(&cancel);
+    if (cancel.cancelled())
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": search cancelled");
+      return false;
+    }
+    if (cost == std::numeric_limits<double>::max()) return false;
+    path_idxs = search_.shortestPath();
+  }
+
+  toJointPath(path_idxs, path);
+
+  ROS_INFO("Computed path of length %lu with cost %lf", path_idxs.size(), cost);
+
+  return true;
+}
+
+bool PlanningGraph::getShortestPaths(std::size_t k, std::size_t min_differing_points, std::size_t max_candidates,
+                                     std::vector<double>& costs, std::vector<std::list<JointTrajectoryPt>>& paths) const
+{
+  if (implicit_edges_)
+  {
+    ROS_ERROR_STREAM(__FUNCTION__ << ": alternative paths require stored edges, disable implicit edges first");
+    return false;
+  }
+
+  KShortestPaths search (graph_);
+  const auto found = search.run(k, min_differing_points, max_candidates);
+  if (found.empty()) return false;
+
+  for (const auto& p : found)
+  {
+    costs.push_back(p.cost);
+    paths.emplace_back();
+    toJointPath(p.vertices, paths.back());
+  }
+
+  ROS_INFO("Computed %lu alternative paths out of %lu candidates, costs %lf to %lf", found.size(),
+           search.candidates(), found.front().cost, found.back().cost);
+  return true;
+}
+
+void PlanningGraph::toJointPath(const std::vector<unsigned>& path_idxs, std::list<JointTrajectoryPt>& path) const
+{
   const auto dof = graph_.dof();
 
   for (size_t i = 0; i < path_idxs.size(); ++i)
@@ -177,104 +358,150 @@ bool PlanningGraph::getShortestPath(double& cost, std::list<JointTrajectoryPt>&
     auto pt = JointTrajectoryPt(std::vector<double>(data, data + dof), tm);
     path.push_back(std::move(pt));
   }
-
-  ROS_INFO("Computed path of length %lu with cost %lf", path_idxs.size(), cost);
-
-  return true;
 }
 
 bool PlanningGraph::calculateJointSolutions(const TrajectoryPtPtr* points, const std::size_t count,
                                             std::vector<std::vector<std::vector<double>>>& poses) const
 {
   poses.resize(count);
-  bool success = true;
+  CancellationToken failed;
 
-  #pragma omp parallel for shared(success)
-  for (std::size_t i = 0; i < count; ++i)
-  {
-    if (success)
-    {
-      std::vector<std::vector<double>> joint_poses;
-      points[i]->getJointPoses(*robot_model_, joint_poses);
+  task_pool_->parallelFor(count, [&](std::size_t i) {
+    std::vector<std::vector<double>> joint_poses;
+    points[i]->getJointPoses(*robot_model_, joint_poses);
 
-      if (joint_poses.empty())
-      {
-        ROS_ERROR_STREAM(__FUNCTION__ << ": IK failed for input trajectory point with ID = " << points[i]->getID());
-        success = false;
-      }
-
-      poses[i] = std::move(joint_poses);
+    if (joint_poses.empty())
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": IK failed for input trajectory point with ID = " << points[i]->getID());
+      failed.cancel();
     }
-  }
 
-  return success;
+    poses[i] = std::move(joint_poses);
+  }, failed);
+
+  return !failed.cancelled();
 }
 
-void PlanningGraph::computeAndAssignEdges(const std::size_t start_idx, const std::size_t end_idx)
+bool PlanningGraph::computeAndAssignEdges(const std::size_t start_idx, const std::size_t end_idx,
+                                          const CancellationToken* cancel)
 {
   assert(end_idx > start_idx);
   assert(end_idx - start_idx == 1);
 
+  // Edges are evaluated during the search instead
+  if (implicit_edges_) return true;
+
   const auto& joints1 = graph_.getRung(start_idx).data;
   const auto& joints2 = graph_.getRung(end_idx).data;
-  const auto& tm = graph_.getRung(end_idx).timing;
   const auto dof = robot_model_->getDOF();
 
-  const auto start_size = joints1.size() / dof;
-  const auto end_size = joints2.size() / dof;
-
   bool b;
-  std::vector<LadderGraph::EdgeList> edges;
+  RungEdges edges;
+  withEdgeBuilder<RungEdges>(start_idx, end_idx, [&](auto& builder) {
+    edges = calculateEdgeWeights(builder, joints1, joints2, dof, cancel, b);
+  });
 
-  if (!custom_cost_function_ && tm.isSpecified())
-  {
-    DefaultEdgesWithTime builder (start_size, end_size, dof, tm.upper, robot_model_->getJointVelocityLimits());
-    edges = calculateEdgeWeights(builder, joints1, joints2, dof, b);
-  }
-  else if (custom_cost_function_ && tm.isSpecified())
+  graph_.assignEdges(start_idx, std::move(edges));
+  // insertGraph() reports its own failures
+  if (!b && !cancel) ROS_WARN("No edges between user input points at index %lu and %lu", start_idx, end_idx);
+  return b;
+}
+
+template <typename Sink, typename Fn>
+void PlanningGraph::withEdgeBuilder(const std::size_t start_idx, const std::size_t end_idx, Fn&& fn) const
+{
+  descartes_planner::withEdgeBuilder<Sink>(graph_.rungSize(start_idx), graph_.rungSize(end_idx),
+                                           robot_model_->getDOF(), graph_.getRung(end_idx).timing,
+                                           robot_model_->getJointVelocityLimits(), custom_cost_function_,
+                                           max_out_edges_, std::forward<Fn>(fn));
+}
+
+void PlanningGraph::setImplicitEdges(bool implicit)
+{
+  if (implicit == implicit_edges_) return;
+  implicit_edges_ = implicit;
+
+  for (std::size_t i = 0; i < graph_.size(); ++i)
   {
-    CustomEdgesWithTime builder (start_size, end_size, dof, tm.upper, robot_model_->getJointVelocityLimits(), custom_cost_function_);
-    edges = calculateEdgeWeights(builder, joints1, joints2, dof, b);
+    graph_.getEdges(i).resize(graph_.rungSize(i));
+    graph_.getEdges(i).shrink_to_fit();
   }
-  else if (!custom_cost_function_ && !tm.isSpecified())
+
+  if (!implicit_edges_ && graph_.size() > 0)
   {
-    DefaultEdgesWithoutTime builder (start_size, end_size, dof);
-    edges = calculateEdgeWeights(builder, joints1, joints2, dof, b);
+    task_pool_->parallelFor(graph_.size() - 1, [this](std::size_t i) { computeAndAssignEdges(i, i + 1); });
   }
-  else
+
+  search_.reset();
+}
+
+void PlanningGraph::recordBeamSearch(double cost, std::size_t pruned, const double* exact_cost)
+{
+  beam_stats_.record(cost, pruned, exact_cost);
+  if (exact_cost && cost != *exact_cost)
   {
-    CustomEdgesWithoutTime builder (start_size, end_size, dof, custom_cost_function_);
-    edges = calculateEdgeWeights(builder, joints1, joints2, dof, b);
+    ROS_DEBUG_STREAM("Beam search found a path of cost " << cost << ", the shortest path costs " << *exact_cost
+                     << " (" << beam_stats_.cost_changed + beam_stats_.failed << " of " << beam_stats_.validated
+                     << " searches changed)");
   }
-
-  graph_.assignEdges(start_idx, std::move(edges));
-  if (!b) ROS_WARN("No edges between user input points at index %lu and %lu", start_idx, end_idx);
 }
 
-template<typename EdgeBuilder>
-std::vector<LadderGraph::EdgeList> PlanningGraph::calculateEdgeWeights(EdgeBuilder&& builder, const std::vector<double>& start_joints,
-                                                                       const std::vector<double>& end_joints, const size_t dof,
-                                                                       bool& has_edges) const
+double PlanningGraph::searchImplicitEdges(std::vector<unsigned>& path, const BeamParameters& beam,
+                                          std::size_t& pruned, const CancellationToken* cancel) const
 {
-  const auto from_size = start_joints.size();
-  const auto to_size = end_joints.size();
-  const auto n_start_points = from_size / dof;
-  const auto n_end_points = to_size / dof;
+  pruned = 0;
+  const auto n_rungs = graph_.size();
+  const auto dof = graph_.dof();
+  if (n_rungs == 0) return std::numeric_limits<double>::max();
+
+  std::vector<std::vector<unsigned>> predecessors (n_rungs);
+  std::vector<double> distance (graph_.rungSize(0), 0.0);
+  std::vector<double> next_distance;
 
-  for (size_t i = 0; i < n_start_points; i++) // from rung
+  for (std::size_t rung = 0; rung + 1 < n_rungs; ++rung)
   {
-    const auto start_index = i * dof;
+    if (cancel && cancel->cancelled()) return std::numeric_limits<double>::max();
 
-    for (size_t j = 0; j < n_end_points; j++) // to rung
-    {
-      const auto end_index = j * dof;
+    const auto next_rung = rung + 1;
+    const auto& start_joints = graph_.getRung(rung).data;
+    const auto& end_joints = graph_.getRung(next_rung).data;
+    const auto n_end = graph_.rungSize(next_rung);
 
-      builder.consider(&start_joints[start_index], &end_joints[end_index], j);
-    }
+    next_distance.assign(n_end, std::numeric_limits<double>::max());
+    predecessors[next_rung].assign(n_end, 0);
+
+    withEdgeBuilder<RelaxingSink>(rung, next_rung, [&](auto& builder) {
+      builder.result().attach(distance.data(), next_distance.data(), predecessors[next_rung].data());
+      // Edges out of unreachable vertices can't improve anything, so don't bother evaluating them
+      buildEdges(builder, start_joints, end_joints, dof,
+                 [&distance](std::size_t i) { return distance[i] == std::numeric_limits<double>::max(); });
+    });
+
+    distance.swap(next_distance);
+    if (beam.enabled() && next_rung + 1 < n_rungs) pruned += pruneRung(distance, beam);
+  }
 
-    builder.next(i);
+  if (distance.empty()) return std::numeric_limits<double>::max();
+
+  const auto min_it = std::min_element(distance.begin(), distance.end());
+  path.resize(n_rungs);
+  path.back() = static_cast<unsigned>(std::distance(distance.begin(), min_it));
+  for (std::size_t rung = n_rungs - 1; rung > 0; --rung)
+  {
+    path[rung - 1] = predecessors[rung][path[rung]];
   }
 
+  return *min_it;
+}
+
+template<typename EdgeBuilder>
+RungEdges PlanningGraph::calculateEdgeWeights(EdgeBuilder&& builder, const std::vector<double>& start_joints,
+                                              const std::vector<double>& end_joints, const size_t dof,
+                                              const CancellationToken* cancel, bool& has_edges) const
+{
+  buildEdges(builder, start_joints, end_joints, dof,
+             [cancel](std::size_t) { return cancel && cancel->cancelled(); });
+
   has_edges = builder.hasEdges();
   return std::move(builder.result());
 }
@@ -103,6 +103,14 @@ bool SparsePlanner::initialize(RobotModelConstPtr model, descartes_planner::Cost
   return true;
 }
 
+bool SparsePlanner::initialize(RobotModelConstPtr model, descartes_planner::BatchCostFunction cost_function_callback)
+{
+  planning_graph_ = boost::shared_ptr<descartes_planner::PlanningGraph>(
+      new descartes_planner::PlanningGraph(std::move(model), std::move(cost_function_callback)));
+  error_code_ = PlannerError::EMPTY_PATH;
+  return true;
+}
+
 bool SparsePlanner::setConfig(const descartes_core::PlannerConfig& config)
 {
   std::stringstream ss;
@@ -159,6 +167,7 @@ bool SparsePlanner::planPath(const std::vector<TrajectoryPtPtr>& traj)
   ros::Time start_time = ros::Time::now();
 
   cart_points_.assign(traj.begin(), traj.end());
+  cart_points_index_.clear();
   std::vector<TrajectoryPtPtr> sparse_trajectory_array;
   sampleTrajectory(sampling_, cart_points_, sparse_trajectory_array);
   ROS_INFO_STREAM("Sampled trajectory contains " << sparse_trajectory_array.size() << " points from "
@@ -209,6 +218,7 @@ bool SparsePlanner::addAfter(const TrajectoryPt::ID& ref_id, TrajectoryPtPtr cp)
   auto pos = cart_points_.begin();
   std::advance(pos, index + 1);
   cart_points_.insert(pos, cp);
+  cart_points_index_.invalidateFrom(index + 1);
 
   // replanning
   if (planning_graph_->addTrajectory(cp, prev_id, next_id) && plan())
@@ -254,6 +264,7 @@ bool SparsePlanner::addBefore(const TrajectoryPt::ID& ref_id, TrajectoryPtPtr cp
   auto pos = cart_points_.begin();
   std::advance(pos, index);
   cart_points_.insert(pos, cp);
+  cart_points_index_.invalidateFrom(index);
 
   if (planning_graph_->addTrajectory(cp, prev_id, next_id) && plan())
   {
@@ -293,6 +304,7 @@ bool SparsePlanner::remove(const TrajectoryPt::ID& ref_id)
   auto pos = cart_points_.begin();
   std::advance(pos, index);
   cart_points_.erase(pos);
+  cart_points_index_.invalidateFrom(index);
 
   if (plan())
   {
@@ -339,6 +351,7 @@ bool SparsePlanner::modify(const TrajectoryPt::ID& ref_id, TrajectoryPtPtr cp)
 
   int index = getDensePointIndex(ref_id);
   cart_points_[index] = cp;
+  cart_points_index_.assign(index, cp->getID());
   if (plan())
   {
     int planned_count = sparse_solution_array_.size();
@@ -356,47 +369,39 @@ bool SparsePlanner::modify(const TrajectoryPt::ID& ref_id, TrajectoryPtPtr cp)
 
 bool SparsePlanner::isInSparseTrajectory(const TrajectoryPt::ID& ref_id)
 {
-  auto predicate = [&ref_id](std::tuple<int, TrajectoryPtPtr, JointTrajectoryPt>& t)
-  {
-    return ref_id == std::get<1>(t)->getID();
-  };
-
-  return (std::find_if(sparse_solution_array_.begin(), sparse_solution_array_.end(), predicate) !=
-          sparse_solution_array_.end());
+  return getSparsePointIndex(ref_id) != INVALID_INDEX;
 }
 
 int SparsePlanner::getDensePointIndex(const TrajectoryPt::ID& ref_id)
 {
-  int index = INVALID_INDEX;
-  auto predicate = [&ref_id](TrajectoryPtPtr cp)
+  auto s = cart_points_index_.find(ref_id, cart_points_.size(), [this](std::size_t i)
   {
-    return ref_id == cp->getID();
-  };
+    return cart_points_[i]->getID();
+  });
 
-  auto pos = std::find_if(cart_points_.begin(), cart_points_.end(), predicate);
-  if (pos != cart_points_.end())
-  {
-    index = std::distance(cart_points_.begin(), pos);
-  }
-
-  return index;
+  return s.second ? static_cast<int>(s.first) : INVALID_INDEX;
 }
 
 int SparsePlanner::getSparsePointIndex(const TrajectoryPt::ID& ref_id)
 {
-  int index = INVALID_INDEX;
-  auto predicate = [ref_id](std::tuple<int, TrajectoryPtPtr, JointTrajectoryPt>& t)
+  int dense_index = getDensePointIndex(ref_id);
+  if (dense_index == INVALID_INDEX)
   {
-    return ref_id == std::get<1>(t)->getID();
-  };
+    return INVALID_INDEX;
+  }
 
-  auto pos = std::find_if(sparse_solution_array_.begin(), sparse_solution_array_.end(), predicate);
-  if (pos != sparse_solution_array_.end())
+  // The sparse points are a subsequence of the dense ones
+  auto pos = std::lower_bound(sparse_solution_array_.begin(), sparse_solution_array_.end(), dense_index,
+                              [](const std::tuple<int, TrajectoryPtPtr, JointTrajectoryPt>& t, int index)
   {
-    index = std::distance(sparse_solution_array_.begin(), pos);
+    return std::get<0>(t) < index;
+  });
+  if (pos == sparse_solution_array_.end() || std::get<0>(*pos) != dense_index || std::get<1>(*pos)->getID() != ref_id)
+  {
+    return INVALID_INDEX;
   }
 
-  return index;
+  return std::distance(sparse_solution_array_.begin(), pos);
 }
 
 int SparsePlanner::findNearestSparsePointIndex(const TrajectoryPt::ID& ref_id, bool skip_equal)
@@ -409,20 +414,14 @@ int SparsePlanner::findNearestSparsePointIndex(const TrajectoryPt::ID& ref_id, b
     return index;
   }
 
-  auto predicate = [&dense_index, &skip_equal](std::tuple<int, TrajectoryPtPtr, JointTrajectoryPt>& t)
+  // First sparse point after the dense one, or at it unless 'skip_equal'
+  auto compare = [](int index, const std::tuple<int, TrajectoryPtPtr, JointTrajectoryPt>& t)
   {
-
-    if (skip_equal)
-    {
-      return dense_index < std::get<0>(t);
-    }
-    else
-    {
-      return dense_index <= std::get<0>(t);
-    }
+    return index < std::get<0>(t);
   };
 
-  auto pos = std::find_if(sparse_solution_array_.begin(), sparse_solution_array_.end(), predicate);
+  auto pos = std::upper_bound(sparse_solution_array_.begin(), sparse_solution_array_.end(),
+                              skip_equal ? dense_index : dense_index - 1, compare);
   if (pos != sparse_solution_array_.end())
   {
     index = std::distance(sparse_solution_array_.begin(), pos);
@@ -0,0 +1,229 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/streaming_ladder_solver.h"
+#include "descartes_planner/planning_graph_edge_policy.h"
+#include <ros/console.h>
+#include <algorithm>
+#include <cstring>
+
+namespace descartes_planner
+{
+
+namespace
+{
+template <typename T>
+void appendAs(const unsigned* indices, std::size_t n, std::uint8_t* out) noexcept
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const T value = static_cast<T>(indices[i]);
+    std::memcpy(out + i * sizeof(T), &value, sizeof(T));
+  }
+}
+
+template <typename T>
+unsigned getAs(const std::uint8_t* data, std::size_t index) noexcept
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return value;
+}
+}
+
+void CompactIndexStore::append(const unsigned* indices, size_type n, size_type range)
+{
+  Row row;
+  row.offset = data_.size();
+  row.width = range <= (1u << 8) ? 1 : range <= (1u << 16) ? 2 : 4;
+  rows_.push_back(row);
+
+  data_.resize(data_.size() + n * row.width);
+  auto* out = data_.data() + row.offset;
+  switch (row.width)
+  {
+    case 1:
+      appendAs<std::uint8_t>(indices, n, out);
+      break;
+    case 2:
+      appendAs<std::uint16_t>(indices, n, out);
+      break;
+    default:
+      appendAs<std::uint32_t>(indices, n, out);
+      break;
+  }
+}
+
+unsigned CompactIndexStore::get(size_type row, size_type index) const noexcept
+{
+  assert(row < rows_.size());
+  const auto& r = rows_[row];
+  const auto* data = data_.data() + r.offset;
+  switch (r.width)
+  {
+    case 1:
+      return getAs<std::uint8_t>(data, index);
+    case 2:
+      return getAs<std::uint16_t>(data, index);
+    default:
+      return getAs<std::uint32_t>(data, index);
+  }
+}
+
+void CompactIndexStore::clear()
+{
+  rows_.clear();
+  data_.clear();
+}
+
+CompactIndexStore::size_type CompactIndexStore::memoryUsage() const noexcept
+{
+  return rows_.capacity() * sizeof(Row) + data_.capacity();
+}
+
+StreamingLadderSolver::StreamingLadderSolver(descartes_core::RobotModelConstPtr model,
+                                             CostFunction cost_function_callback)
+  : StreamingLadderSolver(model, toBatchCostFunction(cost_function_callback, model->getDOF()))
+{}
+
+StreamingLadderSolver::StreamingLadderSolver(descartes_core::RobotModelConstPtr model,
+                                             BatchCostFunction cost_function_callback)
+  : robot_model_(std::move(model)), custom_cost_function_(std::move(cost_function_callback))
+{}
+
+bool StreamingLadderSolver::solve(std::size_t n_rungs, const RungProducer& producer, double& cost,
+                                  std::list<descartes_trajectory::JointTrajectoryPt>& path)
+{
+  if (n_rungs < 2)
+  {
+    ROS_ERROR_STREAM(__FUNCTION__ << ": must provide at least 2 input trajectory points.");
+    return false;
+  }
+
+  const std::size_t dof = robot_model_->getDOF();
+  const auto vel_limits = robot_model_->getJointVelocityLimits();
+  predecessors_.clear();
+
+  std::vector<double> start_joints, end_joints;
+  descartes_core::TimingConstraint start_tm, end_tm;
+  if (!producer(0, start_joints, start_tm) || start_joints.empty())
+  {
+    ROS_ERROR_STREAM(__FUNCTION__ << ": no joint solutions for rung 0");
+    return false;
+  }
+
+  // the number of solutions of each rung, to tell whether the producer gives the same ones on the final pass
+  std::vector<std::size_t> rung_sizes (n_rungs);
+  rung_sizes[0] = start_joints.size();
+
+  std::vector<double> distance (start_joints.size() / dof, 0.0);
+  std::vector<double> next_distance;
+  std::vector<unsigned> predecessor;
+
+  // Forward pass: relax each rung into the next as soon as it has been produced
+  for (std::size_t rung = 1; rung < n_rungs; ++rung)
+  {
+    if (!producer(rung, end_joints, end_tm) || end_joints.empty())
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": no joint solutions for rung " << rung);
+      return false;
+    }
+
+    rung_sizes[rung] = end_joints.size();
+    const auto n_start = start_joints.size() / dof;
+    const auto n_end = end_joints.size() / dof;
+    next_distance.assign(n_end, std::numeric_limits<double>::max());
+    predecessor.assign(n_end, 0);
+
+    withEdgeBuilder<RelaxingSink>(n_start, n_end, dof, end_tm, vel_limits, custom_cost_function_,
+                                  [&](auto& builder) {
+      builder.result().attach(distance.data(), next_distance.data(), predecessor.data());
+      buildEdges(builder, start_joints, end_joints, dof,
+                 [&distance](std::size_t i) { return distance[i] == std::numeric_limits<double>::max(); });
+    });
+
+    if (std::all_of(next_distance.begin(), next_distance.end(),
+                    [](double d) { return d == std::numeric_limits<double>::max(); }))
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": no path reaches rung " << rung);
+      return false;
+    }
+
+    predecessors_.append(predecessor.data(), n_end, n_start);
+    distance.swap(next_distance);
+    start_joints.swap(end_joints);
+    start_tm = end_tm;
+  }
+
+  // Walk the predecessors back from the cheapest vertex of the last rung
+  const auto min_it = std::min_element(distance.begin(), distance.end());
+  cost = *min_it;
+
+  std::vector<unsigned> chosen (n_rungs);
+  chosen.back() = static_cast<unsigned>(std::distance(distance.begin(), min_it));
+  for (std::size_t rung = n_rungs - 1; rung > 0; --rung)
+  {
+    chosen[rung - 1] = predecessors_.get(rung - 1, chosen[rung]);
+  }
+
+  // Recover the joint values of the chosen vertices
+  std::list<descartes_trajectory::JointTrajectoryPt> result;
+  for (std::size_t rung = 0; rung < n_rungs; ++rung)
+  {
+    if (!producer(rung, end_joints, end_tm) || end_joints.size() != rung_sizes[rung])
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": rung " << rung << " changed between passes, the producer must be "
+                                    << "deterministic");
+      return false;
+    }
+
+    const auto* data = end_joints.data() + chosen[rung] * dof;
+    result.emplace_back(std::vector<double>(data, data + dof), end_tm);
+  }
+
+  path.splice(path.end(), result);
+  ROS_INFO("Computed path of length %lu with cost %lf", n_rungs, cost);
+  return true;
+}
+
+bool StreamingLadderSolver::solve(const std::vector<descartes_core::TrajectoryPtPtr>& points, double& cost,
+                                  std::list<descartes_trajectory::JointTrajectoryPt>& path)
+{
+  const auto& model = *robot_model_;
+  std::vector<std::vector<double>> joint_poses;
+
+  auto producer = [&](std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing) {
+    joint_poses.clear();
+    points[index]->getJointPoses(model, joint_poses);
+    if (joint_poses.empty())
+    {
+      ROS_ERROR_STREAM(__FUNCTION__ << ": IK failed for input trajectory point with ID = "
+                                    << points[index]->getID());
+      return false;
+    }
+
+    joints.clear();
+    for (const auto& sol : joint_poses)
+      joints.insert(joints.end(), sol.begin(), sol.end());
+    timing = points[index]->getTiming();
+    return true;
+  };
+
+  return solve(points.size(), producer, cost, path);
+}
+
+} // namespace descartes_planner
@@ -0,0 +1,325 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "descartes_planner/task_pool.h"
+#include <ros/console.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace descartes_planner
+{
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+const std::size_t CACHE_LINE = 64;
+
+// Set while a thread runs a task, so that loops started from it run serially rather than waiting on the pool
+thread_local bool in_task = false;
+
+// The slot of the thread running a task, kept by the loops it starts since they run serially on the same thread
+thread_local unsigned current_slot = 0;
+
+double secondsSince(const Clock::time_point& start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+}
+
+// The indices [begin, end) left to one thread, padded to fill whole cache lines. new[] ignores extended alignment
+// before C++17, so rather than alignas the shares are put on cache lines by makeShares().
+struct TaskPool::Share
+{
+  std::mutex mutex;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  char padding[CACHE_LINE - (sizeof(std::mutex) + 2 * sizeof(std::size_t)) % CACHE_LINE];
+
+  bool pop(std::size_t& index)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (begin == end) return false;
+    index = begin++;
+    return true;
+  }
+
+  std::size_t remaining()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return end - begin;
+  }
+};
+
+TaskPool::SharePtr TaskPool::makeShares(unsigned n)
+{
+  static_assert(sizeof(Share) % CACHE_LINE == 0, "a share must fill whole cache lines");
+  void* memory = nullptr;
+  if (posix_memalign(&memory, CACHE_LINE, n * sizeof(Share)) != 0) throw std::bad_alloc();
+  Share* shares = static_cast<Share*>(memory);
+  for (unsigned t = 0; t < n; ++t)
+    new (shares + t) Share();
+  return SharePtr(shares, ShareDeleter{ n });
+}
+
+void TaskPool::ShareDeleter::operator()(Share* shares) const
+{
+  for (unsigned t = 0; t < n; ++t)
+    shares[t].~Share();
+  std::free(shares);
+}
+
+TaskPool::TaskPool(unsigned n_threads, std::vector<int> cpus)
+  : n_threads_(n_threads > 0 ? n_threads : std::max(1u, std::thread::hardware_concurrency()))
+  , cpus_(std::move(cpus))
+  , shares_(makeShares(n_threads_))
+  , loop_id_(0)
+  , active_workers_(0)
+  , stop_(false)
+  , fn_(nullptr)
+  , cancel_(nullptr)
+  , failed_(false)
+  , n_steals_(0)
+{}
+
+TaskPool::~TaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+void TaskPool::startWorkers()
+{
+  for (unsigned slot = 1; slot < n_threads_; ++slot)
+  {
+    workers_.emplace_back(&TaskPool::workerLoop, this, slot);
+#ifdef __linux__
+    if (!cpus_.empty())
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus_[(slot - 1) % cpus_.size()], &set);
+      if (pthread_setaffinity_np(workers_.back().native_handle(), sizeof(set), &set) != 0)
+      {
+        ROS_WARN("Unable to pin a planner thread to CPU %d", cpus_[(slot - 1) % cpus_.size()]);
+      }
+    }
+#endif
+  }
+}
+
+void TaskPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn)
+{
+  run(n, fn, nullptr);
+}
+
+void TaskPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn, const CancellationToken& cancel)
+{
+  run(n, fn, &cancel);
+}
+
+void TaskPool::run(std::size_t n, const std::function<void(std::size_t)>& fn, const CancellationToken* cancel)
+{
+  if (in_task)
+  {
+    for (std::size_t i = 0; i < n && !(cancel && cancel->cancelled()); ++i)
+      fn(i);
+    return;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  const bool parallel = n_threads_ > 1 && n > 1;
+  if (parallel && workers_.empty()) startWorkers();
+
+  const auto start = Clock::now();
+  stats_.n_tasks = n;
+  stats_.task_seconds.assign(n, 0.0);
+  stats_.thread_busy_seconds.assign(n_threads_, 0.0);
+  const unsigned n_shares = parallel ? n_threads_ : 1;
+  for (unsigned t = 0; t < n_threads_; ++t)
+  {
+    shares_[t].begin = t < n_shares ? n * t / n_shares : n;
+    shares_[t].end = t < n_shares ? n * (t + 1) / n_shares : n;
+  }
+  fn_ = &fn;
+  cancel_ = cancel;
+  error_ = nullptr;
+  failed_ = false;
+  n_steals_ = 0;
+
+  if (parallel)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active_workers_ = n_threads_ - 1;
+      ++loop_id_;
+    }
+    wake_.notify_all();
+  }
+
+  runShare(0);
+
+  if (parallel)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_workers_ == 0; });
+  }
+  fn_ = nullptr;
+  cancel_ = nullptr;
+  stats_.n_steals = n_steals_;
+  stats_.seconds = secondsSince(start);
+
+  if (error_) std::rethrow_exception(error_);
+}
+
+void TaskPool::workerLoop(unsigned slot)
+{
+  std::uint64_t seen_loop = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || loop_id_ != seen_loop; });
+      if (stop_) return;
+      seen_loop = loop_id_;
+    }
+
+    runShare(slot);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_workers_ == 0) done_.notify_all();
+  }
+}
+
+unsigned TaskPool::currentSlot() noexcept
+{
+  return current_slot;
+}
+
+void TaskPool::runShare(unsigned slot)
+{
+  in_task = true;
+  current_slot = slot;
+  double busy = 0.0;
+  std::size_t index;
+  while (shares_[slot].pop(index) || steal(slot, index))
+  {
+    if (failed_ || (cancel_ && cancel_->cancelled())) continue;
+
+    const auto start = Clock::now();
+    try
+    {
+      (*fn_)(index);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) error_ = std::current_exception();
+      failed_ = true;
+    }
+    const double seconds = secondsSince(start);
+    stats_.task_seconds[index] = seconds;
+    busy += seconds;
+  }
+  stats_.thread_busy_seconds[slot] = busy;
+  in_task = false;
+  current_slot = 0;
+}
+
+bool TaskPool::steal(unsigned slot, std::size_t& index)
+{
+  for (;;)
+  {
+    unsigned victim = slot;
+    std::size_t most = 0;
+    for (unsigned t = 0; t < n_threads_; ++t)
+    {
+      const auto remaining = t == slot ? 0 : shares_[t].remaining();
+      if (remaining > most)
+      {
+        most = remaining;
+        victim = t;
+      }
+    }
+    if (most == 0) return false;
+
+    // Take the upper half, running its first index now and leaving the rest in our own share
+    std::size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(shares_[victim].mutex);
+      const auto remaining = shares_[victim].end - shares_[victim].begin;
+      if (remaining == 0) continue; // emptied in the meantime, look again
+      end = shares_[victim].end;
+      begin = end - (remaining + 1) / 2;
+      shares_[victim].end = begin;
+    }
+    {
+      std::lock_guard<std::mutex> lock(shares_[slot].mutex);
+      shares_[slot].begin = begin + 1;
+      shares_[slot].end = end;
+    }
+    ++n_steals_;
+    index = begin;
+    return true;
+  }
+}
+
+bool parseCpuList(const std::string& list, std::vector<int>& cpus)
+{
+  cpus.clear();
+  std::istringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    std::size_t first_end = 0, last_end = 0;
+    try
+    {
+      const int first = std::stoi(item, &first_end);
+      int last = first;
+      if (first_end < item.size())
+      {
+        if (item[first_end] != '-') return false;
+        const auto rest = item.substr(first_end + 1);
+        last = std::stoi(rest, &last_end);
+        if (last_end != rest.size()) return false;
+      }
+      if (first < 0 || last < first) return false;
+      for (int cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+    }
+    catch (const std::logic_error&)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace descartes_planner
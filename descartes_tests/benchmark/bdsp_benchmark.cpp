@@ -0,0 +1,284 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * bdsp_benchmark.cpp
+ *
+ * Times BDSPGraphPlanner::build() and solve() with each backend on the raster trajectories test_graph_solver plans:
+ * lines across a curved patch, every other one reversed, each waypoint sampled at evenly spaced rotations about the
+ * tool's z axis. The IK of a 6 joint arm is replaced by a closed form stand-in so that the graph dominates the time,
+ * and the edges are weighted and validated like test_graph_solver's SpeedEvaluator. Also compares the memory the
+ * edges of a segment take as EdgeProperties and as CompactEdge.
+ *
+ * usage: bdsp_benchmark [threads, 0 for one per hardware thread]
+ */
+
+#include <descartes_planner/bdsp_graph_planner.h>
+#include <descartes_planner/task_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using FloatT = float;
+
+const std::size_t DOF = 6;
+
+double secondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * @brief The trajectory shape of test_graph_solver: 'lines' rows of 'points_per_line' waypoints over a patch of the
+ *        given width and curvature, each waypoint sampled 'samples' times about the tool axis
+ */
+struct RasterShape
+{
+  const char* name;
+  std::size_t lines;
+  std::size_t points_per_line;
+  std::size_t samples;
+};
+
+/**
+ * @brief Joint values of a waypoint of the raster for each rotation about the tool axis. The shoulder joints follow the
+ *        position and the wrist follows the rotation, much like the solutions TRAC-IK finds for ZAxixSampler.
+ */
+class RasterSampler : public descartes_planner::PointSampler<FloatT>
+{
+public:
+  RasterSampler(FloatT x, FloatT y, FloatT tilt, std::size_t samples) : x_(x), y_(y), tilt_(tilt), samples_(samples)
+  {
+  }
+
+  descartes_planner::PointSampleGroup<FloatT>::Ptr generate() override
+  {
+    auto group = std::make_shared<descartes_planner::PointSampleGroup<FloatT>>();
+    group->num_dofs = DOF;
+    group->num_samples = samples_;
+    group->values.reserve(samples_ * DOF);
+    for (std::size_t s = 0; s < samples_; ++s)
+    {
+      const FloatT z_rot = FloatT(2 * M_PI) * s / samples_;
+      group->values.push_back(std::atan2(y_, 2.0f + x_));
+      group->values.push_back(0.4f + 0.5f * x_);
+      group->values.push_back(-0.8f + 0.3f * x_ + 0.2f * y_);
+      group->values.push_back(0.3f * std::sin(z_rot) + tilt_);
+      group->values.push_back(1.2f - tilt_);
+      group->values.push_back(z_rot - FloatT(M_PI));
+    }
+    return group;
+  }
+
+private:
+  FloatT x_, y_, tilt_;
+  std::size_t samples_;
+};
+
+/**
+ * @brief Like SpeedEvaluator: the sum of the joint displacements, with the pairs that exceed a joint speed over the
+ *        time the tool takes between the waypoints left out
+ */
+class SpeedLimitEvaluator : public descartes_planner::EdgeEvaluator<FloatT>
+{
+public:
+  explicit SpeedLimitEvaluator(FloatT max_step) : max_step_(max_step) {}
+
+  bool evaluateCompact(descartes_planner::PointSampleGroup<FloatT>::ConstPtr s1,
+                       descartes_planner::PointSampleGroup<FloatT>::ConstPtr s2, const std::vector<std::size_t>&,
+                       std::vector<descartes_planner::CompactEdge<FloatT>>& edges) const override
+  {
+    edges.clear();
+    for (std::uint32_t i1 = 0; i1 < s1->num_samples; ++i1)
+    {
+      for (std::uint32_t i2 = 0; i2 < s2->num_samples; ++i2)
+      {
+        FloatT sum;
+        if (withinLimit(&s1->values[i1 * DOF], &s2->values[i2 * DOF], sum))
+          edges.push_back({ i1, i2, sum });
+      }
+    }
+    return true;
+  }
+
+  bool withinLimit(const FloatT* a, const FloatT* b, FloatT& sum) const
+  {
+    FloatT max = 0;
+    sum = 0;
+    for (std::size_t j = 0; j < DOF; ++j)
+    {
+      const FloatT d = std::abs(a[j] - b[j]);
+      sum += d;
+      max = std::max(max, d);
+    }
+    return max <= max_step_;
+  }
+
+private:
+  FloatT max_step_;
+};
+
+/**
+ * @brief SpeedLimitEvaluator returning all n1 x n2 edges as EdgeProperties, the invalid ones included
+ */
+class FullSpeedLimitEvaluator : public SpeedLimitEvaluator
+{
+public:
+  using SpeedLimitEvaluator::SpeedLimitEvaluator;
+
+  std::vector<descartes_planner::EdgeProperties<FloatT>>
+  evaluate(descartes_planner::PointSampleGroup<FloatT>::ConstPtr s1,
+           descartes_planner::PointSampleGroup<FloatT>::ConstPtr s2, const std::vector<std::size_t>& = {},
+           const std::vector<std::size_t>& = {}) const override
+  {
+    std::vector<descartes_planner::EdgeProperties<FloatT>> edges;
+    descartes_planner::EdgeProperties<FloatT> edge;
+    for (std::size_t i1 = 0; i1 < s1->num_samples; ++i1)
+    {
+      for (std::size_t i2 = 0; i2 < s2->num_samples; ++i2)
+      {
+        FloatT sum;
+        edge.src_vtx.point_id = s1->point_id;
+        edge.src_vtx.sample_index = i1;
+        edge.dst_vtx.point_id = s2->point_id;
+        edge.dst_vtx.sample_index = i2;
+        edge.valid = withinLimit(&s1->values[i1 * DOF], &s2->values[i2 * DOF], sum);
+        edge.weight = edge.valid ? sum : 1e5;
+        edges.push_back(edge);
+      }
+    }
+    return edges;
+  }
+
+  bool evaluateCompact(descartes_planner::PointSampleGroup<FloatT>::ConstPtr s1,
+                       descartes_planner::PointSampleGroup<FloatT>::ConstPtr s2,
+                       const std::vector<std::size_t>& exclude_s1,
+                       std::vector<descartes_planner::CompactEdge<FloatT>>& edges) const override
+  {
+    return descartes_planner::EdgeEvaluator<FloatT>::evaluateCompact(s1, s2, exclude_s1, edges);
+  }
+};
+
+std::vector<descartes_planner::PointSampler<FloatT>::Ptr> makeRaster(const RasterShape& shape)
+{
+  // test_graph_solver's launch file: a 1.0 x 0.8 m patch with curvature 1.0
+  const FloatT width = 1.0, length = 0.8, curvature = 1.0;
+  std::vector<descartes_planner::PointSampler<FloatT>::Ptr> samplers;
+  for (std::size_t l = 0; l < shape.lines; ++l)
+  {
+    const FloatT x = -width / 2 + width * l / std::max<std::size_t>(shape.lines - 1, 1);
+    for (std::size_t i = 0; i < shape.points_per_line; ++i)
+    {
+      const std::size_t k = l % 2 == 0 ? i : shape.points_per_line - 1 - i;
+      const FloatT y = -length / 2 + length * k / std::max<std::size_t>(shape.points_per_line - 1, 1);
+      samplers.push_back(std::make_shared<RasterSampler>(x, y, curvature * y * 0.5f, shape.samples));
+    }
+  }
+  return samplers;
+}
+
+// allow the wrist to move a couple of samples between waypoints, enough for the line changes
+FloatT maxStep(const RasterShape& shape)
+{
+  return FloatT(2.5 * 2 * M_PI / shape.samples) + 0.3f;
+}
+
+void run(const RasterShape& shape, descartes_planner::BDSPBackend backend, const char* backend_name,
+         std::shared_ptr<descartes_planner::TaskPool> pool = nullptr, bool full_edges = false)
+{
+  auto samplers = makeRaster(shape);
+  descartes_planner::EdgeEvaluator<FloatT>::ConstPtr evaluator;
+  if (full_edges)
+    evaluator = std::make_shared<FullSpeedLimitEvaluator>(maxStep(shape));
+  else
+    evaluator = std::make_shared<SpeedLimitEvaluator>(maxStep(shape));
+
+  // the best of a few runs, the first of them paying for growing the heap
+  double build_time = 1e9, solve_time = 1e9;
+  bool solved = false;
+  std::vector<descartes_planner::PointData<FloatT>::ConstPtr> solution;
+  for (int repeat = 0; repeat < 3; ++repeat)
+  {
+    descartes_planner::BDSPGraphPlanner<FloatT> planner(nullptr, false, backend);
+    planner.setTaskPool(pool);
+    auto start = Clock::now();
+    const bool built = planner.build(samplers, evaluator);
+    build_time = std::min(build_time, secondsSince(start));
+
+    start = Clock::now();
+    solved = built && planner.solve(solution);
+    solve_time = std::min(solve_time, secondsSince(start));
+  }
+
+  double cost = 0;
+  for (std::size_t p = 1; solved && p < solution.size(); ++p)
+  {
+    for (std::size_t j = 0; j < DOF; ++j)
+      cost += std::abs(solution[p]->values[j] - solution[p - 1]->values[j]);
+  }
+
+  std::printf("  %-28s %s, cost: %.4f, build: %.4f s, solve: %.4f s\n", backend_name,
+              solved ? "solved" : "failed", cost, build_time, solve_time);
+}
+// The bytes of the edges between the first two waypoints, as the evaluators return them
+void segmentMemory(const RasterShape& shape)
+{
+  auto samplers = makeRaster(shape);
+  auto s1 = samplers[0]->generate(), s2 = samplers[1]->generate();
+  FullSpeedLimitEvaluator evaluator(maxStep(shape));
+
+  const auto full = evaluator.evaluate(s1, s2);
+  std::vector<descartes_planner::CompactEdge<FloatT>> compact;
+  evaluator.SpeedLimitEvaluator::evaluateCompact(s1, s2, {}, compact);
+  const double full_bytes = full.capacity() * sizeof(full[0]);
+  const double compact_bytes = compact.capacity() * sizeof(compact[0]);
+  std::printf("  %zu x %zu segment edges: %zu x %zu B as EdgeProperties, %zu valid x %zu B as CompactEdge, %.1fx less\n",
+              shape.samples, shape.samples, full.size(), sizeof(full[0]), compact.size(), sizeof(compact[0]),
+              full_bytes / compact_bytes);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  auto pool = std::make_shared<descartes_planner::TaskPool>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 0);
+  char pool_name[64];
+  std::snprintf(pool_name, sizeof(pool_name), "layered DAG, %u threads", pool->threads());
+
+  console_bridge::setLogLevel(console_bridge::CONSOLE_BRIDGE_LOG_WARN);
+
+  const RasterShape shapes[] = { { "launch file raster", 40, 40, 10 },
+                                 { "dense sampling", 10, 10, 100 },
+                                 { "very dense sampling", 4, 5, 300 } };
+  for (const auto& shape : shapes)
+  {
+    std::printf("%s: %zu lines of %zu points, %zu samples each\n", shape.name, shape.lines, shape.points_per_line,
+                shape.samples);
+    segmentMemory(shape);
+    run(shape, descartes_planner::BDSPBackend::BOOST_DIJKSTRA, "boost dijkstra, full edges", nullptr, true);
+    run(shape, descartes_planner::BDSPBackend::BOOST_DIJKSTRA, "boost dijkstra");
+    run(shape, descartes_planner::BDSPBackend::LAYERED_DAG, "layered DAG");
+    run(shape, descartes_planner::BDSPBackend::LAYERED_DAG, pool_name, pool);
+  }
+  return 0;
+}
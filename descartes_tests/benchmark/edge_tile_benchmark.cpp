@@ -0,0 +1,196 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * edge_tile_benchmark.cpp
+ *
+ * Builds the timed edges between pairs of large rungs one source row at a time, as DefaultEdgesWithTime::considerAll()
+ * does, and a tile of sources at a time, as buildEdges() does, reading the cache miss counters of the CPU around
+ * each with perf_event_open(). Counters the kernel doesn't let us open are reported as unavailable; lowering
+ * /proc/sys/kernel/perf_event_paranoid to 1 or less usually allows them.
+ *
+ * usage: edge_tile_benchmark [n_vertices] [dof] [rung pairs]
+ */
+
+#include <descartes_planner/planning_graph.h>
+#include <descartes_planner/planning_graph_edge_policy.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief A hardware counter of this thread, or an unavailable one if it can't be opened
+ */
+class PerfCounter
+{
+public:
+  PerfCounter(const char* name, std::uint32_t type, std::uint64_t config) : name_(name), fd_(-1)
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  ~PerfCounter()
+  {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  PerfCounter(const PerfCounter&) = delete;
+  PerfCounter& operator=(const PerfCounter&) = delete;
+
+  void start()
+  {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  void stop()
+  {
+    if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  void print() const
+  {
+    std::uint64_t value = 0;
+    if (fd_ < 0 || read(fd_, &value, sizeof(value)) != sizeof(value))
+      std::printf(", %s: unavailable", name_);
+    else
+      std::printf(", %s: %llu", name_, static_cast<unsigned long long>(value));
+  }
+
+private:
+  const char* name_;
+  int fd_;
+};
+
+std::uint64_t cacheEvent(std::uint64_t cache, std::uint64_t op, std::uint64_t result)
+{
+  return cache | (op << 8) | (result << 16);
+}
+
+/**
+ * @brief Times 'build' over every rung pair, counting the L1 data cache and last level cache read misses
+ */
+template <typename Build>
+void measure(const char* name, const std::vector<std::vector<double>>& rungs, Build build)
+{
+  PerfCounter l1d("L1D read misses", PERF_TYPE_HW_CACHE,
+                  cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+  PerfCounter llc("LLC read misses", PERF_TYPE_HW_CACHE,
+                  cacheEvent(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+
+  std::size_t n_edges = 0;
+  const auto start = Clock::now();
+  l1d.start();
+  llc.start();
+  for (std::size_t r = 0; r + 1 < rungs.size(); ++r)
+    n_edges += build(rungs[r], rungs[r + 1]);
+  l1d.stop();
+  llc.stop();
+  const double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::printf("  %-6s edges: %zu, build: %.4f s", name, n_edges, time);
+  l1d.print();
+  llc.print();
+  std::printf("\n");
+}
+
+struct RowBuild
+{
+  std::size_t dof;
+  std::vector<double> vel_limits;
+
+  std::size_t operator()(const std::vector<double>& from, const std::vector<double>& to) const
+  {
+    const auto n_from = from.size() / dof, n_to = to.size() / dof;
+    descartes_planner::DefaultEdgesWithTime builder(n_from, n_to, dof, 0.1, vel_limits);
+    builder.setTargets(to.data(), n_to);
+    for (std::size_t i = 0; i < n_from; ++i)
+    {
+      builder.considerAll(&from[i * dof]);
+      builder.next(i);
+    }
+    return builder.result().numEdges();
+  }
+};
+
+struct TileBuild
+{
+  std::size_t dof;
+  std::vector<double> vel_limits;
+
+  std::size_t operator()(const std::vector<double>& from, const std::vector<double>& to) const
+  {
+    descartes_planner::DefaultEdgesWithTime builder(from.size() / dof, to.size() / dof, dof, 0.1, vel_limits);
+    descartes_planner::buildEdges(builder, from, to, dof);
+    return builder.result().numEdges();
+  }
+};
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const std::size_t n_vertices = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  const std::size_t dof = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 7;
+  const std::size_t n_pairs = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20;
+  if (n_vertices == 0 || dof == 0 || n_pairs == 0)
+  {
+    std::fprintf(stderr, "usage: %s [n_vertices > 0] [dof > 0] [rung pairs > 0]\n", argv[0]);
+    return 1;
+  }
+
+  // Vertices scattered closely enough around a common pose that the rungs aren't worth indexing, with a few
+  // percent of the pairs within the velocity limits
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<double> joint_dist(-0.12, 0.12);
+  std::vector<std::vector<double>> rungs(n_pairs + 1, std::vector<double>(n_vertices * dof));
+  for (auto& rung : rungs)
+  {
+    for (auto& j : rung)
+      j = joint_dist(rng);
+  }
+
+  std::printf("timed edges: %zu rung pairs of %zu vertices, %zu dof, %.1f KB per rung (best kernel: %s)\n", n_pairs,
+              n_vertices, dof, n_vertices * dof * sizeof(double) / 1024.0,
+              descartes_planner::toString(descartes_planner::bestRelaxationKernel()));
+
+  const std::vector<double> vel_limits(dof, 1.0);
+  measure("rows", rungs, RowBuild{dof, vel_limits});
+  measure("tiles", rungs, TileBuild{dof, vel_limits});
+  return 0;
+}
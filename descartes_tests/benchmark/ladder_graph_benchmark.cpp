@@ -0,0 +1,933 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * ladder_graph_benchmark.cpp
+ *
+ * Builds the edges of a synthetic ladder graph and searches it, reporting build time, search time and peak
+ * resident memory. Each configuration runs in its own child process so that the peak RSS reported for it is
+ * not polluted by the others. On the stored graph, alternative paths are enumerated and beam searches are compared
+ * with the exact search. The implicit edge mode, which evaluates edges while searching, is measured the same way, as
+ * is the streaming solver (6 dof only), which holds two rungs at a time, and the IK & edge build of
+ * PlanningGraph::insertGraph() (6 dof only). Random rung insertions are timed against a plain vector of rungs. Finally the timed edge filter and the dense relaxation kernels are timed against each other,
+ * one search worth of rungs each, and the spatial index of timed edges against testing every pair. Custom costs are
+ * timed per edge against one call per row, and the builders specialized for 6 and 7 joints against the generic ones.
+ *
+ * usage: ladder_graph_benchmark [n_rungs] [n_vertices] [dof] [timed (0|1)] [search threads]
+ */
+
+#include <descartes_planner/planning_graph.h>
+#include <descartes_planner/planning_graph_edge_policy.h>
+#include <descartes_planner/ladder_graph_beam_search.h>
+#include <descartes_planner/ladder_graph_dag_search.h>
+#include <descartes_planner/ladder_graph_edge_filter.h>
+#include <descartes_planner/ladder_graph_k_shortest_paths.h>
+#include <descartes_planner/ladder_graph_relaxation.h>
+#include <descartes_planner/streaming_ladder_solver.h>
+#include <descartes_trajectory/joint_trajectory_pt.h>
+#include <descartes_tests/cartesian_robot.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkConfig
+{
+  std::size_t n_rungs = 2000;
+  std::size_t n_vertices = 100;
+  std::size_t dof = 6;
+  bool timed = true;
+  unsigned search_threads = 4;
+};
+
+double secondsSince(const Clock::time_point& start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Generates the joint data of the rungs. The vertices of a rung are scattered around a nominal joint pose
+ *        that drifts slowly along the path, similar to the redundant samples of a tool-axis symmetric point. With
+ *        timing enabled roughly a fifth of the vertex pairs satisfy the velocity limits. Any rung can be generated
+ *        on its own, as many times as needed, which the streaming solver relies on.
+ */
+class RungGenerator
+{
+public:
+  explicit RungGenerator(const BenchmarkConfig& cfg) : cfg_(cfg), nominal_(cfg.n_rungs * cfg.dof)
+  {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> start_dist(-M_PI, M_PI);
+    std::normal_distribution<double> step_dist(0.0, 0.005);
+
+    for (std::size_t i = 0; i < cfg.dof; ++i)
+      nominal_[i] = start_dist(rng);
+    for (std::size_t i = cfg.dof; i < nominal_.size(); ++i)
+      nominal_[i] = nominal_[i - cfg.dof] + step_dist(rng);
+  }
+
+  void operator()(std::size_t r, std::vector<double>& joints) const
+  {
+    std::mt19937 rng(r);
+    std::uniform_real_distribution<double> spread_dist(-0.1, 0.1);
+
+    joints.resize(cfg_.n_vertices * cfg_.dof);
+    for (std::size_t i = 0; i < joints.size(); ++i)
+      joints[i] = nominal_[r * cfg_.dof + i % cfg_.dof] + spread_dist(rng);
+  }
+
+private:
+  const BenchmarkConfig& cfg_;
+  std::vector<double> nominal_;
+};
+
+std::vector<std::vector<double>> makeRungData(const BenchmarkConfig& cfg)
+{
+  RungGenerator generate(cfg);
+  std::vector<std::vector<double>> rungs(cfg.n_rungs);
+  for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+    generate(r, rungs[r]);
+  return rungs;
+}
+
+template <typename Visitor>
+void forEachPair(const std::vector<double>& from, const std::vector<double>& to, std::size_t dof, Visitor&& visit)
+{
+  const auto n_from = from.size() / dof;
+  const auto n_to = to.size() / dof;
+  for (std::size_t i = 0; i < n_from; ++i)
+  {
+    for (std::size_t j = 0; j < n_to; ++j)
+      visit.consider(&from[i * dof], &to[j * dof], j);
+    visit.next(i);
+  }
+}
+
+/**
+ * @brief Runs the build & search using the CSR based descartes_planner::LadderGraph
+ */
+void runCSR(const BenchmarkConfig& cfg, std::vector<std::vector<double>> data)
+{
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+  const double dt = 0.1;
+
+  descartes_planner::LadderGraph graph(cfg.dof);
+  graph.resize(cfg.n_rungs);
+
+  auto start = Clock::now();
+  for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+  {
+    graph.getRung(r).data = std::move(data[r]);
+    graph.getEdges(r).resize(cfg.n_vertices);
+  }
+
+  std::size_t n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    if (cfg.timed)
+    {
+      descartes_planner::DefaultEdgesWithTime builder(cfg.n_vertices, cfg.n_vertices, cfg.dof, dt, vel_limits);
+      descartes_planner::buildEdges(builder, graph.getRung(r).data, graph.getRung(r + 1).data, cfg.dof);
+      graph.assignEdges(r, std::move(builder.result()));
+    }
+    else
+    {
+      descartes_planner::DefaultEdgesWithoutTime builder(cfg.n_vertices, cfg.n_vertices, cfg.dof);
+      forEachPair(graph.getRung(r).data, graph.getRung(r + 1).data, cfg.dof, builder);
+      graph.assignEdges(r, std::move(builder.result()));
+    }
+    n_edges += graph.getEdges(r).numEdges();
+  }
+  const double build_time = secondsSince(start);
+
+  start = Clock::now();
+  descartes_planner::DAGSearch search(graph);
+  const double cost = search.run();
+  const double search_time = secondsSince(start);
+
+  std::printf("  edges: %zu, cost: %g, build: %.4f s, search: %.4f s\n", n_edges, cost, build_time, search_time);
+
+  start = Clock::now();
+  descartes_planner::DAGSearch parallel_search(graph);
+  const double parallel_cost = parallel_search.runParallel(cfg.search_threads);
+  const double parallel_time = secondsSince(start);
+
+  std::printf("  parallel search (%u threads): cost: %g, search: %.4f s\n", cfg.search_threads, parallel_cost,
+              parallel_time);
+
+  start = Clock::now();
+  descartes_planner::KShortestPaths k_shortest(graph);
+  const auto alternatives = k_shortest.run(10);
+  const double k_time = secondsSince(start);
+
+  start = Clock::now();
+  const auto diverse = k_shortest.run(10, cfg.n_rungs / 100, 1000);
+  const double diverse_time = secondsSince(start);
+
+  std::printf("  10 shortest paths: %zu found, search: %.4f s; diverse (%zu rungs apart): %zu found, %zu candidates, "
+              "search: %.4f s\n", alternatives.size(), k_time, cfg.n_rungs / 100, diverse.size(),
+              k_shortest.candidates(), diverse_time);
+
+  const std::size_t beam_widths[] = {cfg.n_vertices / 4, cfg.n_vertices / 16};
+  for (auto width : beam_widths)
+  {
+    if (width == 0) continue;
+    descartes_planner::BeamParameters beam;
+    beam.width = width;
+
+    start = Clock::now();
+    descartes_planner::BeamDAGSearch beam_search(graph, beam);
+    const double beam_cost = beam_search.run();
+    const double beam_time = secondsSince(start);
+
+    std::printf("  beam search (width %zu): cost: %g (%+.3f%%), search: %.4f s\n", width, beam_cost,
+                100.0 * (beam_cost - cost) / cost, beam_time);
+  }
+}
+
+/**
+ * @brief Skips the rows of the sources that are unreachable
+ */
+struct IsUnreachable
+{
+  const std::vector<double>& distance;
+
+  bool operator()(std::size_t i) const { return distance[i] == std::numeric_limits<double>::max(); }
+};
+
+/**
+ * @brief Fuses the edge build into the search as PlanningGraph does with implicit edges: no edge is ever stored
+ */
+template <typename Builder>
+void relaxImplicit(Builder& builder, const std::vector<double>& from, const std::vector<double>& to, std::size_t dof,
+                   const std::vector<double>& distance)
+{
+  descartes_planner::buildEdges(builder, from, to, dof, IsUnreachable{distance});
+}
+
+void runImplicit(const BenchmarkConfig& cfg, std::vector<std::vector<double>> data)
+{
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+  const double dt = 0.1;
+
+  descartes_planner::LadderGraph graph(cfg.dof);
+  graph.resize(cfg.n_rungs);
+  for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+  {
+    graph.getRung(r).data = std::move(data[r]);
+    graph.getEdges(r).resize(cfg.n_vertices);
+  }
+
+  auto start = Clock::now();
+  std::vector<std::vector<unsigned>> predecessors(cfg.n_rungs, std::vector<unsigned>(cfg.n_vertices));
+  std::vector<double> distance(cfg.n_vertices, 0.0), next(cfg.n_vertices);
+  std::size_t n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    std::fill(next.begin(), next.end(), std::numeric_limits<double>::max());
+    const auto& from = graph.getRung(r).data;
+    const auto& to = graph.getRung(r + 1).data;
+    if (cfg.timed)
+    {
+      descartes_planner::BasicDefaultEdgesWithTime<descartes_planner::RelaxingSink> builder(
+          cfg.n_vertices, cfg.n_vertices, cfg.dof, dt, vel_limits);
+      builder.result().attach(distance.data(), next.data(), predecessors[r + 1].data());
+      relaxImplicit(builder, from, to, cfg.dof, distance);
+      n_edges += builder.result().numEdges();
+    }
+    else
+    {
+      descartes_planner::BasicDefaultEdgesWithoutTime<descartes_planner::RelaxingSink> builder(
+          cfg.n_vertices, cfg.n_vertices, cfg.dof);
+      builder.result().attach(distance.data(), next.data(), predecessors[r + 1].data());
+      relaxImplicit(builder, from, to, cfg.dof, distance);
+      n_edges += builder.result().numEdges();
+    }
+    distance.swap(next);
+  }
+  const double cost = *std::min_element(distance.begin(), distance.end());
+  const double time = secondsSince(start);
+
+  std::printf("  edges: %zu, cost: %g, build + search: %.4f s\n", n_edges, cost, time);
+}
+
+/**
+ * @brief Solves with StreamingLadderSolver, which generates each rung twice and never holds more than two of them
+ */
+void runStreaming(const BenchmarkConfig& cfg)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(cfg.dof, 1.0)));
+  const descartes_core::TimingConstraint timing(cfg.timed ? 0.1 : 0.0);
+  RungGenerator generate(cfg);
+
+  auto start = Clock::now();
+  descartes_planner::StreamingLadderSolver solver(robot);
+  double cost = 0.0;
+  std::list<descartes_trajectory::JointTrajectoryPt> path;
+  const bool ok = solver.solve(cfg.n_rungs, [&](std::size_t r, std::vector<double>& joints,
+                                                descartes_core::TimingConstraint& tm) {
+    generate(r, joints);
+    tm = timing;
+    return true;
+  }, cost, path);
+  const double time = secondsSince(start);
+
+  std::printf("  %s, cost: %g, build + search + recovery: %.4f s, predecessors: %.1f MB\n", ok ? "solved" : "failed",
+              cost, time, solver.predecessorMemory() / (1024.0 * 1024.0));
+}
+
+/**
+ * @brief A trajectory point whose "IK" returns the vertices of one generated rung, or nothing if it 'fails'
+ */
+class GeneratedPt : public descartes_trajectory::JointTrajectoryPt
+{
+public:
+  GeneratedPt(const RungGenerator& generate, std::size_t rung, std::size_t dof, double timing, bool fails = false)
+    : JointTrajectoryPt(std::vector<double>(dof, 0.0), descartes_core::TimingConstraint(timing))
+    , generate_(generate), rung_(rung), dof_(dof), fails_(fails)
+  {}
+
+  void getJointPoses(const descartes_core::RobotModel&, std::vector<std::vector<double>>& joint_poses) const override
+  {
+    joint_poses.clear();
+    if (fails_) return;
+
+    std::vector<double> joints;
+    generate_(rung_, joints);
+    for (std::size_t i = 0; i < joints.size(); i += dof_)
+      joint_poses.emplace_back(joints.begin() + i, joints.begin() + i + dof_);
+  }
+
+private:
+  const RungGenerator& generate_;
+  std::size_t rung_;
+  std::size_t dof_;
+  bool fails_;
+};
+
+/**
+ * @brief Times PlanningGraph::insertGraph() on generated points, which computes their IK and the edges between them
+ */
+void runInsertGraph(const BenchmarkConfig& cfg)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(cfg.dof, 1.0)));
+  RungGenerator generate(cfg);
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+    points.emplace_back(new GeneratedPt(generate, r, cfg.dof, cfg.timed ? 0.1 : 0.0));
+
+  auto start = Clock::now();
+  descartes_planner::PlanningGraph graph(robot);
+  const bool ok = graph.insertGraph(points);
+  const double insert_time = secondsSince(start);
+
+  start = Clock::now();
+  double cost = 0.0;
+  std::list<descartes_trajectory::JointTrajectoryPt> path;
+  graph.getShortestPath(cost, path);
+  std::printf("  %s, cost: %g, insertGraph: %.4f s, search: %.4f s\n", ok ? "inserted" : "failed", cost, insert_time,
+              secondsSince(start));
+
+  // The same with a point a tenth of the way in failing IK, which cancels the rest of the build
+  const std::size_t failing = cfg.n_rungs / 10;
+  points[failing].reset(new GeneratedPt(generate, failing, cfg.dof, cfg.timed ? 0.1 : 0.0, true));
+  start = Clock::now();
+  const bool failed_ok = graph.insertGraph(points);
+  const auto& failure = graph.getBuildFailure();
+  std::printf("  IK failing at point %zu: %s, reported: %s at point %zu, insertGraph: %.4f s\n", failing,
+              failed_ok ? "inserted" : "failed", descartes_planner::toString(failure.reason), failure.rung,
+              secondsSince(start));
+
+  // And with a deadline a quarter of the way through the full build, to see how far past it the build runs
+  points[failing].reset(new GeneratedPt(generate, failing, cfg.dof, cfg.timed ? 0.1 : 0.0));
+  const auto budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(insert_time / 4));
+  start = Clock::now();
+  const descartes_planner::CancellationToken deadline(start + budget);
+  const bool deadline_ok = graph.insertGraph(points, deadline);
+  const double deadline_time = secondsSince(start);
+  std::printf("  deadline after %.4f s: %s, reported: %s, insertGraph: %.4f s (%.1f ms late)\n",
+              insert_time / 4, deadline_ok ? "inserted" : "failed",
+              descartes_planner::toString(graph.getBuildFailure().reason), deadline_time,
+              (deadline_time - insert_time / 4) * 1e3);
+}
+
+/**
+ * @brief The vector-of-vector edge layout that LadderGraph used before switching to CSR, kept here as the baseline
+ */
+struct NestedEdgeBuilder
+{
+  NestedEdgeBuilder(std::size_t n_start, std::size_t dof, double max_dtheta, bool timed)
+    : results(n_start), dof(dof), max_dtheta(max_dtheta), timed(timed)
+  {}
+
+  void consider(const double* start, const double* stop, std::size_t index)
+  {
+    double cost = 0.0;
+    for (std::size_t i = 0; i < dof; ++i)
+    {
+      const double delta = std::abs(start[i] - stop[i]);
+      if (timed && delta > max_dtheta) return;
+      cost += delta;
+    }
+    scratch.push_back({cost, static_cast<unsigned>(index)});
+  }
+
+  void next(std::size_t i)
+  {
+    results[i].assign(scratch.begin(), scratch.end());
+    scratch.clear();
+  }
+
+  std::vector<std::vector<descartes_planner::Edge>> results;
+  std::vector<descartes_planner::Edge> scratch;
+  std::size_t dof;
+  double max_dtheta;
+  bool timed;
+};
+
+void runNested(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data)
+{
+  const double max_dtheta = 1.0 * 0.1;
+  std::vector<std::vector<std::vector<descartes_planner::Edge>>> edges(cfg.n_rungs);
+
+  auto start = Clock::now();
+  std::size_t n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    NestedEdgeBuilder builder(cfg.n_vertices, cfg.dof, max_dtheta, cfg.timed);
+    forEachPair(data[r], data[r + 1], cfg.dof, builder);
+    edges[r] = std::move(builder.results);
+    for (const auto& e : edges[r])
+      n_edges += e.size();
+  }
+  const double build_time = secondsSince(start);
+
+  start = Clock::now();
+  std::vector<std::vector<double>> distance(cfg.n_rungs, std::vector<double>(cfg.n_vertices));
+  std::vector<std::vector<unsigned>> predecessor(cfg.n_rungs, std::vector<unsigned>(cfg.n_vertices));
+  std::fill(distance.front().begin(), distance.front().end(), 0.0);
+  for (std::size_t r = 1; r < cfg.n_rungs; ++r)
+    std::fill(distance[r].begin(), distance[r].end(), std::numeric_limits<double>::max());
+
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    for (std::size_t i = 0; i < cfg.n_vertices; ++i)
+    {
+      const double u_cost = distance[r][i];
+      for (const auto& edge : edges[r][i])
+      {
+        const double dv = u_cost + edge.cost;
+        if (dv < distance[r + 1][edge.idx])
+        {
+          distance[r + 1][edge.idx] = dv;
+          predecessor[r + 1][edge.idx] = static_cast<unsigned>(i);
+        }
+      }
+    }
+  }
+  const double cost = *std::min_element(distance.back().begin(), distance.back().end());
+  const double search_time = secondsSince(start);
+
+  std::printf("  edges: %zu, cost: %g, build: %.4f s, search: %.4f s\n", n_edges, cost, build_time, search_time);
+}
+
+/**
+ * @brief Times the timed edge test over every rung pair, one vertex pair at a time as DefaultEdgesWithTime::consider()
+ *        does, then with each supported filterEdges() kernel on the transposed rungs
+ */
+void runEdgeFilters(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data)
+{
+  const double dt = 0.1;
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+  const std::vector<double> max_delta(cfg.dof, dt);
+
+  auto start = Clock::now();
+  std::size_t n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    descartes_planner::BasicDefaultEdgesWithTime<descartes_planner::RelaxingSink> builder(
+        cfg.n_vertices, cfg.n_vertices, cfg.dof, dt, vel_limits);
+    std::vector<double> distance(cfg.n_vertices, 0.0), next(cfg.n_vertices);
+    std::vector<unsigned> predecessor(cfg.n_vertices);
+    builder.result().attach(distance.data(), next.data(), predecessor.data());
+    forEachPair(data[r], data[r + 1], cfg.dof, builder);
+    n_edges += builder.result().numEdges();
+  }
+  std::printf("  %-7s edges: %zu, build: %.4f s\n", "pairs", n_edges, secondsSince(start));
+
+  const descartes_planner::RelaxationKernel kernels[] = {descartes_planner::RelaxationKernel::SCALAR,
+                                                         descartes_planner::RelaxationKernel::AVX2,
+                                                         descartes_planner::RelaxationKernel::AVX512};
+  for (auto kernel : kernels)
+  {
+    if (!descartes_planner::isKernelSupported(kernel)) continue;
+
+    std::vector<double> targets;
+    std::vector<unsigned> indices(cfg.n_vertices);
+    std::vector<double> costs(cfg.n_vertices);
+
+    start = Clock::now();
+    n_edges = 0;
+    for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+    {
+      descartes_planner::transposeJoints(data[r + 1].data(), cfg.n_vertices, cfg.dof, targets);
+      for (std::size_t i = 0; i < cfg.n_vertices; ++i)
+      {
+        n_edges += descartes_planner::filterEdges(kernel, &data[r][i * cfg.dof], targets.data(), cfg.n_vertices,
+                                                  cfg.n_vertices, cfg.dof, max_delta.data(), indices.data(),
+                                                  costs.data());
+      }
+    }
+    std::printf("  %-7s edges: %zu, build: %.4f s\n", descartes_planner::toString(kernel), n_edges,
+                secondsSince(start));
+  }
+}
+
+/**
+ * @brief Times the timed edge build on rungs sampled like a tool-axis symmetric point: the vertices lie on a closed
+ *        curve spanning about a radian of every joint, which shifts a little from rung to rung. Only the pairs at
+ *        nearby angles along the curves are feasible, a few percent of them. The SortedJointIndex that buildEdges()
+ *        picks for such rungs is compared with testing every row with filterEdges().
+ */
+void runSpreadEdges(const BenchmarkConfig& cfg)
+{
+  const double dt = 0.1;
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<double> amplitude_dist(0.5, 1.5), phase_dist(0.0, 2.0 * M_PI);
+  std::vector<double> amplitude(cfg.dof), phase(cfg.dof);
+  for (std::size_t k = 0; k < cfg.dof; ++k)
+  {
+    amplitude[k] = amplitude_dist(rng);
+    phase[k] = phase_dist(rng);
+  }
+
+  RungGenerator generate(cfg);
+  std::normal_distribution<double> jitter_dist(0.0, 0.01);
+  std::vector<std::vector<double>> data(cfg.n_rungs);
+  for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+  {
+    generate(r, data[r]);
+    for (std::size_t j = 0; j < cfg.n_vertices; ++j)
+    {
+      const double angle = 2.0 * M_PI * j / cfg.n_vertices + jitter_dist(rng);
+      for (std::size_t k = 0; k < cfg.dof; ++k)
+        data[r][j * cfg.dof + k] = data[r][k] + amplitude[k] * std::sin(angle + phase[k]);
+    }
+  }
+
+  auto start = Clock::now();
+  std::size_t n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    descartes_planner::DefaultEdgesWithTime builder(cfg.n_vertices, cfg.n_vertices, cfg.dof, dt, vel_limits);
+    descartes_planner::buildEdges(builder, data[r], data[r + 1], cfg.dof);
+    n_edges += builder.result().numEdges();
+  }
+  const double indexed_time = secondsSince(start);
+
+  const std::vector<double> max_delta(cfg.dof, dt);
+  std::vector<double> targets;
+  std::vector<unsigned> indices(cfg.n_vertices);
+  std::vector<double> costs(cfg.n_vertices);
+  start = Clock::now();
+  std::size_t n_row_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    descartes_planner::DefaultEdgesWithTime builder(cfg.n_vertices, cfg.n_vertices, cfg.dof, dt, vel_limits);
+    descartes_planner::transposeJoints(data[r + 1].data(), cfg.n_vertices, cfg.dof, targets);
+    for (std::size_t i = 0; i < cfg.n_vertices; ++i)
+    {
+      const auto n = descartes_planner::filterEdges(descartes_planner::bestRelaxationKernel(), &data[r][i * cfg.dof],
+                                                    targets.data(), cfg.n_vertices, cfg.n_vertices, cfg.dof,
+                                                    max_delta.data(), indices.data(), costs.data());
+      for (std::size_t e = 0; e < n; ++e)
+        builder.result().push_back({costs[e], indices[e]});
+      builder.next(i);
+    }
+    n_row_edges += builder.result().numEdges();
+  }
+  const double row_time = secondsSince(start);
+
+  std::printf("  edges: %zu (%.2f%% of pairs), indexed: %.4f s, rows: %zu edges, %.4f s\n", n_edges,
+              100.0 * n_edges / ((cfg.n_rungs - 1) * cfg.n_vertices * cfg.n_vertices), indexed_time, n_row_edges,
+              row_time);
+}
+
+/**
+ * @brief A custom cost of the usual kind: the joint distance weighted towards the base, plus a penalty for flipping
+ *        the wrist (the 5th joint, or the last one of smaller robots) by more than half a turn
+ */
+struct WristFlipCost
+{
+  std::size_t dof;
+
+  double operator()(const double* a, const double* b) const
+  {
+    double cost = 0.0;
+    for (std::size_t k = 0; k < dof; ++k)
+      cost += (k < 3 ? 2.0 : 1.0) * std::abs(a[k] - b[k]);
+    const auto wrist = std::min<std::size_t>(4, dof - 1);
+    return std::abs(a[wrist] - b[wrist]) > M_PI ? cost + 10.0 : cost;
+  }
+};
+
+/**
+ * @brief WristFlipCost for a block of destinations, with the weights hoisted out of the loop over them
+ */
+struct WristFlipBatchCost
+{
+  std::size_t dof;
+
+  void operator()(const double* start, const double* end_joints, std::size_t n_end, double* costs) const
+  {
+    const auto wrist = std::min<std::size_t>(4, dof - 1);
+    double weights[32];
+    for (std::size_t k = 0; k < dof && k < 32; ++k)
+      weights[k] = k < 3 ? 2.0 : 1.0;
+
+    for (std::size_t j = 0; j < n_end; ++j)
+    {
+      const double* end = end_joints + j * dof;
+      double cost = 0.0;
+      for (std::size_t k = 0; k < dof; ++k)
+        cost += weights[k] * std::abs(start[k] - end[k]);
+      costs[j] = std::abs(start[wrist] - end[wrist]) > M_PI ? cost + 10.0 : cost;
+    }
+  }
+};
+
+/**
+ * @brief Times a 'Builder' constructed with 'args' over every rung pair, one vertex pair at a time or as buildEdges()
+ *        picks
+ */
+template <typename Builder, typename... Args>
+double timeEdgeBuilder(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data, bool pairwise,
+                       std::size_t& n_edges, Args... args)
+{
+  const auto start = Clock::now();
+  n_edges = 0;
+  for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+  {
+    Builder builder(cfg.n_vertices, cfg.n_vertices, cfg.dof, args...);
+    if (pairwise) forEachPair(data[r], data[r + 1], cfg.dof, builder);
+    else descartes_planner::buildEdges(builder, data[r], data[r + 1], cfg.dof);
+    n_edges += builder.result().numEdges();
+  }
+  return secondsSince(start);
+}
+
+/**
+ * @brief Times the custom cost edge builders: one CostFunction call per vertex pair, as before BatchCostFunction, then
+ *        the same cost through toBatchCostFunction() and as a native batch cost, each built a row at a time
+ */
+void runBatchCosts(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data)
+{
+  if (cfg.dof > 32) return;
+
+  const double dt = 0.1;
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+  const auto adapted = descartes_planner::toBatchCostFunction(WristFlipCost{cfg.dof}, cfg.dof);
+  const descartes_planner::BatchCostFunction batch(WristFlipBatchCost{cfg.dof});
+
+  std::size_t n_edges;
+  if (cfg.timed)
+  {
+    using Builder = descartes_planner::CustomEdgesWithTime;
+    const double pair_time = timeEdgeBuilder<Builder>(cfg, data, true, n_edges, dt, vel_limits, adapted);
+    const double adapted_time = timeEdgeBuilder<Builder>(cfg, data, false, n_edges, dt, vel_limits, adapted);
+    const double batch_time = timeEdgeBuilder<Builder>(cfg, data, false, n_edges, dt, vel_limits, batch);
+    std::printf("  timed   edges: %zu, per edge: %.4f s, adapter: %.4f s, batch: %.4f s\n", n_edges, pair_time,
+                adapted_time, batch_time);
+  }
+
+  using Builder = descartes_planner::CustomEdgesWithoutTime;
+  const double pair_time = timeEdgeBuilder<Builder>(cfg, data, true, n_edges, adapted);
+  const double adapted_time = timeEdgeBuilder<Builder>(cfg, data, false, n_edges, adapted);
+  const double batch_time = timeEdgeBuilder<Builder>(cfg, data, false, n_edges, batch);
+  std::printf("  untimed edges: %zu, per edge: %.4f s, adapter: %.4f s, batch: %.4f s\n", n_edges, pair_time,
+              adapted_time, batch_time);
+}
+
+/**
+ * @brief Times the edge builders specialized for 'N' joints against the generic ones, with the default cost and with
+ *        WristFlipBatchCost as a functor rather than a BatchCostFunction
+ */
+template <std::size_t N>
+void runFixedDof(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data)
+{
+  using descartes_planner::DynamicDof;
+  using descartes_planner::FixedDof;
+  using descartes_planner::RungEdges;
+
+  const double dt = 0.1;
+  const std::vector<double> vel_limits(cfg.dof, 1.0);
+  const descartes_planner::BatchCostFunction batch(WristFlipBatchCost{cfg.dof});
+  const WristFlipBatchCost functor{cfg.dof};
+
+  std::size_t n_edges;
+  double dynamic_time, fixed_time;
+  if (cfg.timed)
+  {
+    dynamic_time = timeEdgeBuilder<descartes_planner::BasicDefaultEdgesWithTime<RungEdges, DynamicDof>>(
+        cfg, data, false, n_edges, dt, vel_limits);
+    fixed_time = timeEdgeBuilder<descartes_planner::BasicDefaultEdgesWithTime<RungEdges, FixedDof<N>>>(
+        cfg, data, false, n_edges, dt, vel_limits);
+    std::printf("  timed default   edges: %zu, dynamic: %.4f s, fixed: %.4f s\n", n_edges, dynamic_time, fixed_time);
+
+    dynamic_time = timeEdgeBuilder<descartes_planner::BasicCustomEdgesWithTime<RungEdges, DynamicDof>>(
+        cfg, data, false, n_edges, dt, vel_limits, batch);
+    fixed_time =
+        timeEdgeBuilder<descartes_planner::BasicCustomEdgesWithTime<RungEdges, FixedDof<N>, WristFlipBatchCost>>(
+            cfg, data, false, n_edges, dt, vel_limits, functor);
+    std::printf("  timed custom    edges: %zu, dynamic: %.4f s, fixed: %.4f s\n", n_edges, dynamic_time, fixed_time);
+  }
+
+  dynamic_time = timeEdgeBuilder<descartes_planner::BasicDefaultEdgesWithoutTime<RungEdges, DynamicDof>>(
+      cfg, data, false, n_edges);
+  fixed_time = timeEdgeBuilder<descartes_planner::BasicDefaultEdgesWithoutTime<RungEdges, FixedDof<N>>>(
+      cfg, data, false, n_edges);
+  std::printf("  untimed default edges: %zu, dynamic: %.4f s, fixed: %.4f s\n", n_edges, dynamic_time, fixed_time);
+
+  dynamic_time = timeEdgeBuilder<descartes_planner::BasicCustomEdgesWithoutTime<RungEdges, DynamicDof>>(
+      cfg, data, false, n_edges, batch);
+  fixed_time =
+      timeEdgeBuilder<descartes_planner::BasicCustomEdgesWithoutTime<RungEdges, FixedDof<N>, WristFlipBatchCost>>(
+          cfg, data, false, n_edges, functor);
+  std::printf("  untimed custom  edges: %zu, dynamic: %.4f s, fixed: %.4f s\n", n_edges, dynamic_time, fixed_time);
+}
+
+/**
+ * @brief Times 1000 insertRung() and assignRung() calls at random positions of a 20k rung graph, against the same
+ *        edits on a std::vector<Rung>
+ */
+void runRungEdits(const BenchmarkConfig& cfg)
+{
+  const std::size_t n_rungs = 20000;
+  const std::size_t n_inserts = 1000;
+
+  std::mt19937 rng(3);
+  std::vector<std::size_t> positions(n_inserts);
+  for (std::size_t i = 0; i < n_inserts; ++i)
+    positions[i] = std::uniform_int_distribution<std::size_t>(0, n_rungs + i)(rng);
+  const std::vector<std::vector<double>> sols(cfg.n_vertices, std::vector<double>(cfg.dof, 0.0));
+
+  descartes_planner::LadderGraph graph(cfg.dof);
+  graph.resize(n_rungs);
+  auto start = Clock::now();
+  for (auto r : positions)
+  {
+    graph.insertRung(r);
+    graph.assignRung(r, descartes_core::TrajectoryID::make_id(), descartes_core::TimingConstraint(), sols);
+  }
+  const double graph_time = secondsSince(start);
+
+  std::vector<descartes_planner::Rung> rungs(n_rungs);
+  start = Clock::now();
+  for (auto r : positions)
+  {
+    auto& rung = *rungs.emplace(rungs.begin() + r);
+    rung.id = descartes_core::TrajectoryID::make_id();
+    for (const auto& sol : sols)
+      rung.data.insert(rung.data.end(), sol.begin(), sol.end());
+    rung.edges.resize(sols.size());
+  }
+  const double vector_time = secondsSince(start);
+
+  std::printf("  LadderGraph: %.4f s, std::vector<Rung>: %.4f s\n", graph_time, vector_time);
+}
+
+/**
+ * @brief Times every supported relaxDense kernel over 'n_rungs - 1' dense rung pairs of random costs
+ */
+void runKernels(const BenchmarkConfig& cfg)
+{
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> cost_dist(0.0, 1.0);
+
+  const auto n = cfg.n_vertices;
+  std::vector<descartes_planner::Edge> edges(n * n);
+  for (std::size_t i = 0; i < edges.size(); ++i)
+    edges[i] = {cost_dist(rng), static_cast<unsigned>(i % n)};
+
+  const descartes_planner::RelaxationKernel kernels[] = {descartes_planner::RelaxationKernel::SCALAR,
+                                                         descartes_planner::RelaxationKernel::AVX2,
+                                                         descartes_planner::RelaxationKernel::AVX512};
+  for (auto kernel : kernels)
+  {
+    if (!descartes_planner::isKernelSupported(kernel)) continue;
+
+    std::vector<double> distance(n, 0.0), next(n);
+    std::vector<unsigned> predecessor(n);
+
+    auto start = Clock::now();
+    for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+    {
+      std::fill(next.begin(), next.end(), std::numeric_limits<double>::max());
+      descartes_planner::relaxDense(kernel, distance.data(), n, edges.data(), n, next.data(), predecessor.data());
+      distance.swap(next);
+    }
+    const double time = secondsSince(start);
+
+    const double cost = *std::min_element(distance.begin(), distance.end());
+    std::printf("  %-7s cost: %g, relax: %.4f s\n", descartes_planner::toString(kernel), cost, time);
+  }
+}
+
+/**
+ * @brief Builds the untimed ladder keeping only the 'k' cheapest edges out of each vertex, see
+ *        BasicDefaultEdgesWithoutTime, and compares the edge memory and the cost of the shortest path with keeping all
+ */
+void runTopKEdges(const BenchmarkConfig& cfg, const std::vector<std::vector<double>>& data)
+{
+  double full_cost = 0.0;
+  const std::size_t ks[] = {0, 32, 8, 2};
+  for (auto k : ks)
+  {
+    if (k >= cfg.n_vertices) continue;
+
+    descartes_planner::LadderGraph graph(cfg.dof);
+    graph.resize(cfg.n_rungs);
+    for (std::size_t r = 0; r < cfg.n_rungs; ++r)
+    {
+      graph.getRung(r).data = data[r];
+      graph.getEdges(r).resize(cfg.n_vertices);
+    }
+
+    auto start = Clock::now();
+    std::size_t n_edges = 0, memory = 0;
+    for (std::size_t r = 0; r + 1 < cfg.n_rungs; ++r)
+    {
+      descartes_planner::DefaultEdgesWithoutTime builder(cfg.n_vertices, cfg.n_vertices, cfg.dof, k);
+      descartes_planner::buildEdges(builder, data[r], data[r + 1], cfg.dof);
+      graph.assignEdges(r, std::move(builder.result()));
+      n_edges += graph.getEdges(r).numEdges();
+      memory += graph.getEdges(r).memoryUsage();
+    }
+    const double build_time = secondsSince(start);
+
+    start = Clock::now();
+    descartes_planner::DAGSearch search(graph);
+    const double cost = search.run();
+    const double search_time = secondsSince(start);
+    if (k == 0) full_cost = cost;
+
+    std::printf("  k %-4zu edges: %zu, edge memory: %.1f MB, cost: %g (%+.3f%%), build: %.4f s, search: %.4f s\n", k,
+                n_edges, memory / (1024.0 * 1024.0), cost, 100.0 * (cost - full_cost) / full_cost, build_time,
+                search_time);
+  }
+}
+
+/**
+ * @brief Runs 'fn' in a forked child process and reports the child's peak resident set size
+ */
+void runIsolated(const std::string& name, const std::function<void()>& fn)
+{
+  std::printf("%s\n", name.c_str());
+  std::fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    fn();
+    std::fflush(stdout);
+    std::_Exit(0);
+  }
+
+  int status = 0;
+  struct rusage usage;
+  if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+  {
+    std::printf("  failed to run benchmark process\n");
+    return;
+  }
+  std::printf("  peak RSS: %.1f MB\n", usage.ru_maxrss / 1024.0);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  BenchmarkConfig cfg;
+  if (argc > 1) cfg.n_rungs = std::strtoul(argv[1], nullptr, 10);
+  if (argc > 2) cfg.n_vertices = std::strtoul(argv[2], nullptr, 10);
+  if (argc > 3) cfg.dof = std::strtoul(argv[3], nullptr, 10);
+  if (argc > 4) cfg.timed = std::atoi(argv[4]) != 0;
+  if (argc > 5) cfg.search_threads = std::strtoul(argv[5], nullptr, 10);
+
+  if (cfg.n_rungs < 2 || cfg.n_vertices == 0 || cfg.dof == 0)
+  {
+    std::fprintf(stderr, "usage: %s [n_rungs >= 2] [n_vertices > 0] [dof > 0] [timed (0|1)] [search threads]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  std::printf("ladder graph: %zu rungs x %zu vertices, %zu dof, %s edges\n", cfg.n_rungs, cfg.n_vertices, cfg.dof,
+              cfg.timed ? "timed" : "untimed");
+
+  runIsolated("nested (vector<vector<Edge>>)", [&cfg] { runNested(cfg, makeRungData(cfg)); });
+  runIsolated("csr (RungEdges)", [&cfg] { runCSR(cfg, makeRungData(cfg)); });
+  runIsolated("implicit (RelaxingSink)", [&cfg] { runImplicit(cfg, makeRungData(cfg)); });
+  if (cfg.dof == 6) // the DOF of descartes_tests::CartesianRobot
+    runIsolated("streaming (StreamingLadderSolver)", [&cfg] { runStreaming(cfg); });
+  if (cfg.dof == 6)
+    runIsolated("insertGraph (PlanningGraph)", [&cfg] { runInsertGraph(cfg); });
+  runIsolated("rung edits (1000 random inserts into 20000 rungs)", [&cfg] { runRungEdits(cfg); });
+
+  if (cfg.timed)
+  {
+    std::printf("timed edge filters (best: %s)\n",
+                descartes_planner::toString(descartes_planner::bestRelaxationKernel()));
+    runEdgeFilters(cfg, makeRungData(cfg));
+    std::printf("timed edges on widely spread rungs\n");
+    runSpreadEdges(cfg);
+  }
+  else
+  {
+    std::printf("untimed edges capped to the k cheapest per vertex (0 for all)\n");
+    runTopKEdges(cfg, makeRungData(cfg));
+  }
+  std::printf("custom cost edges (wrist flip penalty)\n");
+  runBatchCosts(cfg, makeRungData(cfg));
+  if (cfg.dof == 6 || cfg.dof == 7)
+  {
+    std::printf("edge builders specialized for %zu joints\n", cfg.dof);
+    if (cfg.dof == 6) runFixedDof<6>(cfg, makeRungData(cfg));
+    else runFixedDof<7>(cfg, makeRungData(cfg));
+  }
+
+  std::printf("dense relaxation kernels (best: %s)\n",
+              descartes_planner::toString(descartes_planner::bestRelaxationKernel()));
+  runKernels(cfg);
+  return 0;
+}
@@ -4,8 +4,11 @@
  *  Created on: Sep 4, 2019
  *      Author: jrgnicho
  */
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <descartes_planner/bdsp_graph_planner.h>
+#include <descartes_planner/task_pool.h>
 #include <ros/node_handle.h>
 #include <kdl_parser/kdl_parser.hpp>
 #include <trac_ik/trac_ik.hpp>
@@ -32,7 +35,7 @@ using IsometryT = Eigen::Transform<FloatT,3,Eigen::Isometry>;
 using PointDataT = descartes_planner::PointData<FloatT>;
 using PointSamplerT = descartes_planner::PointSampler<FloatT>;
 using PointSampleGroupT = descartes_planner::PointSampleGroup<FloatT>;
-using EdgePropertiesF = descartes_planner::EdgeProperties<FloatT>;
+using CompactEdgeF = descartes_planner::CompactEdge<FloatT>;
 
 
 static const double POS_TOLERANCE = 1e-4; // meters
@@ -128,14 +131,49 @@ EigenSTL::vector_Isometry3f generateTrajectory(const Eigen::Isometry3f& nominal_
   return std::move(traj_poses);
 }
 
+/**
+ * @brief TRAC_IK isn't reentrant, so the samplers generating on different worker threads each use a solver of their
+ *        own, made the first time a worker asks for it
+ */
+class IKSolverSet
+{
+public:
+  IKSolverSet(TracIKPtr first_solver, std::function<TracIKPtr()> make_solver):
+    make_solver_(make_solver),
+    solvers_({first_solver})
+  {
+
+  }
+
+  TracIKPtr get(std::size_t worker)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(solvers_.size() <= worker)
+    {
+      solvers_.resize(worker + 1);
+    }
+    if(!solvers_[worker])
+    {
+      solvers_[worker] = make_solver_();
+    }
+    return solvers_[worker];
+  }
+
+private:
+  std::function<TracIKPtr()> make_solver_;
+  std::mutex mutex_;
+  std::vector<TracIKPtr> solvers_;
+};
+
 class ZAxixSampler: public PointSamplerT
 {
 public:
-  ZAxixSampler(const IsometryT& pose, moveit::core::RobotModelConstPtr model, TracIKPtr ik_solver,
+  ZAxixSampler(const IsometryT& pose, moveit::core::RobotModelConstPtr model, std::shared_ptr<IKSolverSet> ik_solvers,
                const std::vector<FloatT>& seed, std::size_t num_samples , int index):
      pose_(pose),
      model_(model),
-     ik_solver_(ik_solver),
+     ik_solvers_(ik_solvers),
+     ik_solver_(ik_solvers->get(0)),
      num_samples_(num_samples),
      seed_(seed),
      samples_(nullptr),
@@ -159,6 +197,13 @@ public:
     return computeSamples();
   }
 
+  PointSamplerT::Ptr clone(std::size_t worker) const override
+  {
+    std::shared_ptr<ZAxixSampler> sampler = std::make_shared<ZAxixSampler>(*this);
+    sampler->ik_solver_ = ik_solvers_->get(worker);
+    return sampler;
+  }
+
   std::size_t getDofs()
   {
     KDL::Chain chain;
@@ -270,6 +315,7 @@ protected:
   IsometryT pose_;
   std::size_t num_samples_;
   std::vector<FloatT> seed_;
+  std::shared_ptr<IKSolverSet> ik_solvers_;
   TracIKPtr ik_solver_;
   moveit::core::RobotModelConstPtr model_;
   PointSampleGroupT::Ptr samples_;
@@ -289,7 +335,6 @@ public:
     tool_speed_(nominal_tool_speed)
   {
     ik_solver_->getKDLChain(kdl_chain_);
-    fk_solver_ = std::make_shared<KDL::ChainFkSolverPos_recursive>(kdl_chain_);
   }
 
   virtual ~SpeedEvaluator()
@@ -297,21 +342,30 @@ public:
 
   }
 
-  std::vector< EdgePropertiesF > evaluate(PointSampleGroupT::ConstPtr s1,
-                                          PointSampleGroupT::ConstPtr s2,
-                                          const std::vector<std::size_t>& exclude_s1 = {},
-                                          const std::vector<std::size_t>& exclude_s2 = {}) const
+  bool evaluateCompact(PointSampleGroupT::ConstPtr s1,
+                       PointSampleGroupT::ConstPtr s2,
+                       const std::vector<std::size_t>& exclude_s1,
+                       std::vector< CompactEdgeF >& edges) const override
   {
     using namespace Eigen;
-    std::vector< EdgePropertiesF > edges;
-    //edges.reserve(s1->num_samples * s2->num_samples);
-    EdgePropertiesF edge;
+    edges.clear();
+    // the planner evaluates several pairs of points at once, each needs its own solver
+    KDL::ChainFkSolverPos_recursive fk_solver(kdl_chain_);
+    std::vector<bool> excluded(s1->num_samples, false);
+    for(std::size_t i1 : exclude_s1)
+    {
+      excluded[i1] = true;
+    }
     KDL::JntArray jpos1(s1->num_dofs);
     KDL::JntArray jpos2(s2->num_dofs);
     std::vector<FloatT> jvals1(s1->num_dofs, 0.0), jvals2(s2->num_dofs,0.0);
     std::array<FloatT,2> cart_time, cart_disp;
     for(std::size_t i1 = 0; i1 < s1->num_samples; i1++)
     {
+      if(excluded[i1])
+      {
+        continue;
+      }
       auto start1_pos = std::next(s1->values.begin(), i1 * s1->num_dofs);
       auto end1_pos = std::next(start1_pos, s1->num_dofs);
       jvals1.assign(start1_pos, end1_pos);
@@ -324,16 +378,10 @@ public:
         jpos2.data = Map<VectorXf>(&jvals2[0], jvals2.size()).cast<double>();
 
         // computing time
-        cart_disp = computeCartDisplacement(jpos1, jpos2);
+        cart_disp = computeCartDisplacement(fk_solver, jpos1, jpos2);
         cart_time[0] = cart_disp[0]/tool_speed_[0];
         cart_time[1] = cart_disp[1]/tool_speed_[1];
 
-
-        edge.src_vtx.point_id = s1->point_id;
-        edge.src_vtx.sample_index = i1;
-        edge.dst_vtx.point_id = s2->point_id;
-        edge.dst_vtx.sample_index = i2;
-        edge.valid = true;
         Eigen::VectorXd diff = jpos1.data - jpos2.data;
         diff.array() = diff.array().abs();
         double sum = std::abs(diff.sum());
@@ -346,31 +394,27 @@ public:
         {
           CONSOLE_BRIDGE_logDebug("Velocity exceeded for points (%i: %lu, %i: %lu)",
                                   s1->point_id, i1, s2->point_id, i2);
-          edge.valid = false;
-          edge.weight = 1e5;
         }
         else
         {
-          edge.valid = true;
-          edge.weight = sum;
+          edges.push_back({static_cast<std::uint32_t>(i1), static_cast<std::uint32_t>(i2), static_cast<FloatT>(sum)});
         }
-        edges.push_back(edge);
-
       }
     }
-    return std::move(edges);
+    return true;
   }
 
 protected:
 
-  std::array<FloatT,2> computeCartDisplacement(const KDL::JntArray& pos1, const KDL::JntArray& pos2) const
+  std::array<FloatT,2> computeCartDisplacement(KDL::ChainFkSolverPos_recursive& fk_solver, const KDL::JntArray& pos1,
+                                               const KDL::JntArray& pos2) const
   {
     using namespace Eigen;
     std::array<FloatT,2> cart_dplc;
     KDL::Frame c1, c2;
     Isometry3d pose1, pose2;
-    fk_solver_->JntToCart(pos1,c1);
-    fk_solver_->JntToCart(pos2,c2);
+    fk_solver.JntToCart(pos1,c1);
+    fk_solver.JntToCart(pos2,c2);
 
     tf::transformKDLToEigen(c1, pose1);
     tf::transformKDLToEigen(c2, pose2);
@@ -426,7 +470,6 @@ protected:
 
   KDL::Chain kdl_chain_;
   std::vector<std::string> joint_names_;
-  mutable FKSolverPtr fk_solver_;
   std::array<FloatT,2> tool_speed_;
   mutable TracIKPtr ik_solver_;
   moveit::core::RobotModelConstPtr model_;
@@ -437,9 +480,10 @@ class DescartesGraphPlanner
 {
 public:
   DescartesGraphPlanner():
-    solver_(nullptr, false)
+    solver_(nullptr, false, descartes_planner::BDSPBackend::LAYERED_DAG)
   {
-
+    // sampling and edge evaluation on every core
+    solver_.setTaskPool(std::make_shared<descartes_planner::TaskPool>());
   }
 
   virtual ~DescartesGraphPlanner()
@@ -562,6 +606,10 @@ int main(int argc, char** argv)
                                                              ROBOT_MODEL_PARAM,
                                                              0.01);
 
+  auto ik_solvers = std::make_shared<IKSolverSet>(ik_solver, [base_link, tip_link](){
+    return std::make_shared<TRAC_IK::TRAC_IK>(base_link, tip_link, ROBOT_MODEL_PARAM, 0.01);
+  });
+
   KDL::Chain chain;
   if(!ik_solver->getKDLChain(chain))
   {
@@ -609,7 +657,7 @@ int main(int argc, char** argv)
   std::transform(traj_waypoints.begin(),traj_waypoints.end(),std::back_inserter(samplers),
                  [&](const Eigen::Isometry3f& wp){
     ZAxixSampler::Ptr sampler = std::make_shared<ZAxixSampler>(wp,robot_model,
-                                                               ik_solver,seed_pose, num_samples, idx_counter);
+                                                               ik_solvers,seed_pose, num_samples, idx_counter);
     idx_counter++;
     return sampler;
   });
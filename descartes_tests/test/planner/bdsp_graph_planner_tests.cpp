@@ -0,0 +1,397 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <descartes_planner/bdsp_graph_planner.h>
+#include <descartes_planner/task_pool.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace descartes_planner;
+
+namespace
+{
+const double MAX_STEP = 0.5;
+
+// Samples of random joint values around a common pose
+std::vector<PointSampler<double>::Ptr> makeRandomSamplers(std::size_t n_points, std::size_t dof, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> count_dist(3, 12);
+  std::uniform_real_distribution<double> joint_dist(-0.6, 0.6);
+
+  std::vector<PointSampler<double>::Ptr> samplers;
+  for (std::size_t p = 0; p < n_points; ++p)
+  {
+    auto group = std::make_shared<PointSampleGroup<double>>();
+    group->num_dofs = dof;
+    group->num_samples = count_dist(rng);
+    group->point_id = static_cast<int>(p);
+    group->values.resize(group->num_samples * dof);
+    for (auto& v : group->values)
+      v = joint_dist(rng);
+    samplers.push_back(std::make_shared<ProxySampler<double>>(group));
+  }
+  return samplers;
+}
+
+double stepCost(const double* a, const double* b, std::size_t dof)
+{
+  double cost = 0.0;
+  for (std::size_t j = 0; j < dof; ++j)
+    cost += std::abs(a[j] - b[j]);
+  return cost;
+}
+
+bool withinStep(const double* a, const double* b, std::size_t dof, double max_step = MAX_STEP)
+{
+  for (std::size_t j = 0; j < dof; ++j)
+  {
+    if (std::abs(a[j] - b[j]) > max_step) return false;
+  }
+  return true;
+}
+
+// Joint distance weights, with the pairs that move a joint too far invalid
+class StepEvaluator : public EdgeEvaluator<double>
+{
+public:
+  explicit StepEvaluator(double max_step = MAX_STEP) : max_step_(max_step) {}
+
+  std::vector<EdgeProperties<double>> evaluate(PointSampleGroup<double>::ConstPtr s1,
+                                               PointSampleGroup<double>::ConstPtr s2,
+                                               const std::vector<std::size_t>& = {},
+                                               const std::vector<std::size_t>& = {}) const override
+  {
+    const std::size_t dof = s1->num_dofs;
+    std::vector<EdgeProperties<double>> edges;
+    for (std::size_t i = 0; i < s1->num_samples; ++i)
+    {
+      for (std::size_t j = 0; j < s2->num_samples; ++j)
+      {
+        EdgeProperties<double> edge;
+        edge.src_vtx.point_id = s1->point_id;
+        edge.src_vtx.sample_index = i;
+        edge.dst_vtx.point_id = s2->point_id;
+        edge.dst_vtx.sample_index = j;
+        edge.valid = withinStep(&s1->values[i * dof], &s2->values[j * dof], dof, max_step_);
+        edge.weight = edge.valid ? stepCost(&s1->values[i * dof], &s2->values[j * dof], dof) : 1e5;
+        edges.push_back(edge);
+      }
+    }
+    return edges;
+  }
+
+private:
+  double max_step_;
+};
+
+// StepEvaluator's valid edges, evaluated in place
+class CompactStepEvaluator : public EdgeEvaluator<double>
+{
+public:
+  bool evaluateCompact(PointSampleGroup<double>::ConstPtr s1, PointSampleGroup<double>::ConstPtr s2,
+                       const std::vector<std::size_t>&, std::vector<CompactEdge<double>>& edges) const override
+  {
+    const std::size_t dof = s1->num_dofs;
+    edges.clear();
+    for (std::uint32_t i = 0; i < s1->num_samples; ++i)
+    {
+      for (std::uint32_t j = 0; j < s2->num_samples; ++j)
+      {
+        if (withinStep(&s1->values[i * dof], &s2->values[j * dof], dof))
+          edges.push_back({ i, j, stepCost(&s1->values[i * dof], &s2->values[j * dof], dof) });
+      }
+    }
+    return true;
+  }
+};
+
+// Generates from clones bound to a worker, checking that no two of them generate for the same worker at once. The
+// original fails if called while a pool is set.
+class CloningSampler : public PointSampler<double>
+{
+public:
+  struct Workers
+  {
+    std::mutex mutex;
+    std::vector<int> clones, generating, overlaps;
+    bool pool_set = false;
+    int original_calls = 0;
+  };
+
+  CloningSampler(PointSampleGroup<double>::Ptr samples, std::shared_ptr<Workers> workers, int worker = -1)
+    : samples_(samples), workers_(workers), worker_(worker)
+  {
+  }
+
+  PointSampleGroup<double>::Ptr generate() override
+  {
+    if (worker_ < 0)
+    {
+      std::lock_guard<std::mutex> lock(workers_->mutex);
+      ++workers_->original_calls;
+      if (workers_->pool_set) return nullptr;
+    }
+    else
+    {
+      std::lock_guard<std::mutex> lock(workers_->mutex);
+      if (workers_->generating[worker_]++ != 0) ++workers_->overlaps[worker_];
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    if (worker_ >= 0)
+    {
+      std::lock_guard<std::mutex> lock(workers_->mutex);
+      --workers_->generating[worker_];
+    }
+    return samples_ ? std::make_shared<PointSampleGroup<double>>(*samples_) : nullptr;
+  }
+
+  PointSampler<double>::Ptr clone(std::size_t worker) const override
+  {
+    std::lock_guard<std::mutex> lock(workers_->mutex);
+    if (workers_->clones.size() <= worker)
+    {
+      workers_->clones.resize(worker + 1, 0);
+      workers_->generating.resize(worker + 1, 0);
+      workers_->overlaps.resize(worker + 1, 0);
+    }
+    ++workers_->clones[worker];
+    return std::make_shared<CloningSampler>(samples_, workers_, static_cast<int>(worker));
+  }
+
+private:
+  PointSampleGroup<double>::Ptr samples_;
+  std::shared_ptr<Workers> workers_;
+  int worker_;
+};
+
+double pathCost(const std::vector<PointData<double>::ConstPtr>& path)
+{
+  double cost = 0.0;
+  for (std::size_t p = 1; p < path.size(); ++p)
+  {
+    EXPECT_TRUE(withinStep(path[p - 1]->values.data(), path[p]->values.data(), path[p]->values.size()));
+    cost += stepCost(path[p - 1]->values.data(), path[p]->values.data(), path[p]->values.size());
+  }
+  return cost;
+}
+}  // namespace
+
+TEST(BDSPGraphPlanner, layered_backend_matches_dijkstra)
+{
+  std::mt19937 rng(3);
+  EdgeEvaluator<double>::ConstPtr evaluator = std::make_shared<StepEvaluator>();
+  int solved = 0;
+  for (int trial = 0; trial < 20; ++trial)
+  {
+    auto samplers = makeRandomSamplers(30, 2, rng);
+
+    BDSPGraphPlanner<double> dijkstra(nullptr, false, BDSPBackend::BOOST_DIJKSTRA);
+    BDSPGraphPlanner<double> layered(nullptr, false, BDSPBackend::LAYERED_DAG);
+    EXPECT_EQ(BDSPBackend::LAYERED_DAG, layered.getBackend());
+    const bool built = dijkstra.build(samplers, evaluator);
+    ASSERT_EQ(built, layered.build(samplers, evaluator)) << "trial " << trial;
+    if (!built) continue;
+
+    std::vector<PointData<double>::ConstPtr> dijkstra_path, layered_path;
+    const bool found = dijkstra.solve(dijkstra_path);
+    ASSERT_EQ(found, layered.solve(layered_path)) << "trial " << trial;
+    if (!found) continue;
+
+    ASSERT_EQ(samplers.size(), layered_path.size());
+    for (std::size_t p = 0; p < layered_path.size(); ++p)
+      EXPECT_EQ(static_cast<int>(p), layered_path[p]->point_id);
+    EXPECT_NEAR(pathCost(dijkstra_path), pathCost(layered_path), 1e-9) << "trial " << trial;
+    ++solved;
+  }
+  EXPECT_GT(solved, 5);
+}
+
+TEST(BDSPGraphPlanner, deadline)
+{
+  std::mt19937 rng(8);
+  auto samplers = makeRandomSamplers(10, 1, rng);
+  EdgeEvaluator<double>::ConstPtr evaluator = std::make_shared<StepEvaluator>();
+  const auto now = std::chrono::steady_clock::now();
+
+  BDSPGraphPlanner<double> planner(nullptr, false, BDSPBackend::LAYERED_DAG);
+  EXPECT_FALSE(planner.build(samplers, evaluator, now));
+  EXPECT_TRUE(planner.timedOut());
+
+  ASSERT_TRUE(planner.build(samplers, evaluator, now + std::chrono::hours(1)));
+  EXPECT_FALSE(planner.timedOut());
+  std::vector<PointData<double>::ConstPtr> path;
+  EXPECT_FALSE(planner.solve(path, now));
+  EXPECT_TRUE(planner.timedOut());
+  EXPECT_TRUE(planner.solve(path, now + std::chrono::hours(1)));
+  EXPECT_FALSE(planner.timedOut());
+}
+
+TEST(BDSPGraphPlanner, parallel_build_matches_serial)
+{
+  std::mt19937 rng(12);
+  auto pool = std::make_shared<TaskPool>(3);
+  const BDSPBackend backends[] = { BDSPBackend::BOOST_DIJKSTRA, BDSPBackend::LAYERED_DAG };
+  for (int trial = 0; trial < 10; ++trial)
+  {
+    // Tight steps leave some segments without valid edges
+    auto samplers = makeRandomSamplers(40, 2, rng);
+    EdgeEvaluator<double>::ConstPtr evaluator = std::make_shared<StepEvaluator>(trial % 2 == 0 ? MAX_STEP : 0.3);
+    for (auto backend : backends)
+    {
+      for (bool report_all : { false, true })
+      {
+        BDSPGraphPlanner<double> serial(nullptr, report_all, backend);
+        BDSPGraphPlanner<double> parallel(nullptr, report_all, backend);
+        parallel.setTaskPool(pool);
+        const bool built = serial.build(samplers, evaluator);
+        ASSERT_EQ(built, parallel.build(samplers, evaluator)) << "trial " << trial;
+
+        std::vector<std::size_t> serial_failed, parallel_failed;
+        serial.getFailedEdges(serial_failed);
+        parallel.getFailedEdges(parallel_failed);
+        EXPECT_EQ(serial_failed, parallel_failed) << "trial " << trial;
+        if (!built) continue;
+
+        std::vector<PointData<double>::ConstPtr> serial_path, parallel_path;
+        ASSERT_EQ(serial.solve(serial_path), parallel.solve(parallel_path));
+        ASSERT_EQ(serial_path.size(), parallel_path.size());
+        for (std::size_t p = 0; p < serial_path.size(); ++p)
+          EXPECT_EQ(serial_path[p]->values, parallel_path[p]->values) << "trial " << trial << ", point " << p;
+      }
+    }
+  }
+}
+
+TEST(BDSPGraphPlanner, parallel_generation_uses_clones)
+{
+  std::mt19937 rng(21);
+  auto pool = std::make_shared<TaskPool>(3);
+  EdgeEvaluator<double>::ConstPtr evaluator = std::make_shared<StepEvaluator>();
+  const std::size_t n_points = 30;
+
+  // The same random samples behind plain and cloning samplers, with or without a couple of failing points
+  for (bool with_failures : { false, true })
+  {
+    auto plain = makeRandomSamplers(n_points, 2, rng);
+    auto workers = std::make_shared<CloningSampler::Workers>();
+    std::vector<PointSampler<double>::Ptr> cloning;
+    for (std::size_t p = 0; p < n_points; ++p)
+    {
+      auto samples = plain[p]->generate();
+      if (with_failures && (p == 7 || p == 19))
+      {
+        samples = nullptr;
+        plain[p] = std::make_shared<CloningSampler>(nullptr, std::make_shared<CloningSampler::Workers>());
+      }
+      cloning.push_back(std::make_shared<CloningSampler>(samples, workers));
+    }
+
+    for (bool report_all : { false, true })
+    {
+      BDSPGraphPlanner<double> serial(nullptr, report_all, BDSPBackend::LAYERED_DAG);
+      BDSPGraphPlanner<double> parallel(nullptr, report_all, BDSPBackend::LAYERED_DAG);
+      parallel.setTaskPool(pool);
+      workers->pool_set = true;
+      workers->clones.clear();
+      workers->original_calls = 0;
+
+      const bool built = serial.build(plain, evaluator);
+      EXPECT_EQ(!with_failures, built);
+      ASSERT_EQ(built, parallel.build(cloning, evaluator));
+      EXPECT_EQ(0, workers->original_calls);
+      std::size_t n_clones = 0;
+      for (std::size_t w = 0; w < workers->clones.size(); ++w)
+      {
+        n_clones += workers->clones[w];
+        EXPECT_EQ(0, workers->overlaps[w]) << "worker " << w;
+      }
+      EXPECT_LE(workers->clones.size(), pool->threads());
+      if (!with_failures || report_all)
+      {
+        EXPECT_EQ(n_points, n_clones);
+      }
+
+      std::vector<std::size_t> serial_failed, parallel_failed;
+      serial.getFailedPoints(serial_failed);
+      parallel.getFailedPoints(parallel_failed);
+      EXPECT_EQ(serial_failed, parallel_failed) << "report all " << report_all;
+      if (!built) continue;
+
+      std::vector<PointData<double>::ConstPtr> serial_path, parallel_path;
+      ASSERT_EQ(serial.solve(serial_path), parallel.solve(parallel_path));
+      ASSERT_EQ(serial_path.size(), parallel_path.size());
+      for (std::size_t p = 0; p < serial_path.size(); ++p)
+        EXPECT_EQ(serial_path[p]->values, parallel_path[p]->values) << "point " << p;
+    }
+  }
+}
+
+TEST(BDSPGraphPlanner, compact_evaluator)
+{
+  std::mt19937 rng(5);
+  StepEvaluator full;
+  CompactStepEvaluator compact;
+
+  // Each default is the other's valid edges
+  auto samplers = makeRandomSamplers(2, 2, rng);
+  auto s1 = samplers[0]->generate(), s2 = samplers[1]->generate();
+  std::vector<CompactEdge<double>> from_full, from_compact;
+  ASSERT_TRUE(full.evaluateCompact(s1, s2, {}, from_full));
+  ASSERT_TRUE(compact.evaluateCompact(s1, s2, {}, from_compact));
+  ASSERT_EQ(from_compact.size(), from_full.size());
+  std::vector<EdgeProperties<double>> adapted = compact.evaluate(s1, s2);
+  ASSERT_EQ(from_compact.size(), adapted.size());
+  for (std::size_t e = 0; e < from_full.size(); ++e)
+  {
+    EXPECT_EQ(from_compact[e].src, from_full[e].src);
+    EXPECT_EQ(from_compact[e].dst, from_full[e].dst);
+    EXPECT_EQ(from_compact[e].weight, from_full[e].weight);
+    EXPECT_TRUE(adapted[e].valid);
+    EXPECT_EQ(s1->point_id, static_cast<int>(adapted[e].src_vtx.point_id));
+    EXPECT_EQ(from_compact[e].src, adapted[e].src_vtx.sample_index);
+    EXPECT_EQ(from_compact[e].dst, adapted[e].dst_vtx.sample_index);
+  }
+
+  // And the planner finds the same paths with either
+  EdgeEvaluator<double>::ConstPtr full_ptr = std::make_shared<StepEvaluator>();
+  EdgeEvaluator<double>::ConstPtr compact_ptr = std::make_shared<CompactStepEvaluator>();
+  const BDSPBackend backends[] = { BDSPBackend::BOOST_DIJKSTRA, BDSPBackend::LAYERED_DAG };
+  for (int trial = 0; trial < 10; ++trial)
+  {
+    samplers = makeRandomSamplers(30, 2, rng);
+    for (auto backend : backends)
+    {
+      BDSPGraphPlanner<double> full_planner(nullptr, false, backend);
+      BDSPGraphPlanner<double> compact_planner(nullptr, false, backend);
+      const bool built = full_planner.build(samplers, full_ptr);
+      ASSERT_EQ(built, compact_planner.build(samplers, compact_ptr)) << "trial " << trial;
+      if (!built) continue;
+
+      std::vector<PointData<double>::ConstPtr> full_path, compact_path;
+      ASSERT_EQ(full_planner.solve(full_path), compact_planner.solve(compact_path));
+      ASSERT_EQ(full_path.size(), compact_path.size());
+      for (std::size_t p = 0; p < full_path.size(); ++p)
+        EXPECT_EQ(full_path[p]->values, compact_path[p]->values) << "trial " << trial << ", point " << p;
+    }
+  }
+}
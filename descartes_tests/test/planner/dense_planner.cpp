@@ -20,3 +20,74 @@
 #include <descartes_planner/dense_planner.h>
 
 INSTANTIATE_TYPED_TEST_CASE_P(DensePlannerTest, PathPlannerTest, descartes_planner::DensePlanner);
+
+TEST(DensePlanner, beam_config)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(6, 1.0)));
+  descartes_planner::DensePlanner planner;
+  ASSERT_TRUE(planner.initialize(robot));
+
+  EXPECT_TRUE(planner.setConfig({ { "beam_width", "4" }, { "beam_cost_ratio", "1.5" } }));
+  EXPECT_EQ(4u, planner.getPlanningGraph().getBeam().width);
+  EXPECT_EQ(1.5, planner.getPlanningGraph().getBeam().cost_ratio);
+
+  EXPECT_FALSE(planner.setConfig({ { "beam_width", "-1" } }));
+  EXPECT_FALSE(planner.setConfig({ { "beam_cost_ratio", "0.5" } }));
+  EXPECT_FALSE(planner.setConfig({ { "beam_validation", "yes" } }));
+  EXPECT_EQ(descartes_core::PlannerError::INVALID_CONFIGURATION_PARAMETER, planner.getErrorCode());
+
+  EXPECT_TRUE(planner.setConfig({ { "beam_validation", "1" } }));
+  EXPECT_TRUE(planner.getPlanningGraph().getBeamValidation());
+  EXPECT_EQ(4u, planner.getPlanningGraph().getBeam().width); // earlier settings are kept
+}
+
+TEST(DensePlanner, thread_and_edge_config)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(6, 1.0)));
+  descartes_planner::DensePlanner planner;
+  ASSERT_TRUE(planner.initialize(robot));
+
+  EXPECT_TRUE(planner.setConfig({ { "threads", "3" }, { "thread_affinity", "0,2-3" } }));
+  const auto pool = planner.getPlanningGraph().getTaskPool();
+  ASSERT_TRUE(pool != nullptr);
+  EXPECT_EQ(3u, pool->threads());
+  EXPECT_EQ(std::vector<int>({ 0, 2, 3 }), pool->cpus());
+
+  EXPECT_FALSE(planner.setConfig({ { "threads", "-1" } }));
+  EXPECT_FALSE(planner.setConfig({ { "thread_affinity", "2-0" } }));
+  EXPECT_FALSE(planner.setConfig({ { "thread_affinity", "0,a" } }));
+
+  EXPECT_TRUE(planner.setConfig({ { "beam_width", "2" } }));
+  EXPECT_EQ(pool, planner.getPlanningGraph().getTaskPool()); // the pool is kept while its parameters are
+  EXPECT_TRUE(planner.setConfig({ { "threads", "1" }, { "max_out_edges", "8" } }));
+  EXPECT_EQ(8u, planner.getPlanningGraph().getMaxOutEdges());
+  EXPECT_FALSE(planner.setConfig({ { "max_out_edges", "-2" } }));
+  EXPECT_EQ(1u, planner.getPlanningGraph().getTaskPool()->threads());
+}
+
+TEST(DensePlanner, deadline)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(6, 1.0)));
+  descartes_planner::DensePlanner planner;
+  ASSERT_TRUE(planner.initialize(robot));
+
+  const auto input = descartes_tests::makeConstantVelocityTrajectory(Eigen::Vector3d(-1.0, 0, 0),
+                                                                     Eigen::Vector3d(1.0, 0, 0), 0.9, 10);
+  const auto now = std::chrono::steady_clock::now();
+  EXPECT_TRUE(planner.planPath(input, now + std::chrono::hours(1)));
+  EXPECT_EQ(descartes_core::PlannerError::OK, planner.getErrorCode());
+
+  // A deadline that has already passed stops planning before any IK is done
+  EXPECT_FALSE(planner.planPath(input, now));
+  EXPECT_EQ(descartes_core::PlannerError::PLANNING_TIMEOUT, planner.getErrorCode());
+  EXPECT_EQ(descartes_planner::BuildFailure::CANCELLED, planner.getPlanningGraph().getBuildFailure().reason);
+  std::string msg;
+  EXPECT_TRUE(planner.getErrorMessage(planner.getErrorCode(), msg));
+
+  // Going through the base class
+  descartes_core::PathPlannerBase& base = planner;
+  EXPECT_TRUE(base.planPath(input, std::chrono::steady_clock::now() + std::chrono::hours(1)));
+}
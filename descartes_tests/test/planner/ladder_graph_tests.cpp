@@ -0,0 +1,1151 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <descartes_planner/planning_graph.h>
+#include <descartes_planner/ladder_graph_beam_search.h>
+#include <descartes_planner/ladder_graph_dag_search.h>
+#include <descartes_planner/ladder_graph_edge_filter.h>
+#include <descartes_planner/ladder_graph_incremental_search.h>
+#include <descartes_planner/ladder_graph_joint_index.h>
+#include <descartes_planner/ladder_graph_k_shortest_paths.h>
+#include <descartes_planner/ladder_graph_relaxation.h>
+#include <descartes_planner/planning_graph_edge_policy.h>
+#include <descartes_planner/streaming_ladder_solver.h>
+#include <descartes_tests/cartesian_robot.h>
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+
+using namespace descartes_planner;
+
+// Builds the dense edges between two rungs of random joint values; costs are rounded so that ties are common
+static RungEdges makeDenseEdges(std::size_t n_src, std::size_t n_dst, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> cost_dist(0, 8);
+
+  DefaultEdgesWithoutTime builder(n_src, n_dst, 1);
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    for (std::size_t j = 0; j < n_dst; ++j)
+    {
+      const double start = 0.0;
+      const double stop = 0.25 * cost_dist(rng);
+      builder.consider(&start, &stop, j);
+    }
+    builder.next(i);
+  }
+  return std::move(builder.result());
+}
+
+static const RelaxationKernel ALL_KERNELS[] = {RelaxationKernel::SCALAR, RelaxationKernel::AVX2,
+                                               RelaxationKernel::AVX512};
+
+TEST(LadderGraph, dense_builder_marks_targets)
+{
+  std::mt19937 rng(0);
+  auto edges = makeDenseEdges(3, 5, rng);
+  EXPECT_EQ(5u, edges.denseTargets());
+  EXPECT_EQ(15u, edges.numEdges());
+
+  edges.clear();
+  EXPECT_EQ(0u, edges.denseTargets());
+}
+
+TEST(LadderGraph, relaxation_kernels_match_scalar)
+{
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dist_dist(0, 4);
+
+  // Destination counts that exercise full vector tiles, the scalar tail, and both together
+  const std::size_t dst_sizes[] = {1, 7, 16, 33, 100};
+  for (std::size_t n_dst : dst_sizes)
+  {
+    const std::size_t n_src = 13;
+    const auto edges = makeDenseEdges(n_src, n_dst, rng);
+
+    std::vector<double> src_distance(n_src);
+    for (auto& d : src_distance)
+      d = 0.5 * dist_dist(rng);
+    src_distance[3] = std::numeric_limits<double>::max(); // unreachable source
+
+    std::vector<double> expected_distance(n_dst, std::numeric_limits<double>::max());
+    std::vector<unsigned> expected_predecessor(n_dst, 0);
+    expected_distance[0] = -1.0; // already better than anything reachable
+    relaxDense(RelaxationKernel::SCALAR, src_distance.data(), n_src, edges.edges().data(), n_dst,
+               expected_distance.data(), expected_predecessor.data());
+
+    for (auto kernel : ALL_KERNELS)
+    {
+      if (!isKernelSupported(kernel)) continue;
+
+      std::vector<double> distance(n_dst, std::numeric_limits<double>::max());
+      std::vector<unsigned> predecessor(n_dst, 0);
+      distance[0] = -1.0;
+      relaxDense(kernel, src_distance.data(), n_src, edges.edges().data(), n_dst, distance.data(),
+                 predecessor.data());
+
+      EXPECT_EQ(expected_distance, distance) << toString(kernel) << " with " << n_dst << " targets";
+      EXPECT_EQ(expected_predecessor, predecessor) << toString(kernel) << " with " << n_dst << " targets";
+    }
+  }
+}
+
+TEST(LadderGraph, edge_filter_kernels_match_builder)
+{
+  std::mt19937 rng(9);
+  std::uniform_real_distribution<double> joint_dist(-1.0, 1.0);
+
+  const std::size_t dofs[] = {6, 7};
+  const std::size_t dst_sizes[] = {1, 7, 8, 37, 100};
+  for (std::size_t dof : dofs)
+  {
+    for (std::size_t n_dst : dst_sizes)
+    {
+      const std::size_t n_src = 11;
+      std::vector<double> from(n_src * dof), to(n_dst * dof);
+      for (auto& v : from)
+        v = joint_dist(rng);
+      for (auto& v : to)
+        v = joint_dist(rng);
+      to[dof - 1] = std::numeric_limits<double>::quiet_NaN(); // passes the limit test, like the scalar test
+
+      // The scalar builder, one pair at a time
+      const std::vector<double> vel_limits(dof, 1.0);
+      DefaultEdgesWithTime expected(n_src, n_dst, dof, 1.2, vel_limits);
+      for (std::size_t i = 0; i < n_src; ++i)
+      {
+        for (std::size_t j = 0; j < n_dst; ++j)
+          expected.consider(&from[i * dof], &to[j * dof], j);
+        expected.next(i);
+      }
+      const auto& expected_edges = expected.result().edges();
+
+      std::vector<double> targets;
+      transposeJoints(to.data(), n_dst, dof, targets);
+      const std::vector<double> max_delta(dof, 1.2);
+
+      for (auto kernel : ALL_KERNELS)
+      {
+        if (!isKernelSupported(kernel)) continue;
+
+        std::vector<unsigned> indices(n_dst);
+        std::vector<double> costs(n_dst);
+        std::size_t n_edges = 0;
+        for (std::size_t i = 0; i < n_src; ++i)
+        {
+          const auto n = filterEdges(kernel, &from[i * dof], targets.data(), n_dst, n_dst, dof, max_delta.data(),
+                                     indices.data(), costs.data());
+          ASSERT_EQ(expected.result()[i].size(), n) << toString(kernel) << ", " << dof << " dof, source " << i;
+          for (std::size_t e = 0; e < n; ++e, ++n_edges)
+          {
+            EXPECT_EQ(expected_edges[n_edges].idx, indices[e]);
+            // NaN costs compare unequal, check their bits instead
+            EXPECT_EQ(0, std::memcmp(&expected_edges[n_edges].cost, &costs[e], sizeof(double)));
+          }
+        }
+        EXPECT_GT(n_edges, 0u);
+      }
+
+      // And through the builder
+      DefaultEdgesWithTime builder(n_src, n_dst, dof, 1.2, vel_limits);
+      buildEdges(builder, from, to, dof);
+      EXPECT_EQ(expected.result().offsets(), builder.result().offsets());
+      EXPECT_EQ(0, std::memcmp(expected_edges.data(), builder.result().edges().data(),
+                               expected_edges.size() * sizeof(Edge)));
+    }
+  }
+}
+
+TEST(LadderGraph, joint_index_edges_match_builder)
+{
+  std::mt19937 rng(21);
+  const std::size_t dof = 6;
+  const std::size_t n_src = 50, n_dst = 1000;
+  const std::vector<double> vel_limits(dof, 1.0);
+
+  // Joints spread 20 times wider than the limit of 0.1, and one of them not at all
+  std::uniform_real_distribution<double> joint_dist(-1.0, 1.0);
+  std::vector<double> from(n_src * dof), to(n_dst * dof);
+  for (std::size_t i = 0; i < from.size(); ++i)
+    from[i] = i % dof == 2 ? 0.5 : joint_dist(rng);
+  for (std::size_t i = 0; i < to.size(); ++i)
+    to[i] = i % dof == 2 ? 0.5 : joint_dist(rng);
+
+  // Targets at the limit of a source, which the rounding of the distance may put on either side of it
+  for (std::size_t k = 0; k < dof; ++k)
+  {
+    to[k] = from[k] + 0.1;
+    to[dof + k] = from[k] - 0.1;
+  }
+  // A NaN source passes every limit test, as in the scalar builder
+  std::fill(from.begin() + dof, from.begin() + 2 * dof, std::numeric_limits<double>::quiet_NaN());
+
+  SortedJointIndex index;
+  const std::vector<double> max_delta(dof, 0.1);
+  ASSERT_TRUE(index.build(to.data(), n_dst, dof, max_delta.data()));
+  EXPECT_LT(index.candidateFraction(), 0.2);
+  EXPECT_NE(2u, index.sortedJoint());
+
+  DefaultEdgesWithTime expected(n_src, n_dst, dof, 0.1, vel_limits);
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    for (std::size_t j = 0; j < n_dst; ++j)
+      expected.consider(&from[i * dof], &to[j * dof], j);
+    expected.next(i);
+  }
+
+  // The same edges, though ordered by the sorted joint within each vertex
+  DefaultEdgesWithTime builder(n_src, n_dst, dof, 0.1, vel_limits);
+  buildEdges(builder, from, to, dof);
+  ASSERT_EQ(expected.result().offsets(), builder.result().offsets());
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    std::vector<Edge> edges(builder.result()[i].begin(), builder.result()[i].end());
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.idx < b.idx; });
+    ASSERT_EQ(expected.result()[i].size(), edges.size()) << "source " << i;
+    for (std::size_t e = 0; e < edges.size(); ++e)
+    {
+      EXPECT_EQ(expected.result()[i].begin()[e].idx, edges[e].idx) << "source " << i;
+      // NaN costs compare unequal, check their bits instead
+      EXPECT_EQ(0, std::memcmp(&expected.result()[i].begin()[e].cost, &edges[e].cost, sizeof(double)))
+          << "source " << i;
+    }
+  }
+  EXPECT_EQ(n_dst, builder.result()[1].size());
+
+  // A rung that spans less than the limit isn't worth indexing
+  std::vector<double> narrow(n_dst * dof, 0.0);
+  EXPECT_FALSE(index.build(narrow.data(), n_dst, dof, max_delta.data()));
+}
+
+// Weighted joint distance with a penalty for flipping the wrist, per edge and per block
+static double wristFlipCost(const double* a, const double* b)
+{
+  double cost = 0.0;
+  for (int i = 0; i < 6; ++i)
+    cost += (i < 3 ? 2.0 : 1.0) * std::abs(a[i] - b[i]);
+  return std::abs(a[4] - b[4]) > 0.5 ? cost + 10.0 : cost;
+}
+
+static void wristFlipBatchCost(const double* start, const double* end_joints, std::size_t n_end, double* costs)
+{
+  for (std::size_t j = 0; j < n_end; ++j)
+    costs[j] = wristFlipCost(start, end_joints + j * 6);
+}
+
+// The (target, cost) pairs of each vertex sorted by target, as the index may order them by joint
+static std::vector<std::vector<std::pair<unsigned, double>>> sortedEdges(const RungEdges& edges)
+{
+  std::vector<std::vector<std::pair<unsigned, double>>> rows(edges.numVertices());
+  for (std::size_t i = 0; i < edges.numVertices(); ++i)
+  {
+    for (const auto& e : edges[i])
+      rows[i].emplace_back(e.idx, e.cost);
+    std::sort(rows[i].begin(), rows[i].end());
+  }
+  return rows;
+}
+
+TEST(LadderGraph, batch_cost_edges_match_scalar)
+{
+  std::mt19937 rng(5);
+  const std::size_t dof = 6;
+  const std::vector<double> vel_limits(dof, 1.0);
+  const BatchCostFunction scalar = toBatchCostFunction(wristFlipCost, dof);
+  const BatchCostFunction batch(wristFlipBatchCost);
+
+  // A small rung is filtered a row at a time, a large one spread out on its first joints goes through the joint
+  // index. The rest of the joints are close enough together for some edges to pass the limit of 0.1.
+  std::uniform_real_distribution<double> wide_dist(-1.0, 1.0), narrow_dist(-0.06, 0.06);
+  for (std::size_t n_dst : {37u, 1000u})
+  {
+    const std::size_t n_src = 40;
+    std::vector<double> from(n_src * dof), to(n_dst * dof);
+    for (std::size_t i = 0; i < from.size(); ++i)
+      from[i] = i % dof < 2 ? wide_dist(rng) : narrow_dist(rng);
+    for (std::size_t i = 0; i < to.size(); ++i)
+      to[i] = i % dof < 2 ? wide_dist(rng) : narrow_dist(rng);
+
+    SortedJointIndex index;
+    const std::vector<double> max_delta(dof, 0.1);
+    EXPECT_EQ(n_dst >= 1000, index.build(to.data(), n_dst, dof, max_delta.data()));
+
+    CustomEdgesWithTime expected(n_src, n_dst, dof, 0.1, vel_limits, scalar);
+    CustomEdgesWithTime timed(n_src, n_dst, dof, 0.1, vel_limits, batch);
+    CustomEdgesWithoutTime expected_untimed(n_src, n_dst, dof, scalar);
+    CustomEdgesWithoutTime untimed(n_src, n_dst, dof, batch);
+    for (std::size_t i = 0; i < n_src; ++i)
+    {
+      for (std::size_t j = 0; j < n_dst; ++j)
+      {
+        expected.consider(&from[i * dof], &to[j * dof], j);
+        expected_untimed.consider(&from[i * dof], &to[j * dof], j);
+      }
+      expected.next(i);
+      expected_untimed.next(i);
+    }
+    buildEdges(timed, from, to, dof);
+    buildEdges(untimed, from, to, dof);
+
+    ASSERT_FALSE(expected.result().empty());
+    EXPECT_EQ(expected.result().offsets(), timed.result().offsets()) << n_dst;
+    EXPECT_TRUE(sortedEdges(expected.result()) == sortedEdges(timed.result())) << n_dst;
+    EXPECT_TRUE(sortedEdges(expected_untimed.result()) == sortedEdges(untimed.result())) << n_dst;
+  }
+}
+
+// Builds the edges of every vertex pair with 'builder'
+template <typename Builder>
+static RungEdges pairwiseEdges(Builder builder, const std::vector<double>& from, const std::vector<double>& to,
+                               std::size_t dof)
+{
+  buildEdges(builder, from, to, dof);
+  return std::move(builder.result());
+}
+
+static bool sameEdges(const RungEdges& a, const RungEdges& b)
+{
+  return a.offsets() == b.offsets() && a.edges().size() == b.edges().size() &&
+         (a.edges().empty() || std::memcmp(a.edges().data(), b.edges().data(), a.edges().size() * sizeof(Edge)) == 0);
+}
+
+TEST(LadderGraph, fixed_dof_builders_match_dynamic)
+{
+  std::mt19937 rng(13);
+  const std::size_t dof = 6;
+  const std::size_t n_src = 30, n_dst = 40;
+  const std::vector<double> vel_limits(dof, 1.0);
+  const BatchCostFunction batch(wristFlipBatchCost);
+
+  std::uniform_real_distribution<double> joint_dist(-0.2, 0.2);
+  std::vector<double> from(n_src * dof), to(n_dst * dof);
+  for (auto& j : from) j = joint_dist(rng);
+  for (auto& j : to) j = joint_dist(rng);
+
+  typedef FixedDof<6> Six;
+  typedef void (*WristFlipBatch)(const double*, const double*, std::size_t, double*);
+
+  const auto expected = pairwiseEdges(DefaultEdgesWithoutTime(n_src, n_dst, dof), from, to, dof);
+  EXPECT_TRUE(sameEdges(expected, pairwiseEdges(BasicDefaultEdgesWithoutTime<RungEdges, Six>(n_src, n_dst, dof),
+                                                from, to, dof)));
+
+  const auto expected_timed = pairwiseEdges(DefaultEdgesWithTime(n_src, n_dst, dof, 0.2, vel_limits), from, to, dof);
+  ASSERT_FALSE(expected_timed.empty());
+  EXPECT_TRUE(sameEdges(expected_timed,
+                        pairwiseEdges(BasicDefaultEdgesWithTime<RungEdges, Six>(n_src, n_dst, dof, 0.2, vel_limits),
+                                      from, to, dof)));
+
+  // A cost functor of its own type, rather than a BatchCostFunction, gives the same costs
+  const auto expected_custom = pairwiseEdges(CustomEdgesWithoutTime(n_src, n_dst, dof, batch), from, to, dof);
+  EXPECT_TRUE(sameEdges(expected_custom,
+                        pairwiseEdges(BasicCustomEdgesWithoutTime<RungEdges, Six, WristFlipBatch>(
+                                          n_src, n_dst, dof, wristFlipBatchCost), from, to, dof)));
+
+  const auto expected_custom_timed =
+      pairwiseEdges(CustomEdgesWithTime(n_src, n_dst, dof, 0.2, vel_limits, batch), from, to, dof);
+  EXPECT_TRUE(sameEdges(expected_custom_timed,
+                        pairwiseEdges(BasicCustomEdgesWithTime<RungEdges, Six, WristFlipBatch>(
+                                          n_src, n_dst, dof, 0.2, vel_limits, wristFlipBatchCost), from, to, dof)));
+}
+
+namespace
+{
+struct SkipEveryThird
+{
+  bool operator()(std::size_t i) const { return i % 3 == 1; }
+};
+}
+
+TEST(LadderGraph, tiled_edges_match_pairwise)
+{
+  std::mt19937 rng(17);
+  const std::size_t dof = 6;
+  const std::size_t n_src = 21, n_dst = 1500; // a partial tile of sources, several blocks of targets
+  const std::vector<double> vel_limits(dof, 1.0);
+
+  // Close enough together that the rung isn't worth indexing and a good share of the pairs connect
+  std::uniform_real_distribution<double> joint_dist(-0.1, 0.1);
+  std::vector<double> from(n_src * dof), to(n_dst * dof);
+  for (auto& j : from) j = joint_dist(rng);
+  for (auto& j : to) j = joint_dist(rng);
+
+  SortedJointIndex index;
+  const std::vector<double> max_delta(dof, 0.15);
+  ASSERT_FALSE(index.build(to.data(), n_dst, dof, max_delta.data()));
+
+  DefaultEdgesWithTime expected(n_src, n_dst, dof, 0.15, vel_limits);
+  CustomEdgesWithTime expected_custom(n_src, n_dst, dof, 0.15, vel_limits, BatchCostFunction(wristFlipBatchCost));
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    if (!SkipEveryThird()(i))
+    {
+      for (std::size_t j = 0; j < n_dst; ++j)
+      {
+        expected.consider(&from[i * dof], &to[j * dof], j);
+        expected_custom.consider(&from[i * dof], &to[j * dof], j);
+      }
+    }
+    expected.next(i);
+    expected_custom.next(i);
+  }
+
+  DefaultEdgesWithTime tiled(n_src, n_dst, dof, 0.15, vel_limits);
+  buildEdges(tiled, from, to, dof, SkipEveryThird());
+  ASSERT_FALSE(expected.result().empty());
+  EXPECT_TRUE(sameEdges(expected.result(), tiled.result()));
+
+  CustomEdgesWithTime tiled_custom(n_src, n_dst, dof, 0.15, vel_limits, BatchCostFunction(wristFlipBatchCost));
+  buildEdges(tiled_custom, from, to, dof, SkipEveryThird());
+  EXPECT_TRUE(sameEdges(expected_custom.result(), tiled_custom.result()));
+}
+
+static void l1BatchCost(const double* start, const double* end_joints, std::size_t n_end, double* costs)
+{
+  for (std::size_t j = 0; j < n_end; ++j)
+  {
+    costs[j] = 0.0;
+    for (std::size_t k = 0; k < 6; ++k)
+      costs[j] += std::abs(start[k] - end_joints[j * 6 + k]);
+  }
+}
+
+TEST(LadderGraph, top_k_edges_keep_cheapest_and_incoming)
+{
+  std::mt19937 rng(19);
+  const std::size_t dof = 6;
+  const std::size_t n_src = 20, n_dst = 50, k = 3;
+
+  std::uniform_real_distribution<double> joint_dist(-1.0, 1.0);
+  std::vector<double> from(n_src * dof), to(n_dst * dof);
+  for (auto& j : from) j = joint_dist(rng);
+  for (auto& j : to) j = joint_dist(rng);
+
+  const auto full = pairwiseEdges(DefaultEdgesWithoutTime(n_src, n_dst, dof), from, to, dof);
+  const auto capped = pairwiseEdges(DefaultEdgesWithoutTime(n_src, n_dst, dof, k), from, to, dof);
+  EXPECT_EQ(0u, capped.denseTargets());
+  EXPECT_GE(n_src * k + n_dst, capped.numEdges());
+  EXPECT_LT(n_src * k, capped.numEdges()); // some targets need a guard
+  ASSERT_EQ(n_src, capped.numVertices());
+
+  // The first k edges of each vertex are its k cheapest; any others are guards for targets no kept edge reaches
+  std::vector<int> kept_into(n_dst, 0);
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    std::vector<Edge> row(full[i].begin(), full[i].end());
+    std::sort(row.begin(), row.end(), [](const Edge& a, const Edge& b) {
+      return a.cost < b.cost || (a.cost == b.cost && a.idx < b.idx);
+    });
+    std::vector<unsigned> expected, kept;
+    for (std::size_t e = 0; e < k; ++e)
+      expected.push_back(row[e].idx);
+    ASSERT_LE(k, capped[i].size());
+    for (std::size_t e = 0; e < k; ++e)
+      kept.push_back(capped[i].begin()[e].idx);
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, kept) << "vertex " << i;
+    for (auto j : kept)
+      ++kept_into[j];
+  }
+
+  std::vector<int> incoming(n_dst, 0);
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    for (std::size_t e = 0; e < capped[i].size(); ++e)
+    {
+      const auto& edge = capped[i].begin()[e];
+      ++incoming[edge.idx];
+      if (e < k) continue;
+
+      EXPECT_EQ(0, kept_into[edge.idx]) << "guard into " << edge.idx;
+      double cheapest = std::numeric_limits<double>::max();
+      for (std::size_t s = 0; s < n_src; ++s)
+        cheapest = std::min(cheapest, full[s].begin()[edge.idx].cost);
+      EXPECT_EQ(cheapest, edge.cost);
+    }
+  }
+  for (std::size_t j = 0; j < n_dst; ++j)
+    EXPECT_LT(0, incoming[j]) << "target " << j;
+
+  // A batch cost computing the same distances caps the same way
+  const auto custom =
+      pairwiseEdges(CustomEdgesWithoutTime(n_src, n_dst, dof, BatchCostFunction(l1BatchCost), k), from, to, dof);
+  EXPECT_TRUE(sameEdges(capped, custom));
+
+  // Relaxing the capped edges on the fly, guards included, matches relaxing the stored ones
+  std::uniform_real_distribution<double> distance_dist(0.0, 10.0);
+  std::vector<double> src_distance(n_src);
+  for (auto& d : src_distance) d = distance_dist(rng);
+
+  std::vector<double> expected_distance(n_dst, std::numeric_limits<double>::max());
+  for (std::size_t i = 0; i < n_src; ++i)
+  {
+    for (const auto& edge : capped[i])
+      expected_distance[edge.idx] = std::min(expected_distance[edge.idx], src_distance[i] + edge.cost);
+  }
+
+  BasicDefaultEdgesWithoutTime<RelaxingSink> relaxing(n_src, n_dst, dof, k);
+  std::vector<double> distance(n_dst, std::numeric_limits<double>::max());
+  std::vector<unsigned> predecessor(n_dst, 0);
+  relaxing.result().attach(src_distance.data(), distance.data(), predecessor.data());
+  buildEdges(relaxing, from, to, dof);
+  EXPECT_EQ(capped.numEdges(), relaxing.result().numEdges());
+  EXPECT_EQ(expected_distance, distance);
+}
+
+TEST(LadderGraph, dag_search_dense_matches_sparse)
+{
+  std::mt19937 rng(7);
+  const std::size_t n_rungs = 6;
+  const std::size_t n_vertices = 21;
+
+  LadderGraph dense(1), sparse(1);
+  dense.resize(n_rungs);
+  sparse.resize(n_rungs);
+  for (std::size_t r = 0; r < n_rungs; ++r)
+  {
+    dense.getRung(r).data.assign(n_vertices, 0.0);
+    sparse.getRung(r).data.assign(n_vertices, 0.0);
+    dense.getEdges(r).resize(n_vertices);
+    sparse.getEdges(r).resize(n_vertices);
+  }
+
+  for (std::size_t r = 0; r + 1 < n_rungs; ++r)
+  {
+    auto edges = makeDenseEdges(n_vertices, n_vertices, rng);
+    RungEdges copy = edges;
+    copy.setDenseTargets(0); // forces the scatter path
+    dense.assignEdges(r, std::move(edges));
+    sparse.assignEdges(r, std::move(copy));
+  }
+
+  DAGSearch dense_search(dense), sparse_search(sparse);
+  EXPECT_EQ(sparse_search.run(), dense_search.run());
+  EXPECT_EQ(sparse_search.shortestPath(), dense_search.shortestPath());
+}
+
+// Assigns random sparse edges of integer cost between rungs 'r' and 'r + 1', so sums are exact and ties common
+static void makeRandomEdges(LadderGraph& graph, std::size_t r, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> cost_dist(0, 3);
+  std::bernoulli_distribution keep_dist(0.7);
+
+  RungEdges edges;
+  for (std::size_t i = 0; i < graph.rungSize(r); ++i)
+  {
+    for (std::size_t j = 0; j < graph.rungSize(r + 1); ++j)
+    {
+      if (keep_dist(rng)) edges.push_back({static_cast<double>(cost_dist(rng)), static_cast<unsigned>(j)});
+    }
+    edges.closeVertex();
+  }
+  graph.assignEdges(r, std::move(edges));
+}
+
+static void makeRandomRung(LadderGraph& graph, std::size_t r, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> size_dist(1, 9);
+  graph.getRung(r).data.assign(size_dist(rng), 0.0);
+  graph.getEdges(r).resize(graph.rungSize(r));
+}
+
+// Builds a ladder with rungs of varying width and random sparse edges
+static void makeRandomLadder(LadderGraph& graph, std::size_t n_rungs, std::mt19937& rng)
+{
+  graph.resize(n_rungs);
+  for (std::size_t r = 0; r < n_rungs; ++r)
+    makeRandomRung(graph, r, rng);
+
+  for (std::size_t r = 0; r + 1 < n_rungs; ++r)
+    makeRandomEdges(graph, r, rng);
+}
+
+TEST(LadderGraph, parallel_search_matches_sequential)
+{
+  std::mt19937 rng(3);
+  const std::size_t rung_counts[] = {2, 9, 50, 333};
+  const unsigned thread_counts[] = {1, 2, 3, 8, 64};
+
+  for (auto n_rungs : rung_counts)
+  {
+    LadderGraph graph(1);
+    makeRandomLadder(graph, n_rungs, rng);
+
+    DAGSearch sequential(graph);
+    const double expected_cost = sequential.run();
+    const auto expected_path = sequential.shortestPath();
+
+    for (auto n_threads : thread_counts)
+    {
+      DAGSearch parallel(graph);
+      EXPECT_EQ(expected_cost, parallel.runParallel(n_threads)) << n_rungs << " rungs, " << n_threads << " threads";
+      if (expected_cost != std::numeric_limits<double>::max())
+      {
+        EXPECT_EQ(expected_path, parallel.shortestPath()) << n_rungs << " rungs, " << n_threads << " threads";
+      }
+    }
+  }
+}
+
+// Sums the edge costs along 'path', or returns -1 if it uses an edge that doesn't exist
+static double pathCost(const LadderGraph& graph, const std::vector<unsigned>& path)
+{
+  double cost = 0.0;
+  for (std::size_t r = 0; r + 1 < path.size(); ++r)
+  {
+    const auto edges = graph.getEdges(r)[path[r]];
+    auto it = std::find_if(edges.begin(), edges.end(), [&](const Edge& e) { return e.idx == path[r + 1]; });
+    if (it == edges.end()) return -1.0;
+    cost += it->cost;
+  }
+  return cost;
+}
+
+TEST(LadderGraph, incremental_search_tracks_edits)
+{
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> edit_dist(0, 2);
+  std::normal_distribution<double> step_dist(0.0, 3.0);
+
+  const std::size_t n_rungs = 400;
+  LadderGraph graph(1);
+  makeRandomLadder(graph, n_rungs, rng);
+
+  IncrementalDAGSearch search(graph);
+  std::size_t max_relaxed = 0;
+  double location = n_rungs / 2;
+
+  for (int iteration = 0; iteration < 200; ++iteration)
+  {
+    const double cost = search.run();
+    DAGSearch reference(graph);
+    ASSERT_EQ(reference.run(), cost) << "iteration " << iteration;
+    if (cost != std::numeric_limits<double>::max())
+    {
+      EXPECT_EQ(cost, pathCost(graph, search.shortestPath())) << "iteration " << iteration;
+    }
+    if (iteration > 1) max_relaxed = std::max(max_relaxed, search.relaxedRungs());
+
+    // Edits drift along the ladder, like the points a sparse planner inserts
+    location = std::min(std::max(location + step_dist(rng), 1.0), graph.size() - 2.0);
+    const auto r = static_cast<std::size_t>(location);
+    switch (edit_dist(rng))
+    {
+      case 0:
+        makeRandomRung(graph, r, rng);
+        makeRandomEdges(graph, r - 1, rng);
+        makeRandomEdges(graph, r, rng);
+        search.rungModified(r);
+        break;
+      case 1:
+        graph.insertRung(r);
+        makeRandomRung(graph, r, rng);
+        makeRandomEdges(graph, r - 1, rng);
+        makeRandomEdges(graph, r, rng);
+        search.rungInserted(r);
+        break;
+      default:
+        graph.removeRung(r);
+        makeRandomEdges(graph, r - 1, rng);
+        search.rungRemoved(r);
+        break;
+    }
+  }
+
+  // Replanning after a local edit only touches the rungs around it
+  EXPECT_LT(max_relaxed, n_rungs / 4);
+}
+
+TEST(LadderGraph, incremental_search_edits_at_ends)
+{
+  std::mt19937 rng(5);
+  LadderGraph graph(1);
+  makeRandomLadder(graph, 50, rng);
+
+  IncrementalDAGSearch search(graph);
+  search.run();
+
+  graph.removeRung(graph.size() - 1);
+  search.rungRemoved(graph.size());
+  EXPECT_EQ(DAGSearch(graph).run(), search.run());
+
+  graph.removeRung(0);
+  search.rungRemoved(0);
+  EXPECT_EQ(DAGSearch(graph).run(), search.run());
+
+  graph.insertRung(0);
+  makeRandomRung(graph, 0, rng);
+  makeRandomEdges(graph, 0, rng);
+  search.rungInserted(0);
+  EXPECT_EQ(DAGSearch(graph).run(), search.run());
+  EXPECT_LE(search.relaxedRungs(), 2u); // next to the previous edit
+
+  // Shape changes the search wasn't told about trigger a full search
+  graph.resize(30);
+  graph.getEdges(29).resize(graph.rungSize(29));
+  EXPECT_EQ(DAGSearch(graph).run(), search.run());
+}
+
+TEST(LadderGraph, incremental_search_cancellation)
+{
+  std::mt19937 rng(7);
+  LadderGraph graph(1);
+  makeRandomLadder(graph, 50, rng);
+
+  IncrementalDAGSearch search(graph);
+  CancellationToken cancel;
+  cancel.cancel();
+  EXPECT_EQ(std::numeric_limits<double>::max(), search.run(&cancel));
+  EXPECT_EQ(0u, search.relaxedRungs());
+
+  // A later run picks up where the cancelled one stopped
+  EXPECT_EQ(DAGSearch(graph).run(), search.run());
+  CancellationToken expired (CancellationToken::Clock::now());
+  EXPECT_EQ(DAGSearch(graph).run(), search.run(&expired)); // nothing left to relax
+}
+
+TEST(LadderGraph, index_of_tracks_edits)
+{
+  using descartes_core::TrajectoryID;
+
+  std::mt19937 rng(17);
+  std::uniform_int_distribution<int> edit_dist(0, 3);
+  const std::vector<std::vector<double>> sols (1, std::vector<double>(1, 0.0));
+
+  LadderGraph graph(1);
+  std::vector<TrajectoryID> ids; // what the graph should hold
+  graph.resize(100);
+  for (std::size_t r = 0; r < graph.size(); ++r)
+  {
+    ids.push_back(TrajectoryID::make_id());
+    graph.assignRung(r, ids.back(), descartes_core::TimingConstraint(), sols);
+  }
+
+  auto expected = [&ids](TrajectoryID id)
+  {
+    return std::distance(ids.begin(), std::find(ids.begin(), ids.end(), id));
+  };
+
+  for (int iteration = 0; iteration < 500; ++iteration)
+  {
+    const auto r = std::uniform_int_distribution<std::size_t>(0, ids.size() - 1)(rng);
+    int edit = edit_dist(rng);
+    if (edit == 2 && ids.size() < 50) edit = 1;
+
+    switch (edit)
+    {
+      case 0:
+        ids[r] = TrajectoryID::make_id();
+        graph.assignRung(r, ids[r], descartes_core::TimingConstraint(), sols);
+        break;
+      case 1:
+        graph.insertRung(r);
+        ids.insert(ids.begin() + r, TrajectoryID::make_id());
+        graph.assignRung(r, ids[r], descartes_core::TimingConstraint(), sols);
+        break;
+      case 2:
+        graph.removeRung(r);
+        ids.erase(ids.begin() + r);
+        break;
+      default:
+        // Duplicates resolve to the first rung
+        ids[r] = ids[std::uniform_int_distribution<std::size_t>(0, ids.size() - 1)(rng)];
+        graph.assignRung(r, ids[r], descartes_core::TimingConstraint(), sols);
+        break;
+    }
+
+    // Look up a few points, without always touching the edited one
+    for (int i = 0; i < 3; ++i)
+    {
+      const auto id = ids[std::uniform_int_distribution<std::size_t>(0, ids.size() - 1)(rng)];
+      const auto found = graph.indexOf(id);
+      ASSERT_TRUE(found.second) << "iteration " << iteration;
+      ASSERT_EQ(expected(id), found.first) << "iteration " << iteration;
+    }
+  }
+
+  EXPECT_FALSE(graph.indexOf(TrajectoryID::make_id()).second);
+  EXPECT_FALSE(graph.indexOf(TrajectoryID::make_nil()).second);
+
+  graph.clear();
+  EXPECT_FALSE(graph.indexOf(ids.front()).second);
+}
+
+TEST(LadderGraph, rung_sequence_edits)
+{
+  std::mt19937 rng(23);
+  std::uniform_int_distribution<int> edit_dist(0, 9);
+
+  RungSequence rungs;
+  std::vector<const Rung*> expected; // the address of each rung, which must not change
+  rungs.resize(20);
+  for (std::size_t i = 0; i < rungs.size(); ++i)
+    expected.push_back(&rungs[i]);
+
+  for (int iteration = 0; iteration < 2000; ++iteration)
+  {
+    const int edit = edit_dist(rng);
+    if (edit < 5)
+    {
+      const auto r = std::uniform_int_distribution<std::size_t>(0, expected.size())(rng);
+      rungs.insert(r);
+      expected.insert(expected.begin() + r, &rungs[r]);
+    }
+    else if (edit < 9 && !expected.empty())
+    {
+      const auto r = std::uniform_int_distribution<std::size_t>(0, expected.size() - 1)(rng);
+      rungs.erase(r);
+      expected.erase(expected.begin() + r);
+    }
+    else
+    {
+      const auto n = std::uniform_int_distribution<std::size_t>(0, expected.size() + 10)(rng);
+      const auto old_size = expected.size();
+      rungs.resize(n);
+      expected.resize(n);
+      for (std::size_t i = old_size; i < n; ++i)
+        expected[i] = &rungs[i];
+    }
+
+    ASSERT_EQ(expected.size(), rungs.size()) << "iteration " << iteration;
+    for (std::size_t i = 0; i < expected.size(); ++i)
+      ASSERT_EQ(expected[i], &rungs[i]) << "iteration " << iteration << ", rung " << i;
+  }
+
+  // Copies are deep
+  rungs.resize(3);
+  rungs[1].data.assign(2, 1.0);
+  RungSequence copy (rungs);
+  ASSERT_EQ(3u, copy.size());
+  EXPECT_NE(&rungs[1], &copy[1]);
+  EXPECT_EQ(rungs[1].data, copy[1].data);
+
+  RungSequence moved (std::move(copy));
+  EXPECT_EQ(3u, moved.size());
+  EXPECT_EQ(0u, copy.size());
+}
+
+TEST(LadderGraph, compact_index_store_widths)
+{
+  const std::size_t ranges[] = {1, 256, 257, 65536, 65537, 1u << 20};
+  CompactIndexStore store;
+  std::vector<std::vector<unsigned>> rows;
+
+  std::mt19937 rng(13);
+  for (auto range : ranges)
+  {
+    std::uniform_int_distribution<unsigned> index_dist(0, range - 1);
+    std::vector<unsigned> row(11);
+    for (auto& i : row)
+      i = index_dist(rng);
+    row.back() = range - 1;
+    store.append(row.data(), row.size(), range);
+    rows.push_back(row);
+  }
+
+  ASSERT_EQ(rows.size(), store.size());
+  for (std::size_t r = 0; r < rows.size(); ++r)
+  {
+    for (std::size_t i = 0; i < rows[r].size(); ++i)
+      EXPECT_EQ(rows[r][i], store.get(r, i)) << "row " << r << ", index " << i;
+  }
+
+  store.clear();
+  EXPECT_EQ(0u, store.size());
+}
+
+namespace
+{
+// Produces rungs of random joint solutions that are the same on every call for a given rung
+struct RandomRungs
+{
+  std::size_t dof;
+  unsigned seed;
+  bool timed;
+
+  bool operator()(std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing) const
+  {
+    std::mt19937 rng(seed + index);
+    std::uniform_int_distribution<std::size_t> size_dist(1, 12);
+    std::uniform_real_distribution<double> joint_dist(-1.0, 1.0);
+
+    joints.resize(size_dist(rng) * dof);
+    for (auto& j : joints)
+      j = joint_dist(rng);
+    timing = descartes_core::TimingConstraint(timed && index % 2 ? 1.9 : 0.0);
+    return true;
+  }
+};
+
+// Fills the edges out of rung 'r' of a stored ladder with whichever builder withEdgeBuilder() picks
+struct EdgeFiller
+{
+  LadderGraph& graph;
+  std::size_t r;
+
+  template <typename Builder>
+  void operator()(Builder& builder) const
+  {
+    const auto dof = graph.dof();
+    const auto& from = graph.getRung(r).data;
+    const auto& to = graph.getRung(r + 1).data;
+    for (std::size_t i = 0; i < graph.rungSize(r); ++i)
+    {
+      for (std::size_t j = 0; j < graph.rungSize(r + 1); ++j)
+        builder.consider(&from[i * dof], &to[j * dof], j);
+      builder.next(i);
+    }
+    graph.assignEdges(r, std::move(builder.result()));
+  }
+};
+}
+
+TEST(LadderGraph, streaming_solver_matches_stored_ladder)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(6, 1.0)));
+  const std::size_t dof = robot->getDOF();
+  const std::size_t n_rungs = 60;
+
+  for (bool timed : {false, true})
+  {
+    RandomRungs producer{dof, 17, timed};
+
+    // Reference: store every rung and edge, then search
+    LadderGraph graph(dof);
+    graph.resize(n_rungs);
+    for (std::size_t r = 0; r < n_rungs; ++r)
+    {
+      auto& rung = graph.getRung(r);
+      producer(r, rung.data, rung.timing);
+      graph.getEdges(r).resize(graph.rungSize(r));
+    }
+    for (std::size_t r = 0; r + 1 < n_rungs; ++r)
+    {
+      withEdgeBuilder<RungEdges>(graph.rungSize(r), graph.rungSize(r + 1), dof, graph.getRung(r + 1).timing,
+                                 robot->getJointVelocityLimits(), BatchCostFunction{}, EdgeFiller{graph, r});
+    }
+
+    DAGSearch search(graph);
+    const double expected_cost = search.run();
+    ASSERT_NE(std::numeric_limits<double>::max(), expected_cost) << (timed ? "timed" : "untimed");
+
+    StreamingLadderSolver solver(robot);
+    double cost;
+    std::list<descartes_trajectory::JointTrajectoryPt> path;
+    ASSERT_TRUE(solver.solve(n_rungs, producer, cost, path)) << (timed ? "timed" : "untimed");
+    EXPECT_EQ(expected_cost, cost) << (timed ? "timed" : "untimed");
+    ASSERT_EQ(n_rungs, path.size());
+    EXPECT_LT(0u, solver.predecessorMemory());
+
+    // The recovered joints are those of a path of the same cost through the stored ladder
+    const auto expected_path = search.shortestPath();
+    std::size_t r = 0;
+    for (const auto& pt : path)
+    {
+      std::vector<double> joints;
+      pt.getNominalJointPose(std::vector<double>(), *robot, joints);
+      const auto* data = graph.vertex(r, expected_path[r]);
+      EXPECT_EQ(std::vector<double>(data, data + dof), joints) << "rung " << r;
+      ++r;
+    }
+  }
+}
+
+TEST(LadderGraph, streaming_solver_failures)
+{
+  descartes_core::RobotModelConstPtr robot(
+      new descartes_tests::CartesianRobot(5.0, 0.001, std::vector<double>(6, 1.0)));
+  RandomRungs random{6, 3, false};
+  StreamingLadderSolver solver(robot);
+  double cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> path;
+
+  // A rung without solutions
+  auto with_gap = [&](std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing) {
+    return index != 4 && random(index, joints, timing);
+  };
+  EXPECT_FALSE(solver.solve(10, with_gap, cost, path));
+
+  // A producer that changes its solutions between the two passes
+  int calls = 0;
+  auto changing = [&](std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing) {
+    random(index, joints, timing);
+    if (++calls > 10) joints.resize(0);
+    return true;
+  };
+  EXPECT_FALSE(solver.solve(10, changing, cost, path));
+  EXPECT_TRUE(path.empty());
+
+  // Or that gives a rung more of them, though the chosen index is still in range
+  calls = 0;
+  auto growing = [&](std::size_t index, std::vector<double>& joints, descartes_core::TimingConstraint& timing) {
+    random(index, joints, timing);
+    if (++calls > 10 && index == 5)
+    {
+      const std::vector<double> first (joints.begin(), joints.begin() + 6);
+      joints.insert(joints.end(), first.begin(), first.end());
+    }
+    return true;
+  };
+  EXPECT_FALSE(solver.solve(10, growing, cost, path));
+  EXPECT_TRUE(path.empty());
+}
+
+TEST(LadderGraph, prune_rung)
+{
+  const double inf = std::numeric_limits<double>::max();
+  BeamParameters beam;
+  beam.width = 3;
+
+  std::vector<double> distance = {5.0, inf, 2.0, 4.0, 2.0, 4.0, 7.0};
+  EXPECT_EQ(3u, pruneRung(distance, beam));
+  EXPECT_EQ((std::vector<double>{inf, inf, 2.0, 4.0, 2.0, inf, inf}), distance); // lowest index wins the tie
+
+  beam.width = 0;
+  beam.cost_ratio = 1.5;
+  distance = {5.0, inf, 2.0, 3.0, 3.5};
+  EXPECT_EQ(2u, pruneRung(distance, beam));
+  EXPECT_EQ((std::vector<double>{inf, inf, 2.0, 3.0, inf}), distance);
+
+  beam.width = 10;
+  distance = {0.0, 0.0, 1.0}; // the ratio doesn't apply to a zero cost rung
+  EXPECT_EQ(0u, pruneRung(distance, beam));
+}
+
+TEST(LadderGraph, beam_search_bounds)
+{
+  std::mt19937 rng(23);
+  const std::size_t n_rungs = 200;
+  const std::size_t n_vertices = 9;
+
+  LadderGraph graph(1);
+  graph.resize(n_rungs);
+  for (std::size_t r = 0; r < n_rungs; ++r)
+  {
+    graph.getRung(r).data.assign(n_vertices, 0.0);
+    graph.getEdges(r).resize(n_vertices);
+  }
+  for (std::size_t r = 0; r + 1 < n_rungs; ++r)
+    graph.assignEdges(r, makeDenseEdges(n_vertices, n_vertices, rng));
+
+  DAGSearch exact(graph);
+  const double exact_cost = exact.run();
+  ASSERT_NE(std::numeric_limits<double>::max(), exact_cost);
+
+  // Wide enough to keep every vertex
+  BeamParameters wide;
+  wide.width = n_vertices;
+  BeamDAGSearch wide_search(graph, wide);
+  EXPECT_EQ(exact_cost, wide_search.run());
+  EXPECT_EQ(0u, wide_search.prunedVertices());
+
+  // A narrow beam finds a valid path that is no cheaper than the shortest
+  const std::size_t widths[] = {1, 2, 4};
+  for (auto width : widths)
+  {
+    BeamParameters beam;
+    beam.width = width;
+    BeamDAGSearch search(graph, beam);
+    const double cost = search.run();
+    EXPECT_LT(0u, search.prunedVertices()) << "width " << width;
+    EXPECT_LE(exact_cost, cost) << "width " << width;
+    EXPECT_EQ(cost, pathCost(graph, search.shortestPath())) << "width " << width;
+  }
+}
+
+// Lists the cost of every complete path through 'graph'
+static void enumeratePaths(const LadderGraph& graph, std::size_t rung, unsigned vertex, double cost,
+                           std::vector<double>& costs)
+{
+  if (rung + 1 == graph.size())
+  {
+    costs.push_back(cost);
+    return;
+  }
+  for (const auto& edge : graph.getEdges(rung)[vertex])
+    enumeratePaths(graph, rung + 1, edge.idx, cost + edge.cost, costs);
+}
+
+TEST(LadderGraph, k_shortest_paths_match_enumeration)
+{
+  std::mt19937 rng(29);
+  for (int trial = 0; trial < 20; ++trial)
+  {
+    LadderGraph graph(1);
+    makeRandomLadder(graph, 6, rng);
+
+    std::vector<double> expected;
+    for (unsigned i = 0; i < graph.rungSize(0); ++i)
+      enumeratePaths(graph, 0, i, 0.0, expected);
+    std::sort(expected.begin(), expected.end());
+
+    const std::size_t k = 25;
+    KShortestPaths search(graph);
+    const auto paths = search.run(k);
+    ASSERT_EQ(std::min(k, expected.size()), paths.size()) << "trial " << trial;
+
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+      EXPECT_EQ(expected[i], paths[i].cost) << "trial " << trial << ", path " << i;
+      EXPECT_EQ(paths[i].cost, pathCost(graph, paths[i].vertices)) << "trial " << trial << ", path " << i;
+      for (std::size_t j = 0; j < i; ++j)
+        EXPECT_NE(paths[j].vertices, paths[i].vertices) << "trial " << trial;
+    }
+
+    if (!paths.empty())
+    {
+      DAGSearch exact(graph);
+      EXPECT_EQ(exact.run(), paths.front().cost);
+    }
+  }
+}
+
+TEST(LadderGraph, k_shortest_paths_diversity)
+{
+  std::mt19937 rng(31);
+  LadderGraph graph(1);
+  makeRandomLadder(graph, 40, rng);
+
+  KShortestPaths search(graph);
+  const auto closest = search.run(2);
+  ASSERT_EQ(2u, closest.size());
+
+  const std::size_t min_differences = 10;
+  const auto paths = search.run(4, min_differences, 100000);
+  ASSERT_EQ(4u, paths.size());
+  EXPECT_EQ(closest.front().cost, paths.front().cost);
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    if (i > 0)
+    {
+      EXPECT_LE(paths[i - 1].cost, paths[i].cost);
+    }
+    for (std::size_t j = 0; j < i; ++j)
+    {
+      std::size_t differences = 0;
+      for (std::size_t r = 0; r < graph.size(); ++r)
+        differences += paths[i].vertices[r] != paths[j].vertices[r];
+      EXPECT_LE(min_differences, differences) << "paths " << j << " and " << i;
+    }
+  }
+
+  // No two paths can differ in more rungs than there are, so only the limit stops this search
+  EXPECT_EQ(1u, search.run(10, graph.size() + 1, 3).size());
+  EXPECT_EQ(3u, search.candidates());
+}
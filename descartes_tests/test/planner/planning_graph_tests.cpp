@@ -22,6 +22,7 @@
 #include <boost/make_shared.hpp>
 
 #include <gtest/gtest.h>
+#include <atomic>
 
 static boost::shared_ptr<descartes_core::RobotModel> makeTestRobot()
 {
@@ -98,6 +99,34 @@ TEST(PlanningGraph, custom_cost_fn)
   EXPECT_TRUE(graph.getShortestPath(cost, out));
 }
 
+TEST(PlanningGraph, batch_cost_fn)
+{
+  auto robot = makeTestRobot();
+  auto points = threePoints();
+
+  auto custom_cost_fn = [] (const double* a, const double* b) {
+    double cost = 0.0;
+    for (int i = 0; i < 6; ++i) cost += (i + 1) * std::abs(a[i] - b[i]);
+    return cost;
+  };
+  auto batch_cost_fn = [custom_cost_fn] (const double* start, const double* end_joints, std::size_t n_end,
+                                         double* costs) {
+    for (std::size_t j = 0; j < n_end; ++j) costs[j] = custom_cost_fn(start, end_joints + j * 6);
+  };
+
+  descartes_planner::PlanningGraph scalar_graph {robot, custom_cost_fn};
+  descartes_planner::PlanningGraph batch_graph {robot, descartes_planner::BatchCostFunction(batch_cost_fn)};
+  ASSERT_TRUE(scalar_graph.insertGraph(points));
+  ASSERT_TRUE(batch_graph.insertGraph(points));
+
+  double scalar_cost, batch_cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> out;
+  ASSERT_TRUE(scalar_graph.getShortestPath(scalar_cost, out));
+  ASSERT_TRUE(batch_graph.getShortestPath(batch_cost, out));
+  EXPECT_DOUBLE_EQ(42.0, batch_cost);
+  EXPECT_EQ(scalar_cost, batch_cost);
+}
+
 TEST(PlanningGraph, insert_then_add_point)
 {
   // Create robot
@@ -177,3 +206,220 @@ TEST(PlanningGraph, insert_then_modify_all_points)
   ASSERT_TRUE( graph.modifyTrajectory(invalid_pt) );
   EXPECT_FALSE(graph.getShortestPath(cost, out));
 }
+
+TEST(PlanningGraph, insert_graph_builds_every_edge)
+{
+  auto robot = makeTestRobot();
+
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (int i = 0; i < 300; ++i)
+    points.push_back(makePoint(0.01 * i));
+
+  // Rungs and edges are filled in whatever order the IK finishes; every pair must end up connected
+  descartes_planner::PlanningGraph graph {robot};
+  ASSERT_TRUE(graph.insertGraph(points));
+  ASSERT_EQ(points.size(), graph.graph().size());
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    EXPECT_EQ(points[i]->getID(), graph.graph().getRung(i).id);
+    EXPECT_EQ(6u, graph.graph().getRung(i).data.size());
+    EXPECT_EQ(i + 1 < points.size() ? 1u : 0u, graph.graph().getEdges(i).edges().size()) << i;
+  }
+
+  double cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> out;
+  ASSERT_TRUE(graph.getShortestPath(cost, out));
+  EXPECT_NEAR(6 * 0.01 * 299, cost, 1e-9);
+
+  // Inserting again replaces the graph
+  points.resize(10);
+  ASSERT_TRUE(graph.insertGraph(points));
+  EXPECT_EQ(10u, graph.graph().size());
+}
+
+namespace
+{
+// Counts its IK calls, optionally failing them
+class CountingPoint : public descartes_trajectory::JointTrajectoryPt
+{
+public:
+  CountingPoint(double v, double tm, bool ik_fails, std::atomic<int>& calls)
+    : descartes_trajectory::JointTrajectoryPt(std::vector<double>(6, v), descartes_core::TimingConstraint(tm))
+    , ik_fails_(ik_fails), calls_(calls)
+  {}
+
+  void getJointPoses(const descartes_core::RobotModel& model,
+                     std::vector<std::vector<double>>& joint_poses) const override
+  {
+    ++calls_;
+    if (ik_fails_) joint_poses.clear();
+    else descartes_trajectory::JointTrajectoryPt::getJointPoses(model, joint_poses);
+  }
+
+private:
+  bool ik_fails_;
+  std::atomic<int>& calls_;
+};
+}
+
+TEST(PlanningGraph, build_failure_report)
+{
+  auto robot = makeTestRobot();
+  descartes_planner::PlanningGraph graph {robot};
+  graph.setTaskPool(std::make_shared<descartes_planner::TaskPool>(1)); // in order, for a deterministic report
+
+  // A failed IK stops the build before the following points are solved
+  std::atomic<int> calls(0);
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (int i = 0; i < 20; ++i)
+    points.push_back(boost::make_shared<CountingPoint>(0.1 * i, 0.0, i == 5, calls));
+  EXPECT_FALSE(graph.insertGraph(points));
+  EXPECT_EQ(descartes_planner::BuildFailure::IK_FAILED, graph.getBuildFailure().reason);
+  EXPECT_EQ(5u, graph.getBuildFailure().rung);
+  EXPECT_EQ(points[5]->getID(), graph.getBuildFailure().id);
+  EXPECT_EQ(6, calls);
+  EXPECT_EQ(0u, graph.graph().size());
+
+  // So does a pair of points too far apart for the time between them
+  calls = 0;
+  points.clear();
+  for (int i = 0; i < 20; ++i)
+    points.push_back(boost::make_shared<CountingPoint>(i == 8 ? 100.0 : 0.1 * i, 1.0, false, calls));
+  EXPECT_FALSE(graph.insertGraph(points));
+  EXPECT_EQ(descartes_planner::BuildFailure::NO_EDGES, graph.getBuildFailure().reason);
+  EXPECT_EQ(7u, graph.getBuildFailure().rung);
+  EXPECT_EQ(9, calls);
+
+  points[8] = makePoint(0.8, 1.0);
+  EXPECT_TRUE(graph.insertGraph(points));
+  EXPECT_EQ(descartes_planner::BuildFailure::NONE, graph.getBuildFailure().reason);
+
+  EXPECT_FALSE(graph.insertGraph(std::vector<descartes_core::TrajectoryPtPtr>(1, makePoint(0.0))));
+  EXPECT_EQ(descartes_planner::BuildFailure::TOO_FEW_POINTS, graph.getBuildFailure().reason);
+}
+
+TEST(PlanningGraph, parallel_search)
+{
+  auto robot = makeTestRobot();
+
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (int i = 0; i < 40; ++i)
+    points.push_back(makePoint(0.1 * i));
+
+  descartes_planner::PlanningGraph graph {robot};
+  ASSERT_TRUE(graph.insertGraph(points));
+
+  double cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> out;
+  ASSERT_TRUE(graph.getShortestPath(cost, out));
+
+  graph.setSearchThreads(4);
+  EXPECT_EQ(4u, graph.getSearchThreads());
+
+  double parallel_cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> parallel_out;
+  ASSERT_TRUE(graph.getShortestPath(parallel_cost, parallel_out));
+  EXPECT_EQ(out.size(), parallel_out.size());
+  EXPECT_NEAR(cost, parallel_cost, 1e-9);
+}
+
+TEST(PlanningGraph, implicit_edges)
+{
+  auto robot = makeTestRobot();
+
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (int i = 0; i < 20; ++i)
+    points.push_back(makePoint(0.1 * i, i % 2 ? 1.0 : 0.0)); // mix of timed and untimed points
+
+  descartes_planner::PlanningGraph stored {robot};
+  descartes_planner::PlanningGraph implicit {robot};
+  implicit.setImplicitEdges(true);
+  ASSERT_TRUE(stored.insertGraph(points));
+  ASSERT_TRUE(implicit.insertGraph(points));
+
+  for (std::size_t i = 0; i < implicit.graph().size(); ++i)
+    EXPECT_EQ(0u, implicit.graph().getEdges(i).numEdges());
+
+  double stored_cost, implicit_cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> stored_out, implicit_out;
+  ASSERT_TRUE(stored.getShortestPath(stored_cost, stored_out));
+  ASSERT_TRUE(implicit.getShortestPath(implicit_cost, implicit_out));
+  EXPECT_EQ(stored_cost, implicit_cost);
+  EXPECT_EQ(stored_out.size(), implicit_out.size());
+
+  // An unreachable point makes both fail
+  auto invalid_pt = makePoint(100.0, 1.0);
+  invalid_pt->setID(points[5]->getID());
+  ASSERT_TRUE(stored.modifyTrajectory(invalid_pt));
+  ASSERT_TRUE(implicit.modifyTrajectory(invalid_pt));
+  EXPECT_FALSE(stored.getShortestPath(stored_cost, stored_out));
+  EXPECT_FALSE(implicit.getShortestPath(implicit_cost, implicit_out));
+
+  // Switching back rebuilds the edges
+  ASSERT_TRUE(implicit.modifyTrajectory(points[5]));
+  implicit.setImplicitEdges(false);
+  EXPECT_LT(0u, implicit.graph().getEdges(0).numEdges());
+  implicit_out.clear();
+  ASSERT_TRUE(implicit.getShortestPath(implicit_cost, implicit_out));
+  EXPECT_EQ(stored_out.size(), implicit_out.size());
+}
+
+TEST(PlanningGraph, beam_search)
+{
+  auto robot = makeTestRobot();
+
+  std::vector<descartes_core::TrajectoryPtPtr> points;
+  for (int i = 0; i < 20; ++i)
+    points.push_back(makePoint(0.1 * i));
+
+  for (bool implicit : {false, true})
+  {
+    descartes_planner::PlanningGraph graph {robot};
+    graph.setImplicitEdges(implicit);
+    ASSERT_TRUE(graph.insertGraph(points));
+
+    double exact_cost;
+    std::list<descartes_trajectory::JointTrajectoryPt> exact_out;
+    ASSERT_TRUE(graph.getShortestPath(exact_cost, exact_out));
+
+    descartes_planner::BeamParameters beam;
+    beam.width = 1;
+    graph.setBeam(beam);
+    graph.setBeamValidation(true);
+
+    double cost;
+    std::list<descartes_trajectory::JointTrajectoryPt> out;
+    ASSERT_TRUE(graph.getShortestPath(cost, out));
+    EXPECT_EQ(exact_out.size(), out.size());
+    EXPECT_EQ(exact_cost, cost); // one solution per point, nothing to prune
+
+    const auto& stats = graph.getBeamSearchStats();
+    EXPECT_EQ(1u, stats.searches);
+    EXPECT_EQ(1u, stats.validated);
+    EXPECT_EQ(0u, stats.cost_changed);
+    EXPECT_EQ(0u, stats.pruned_vertices);
+  }
+}
+
+TEST(PlanningGraph, alternative_paths)
+{
+  auto robot = makeTestRobot();
+  descartes_planner::PlanningGraph graph {robot};
+  ASSERT_TRUE(graph.insertGraph(threePoints()));
+
+  double cost;
+  std::list<descartes_trajectory::JointTrajectoryPt> out;
+  ASSERT_TRUE(graph.getShortestPath(cost, out));
+
+  // Each point has a single joint solution, so there is a single path
+  std::vector<double> costs;
+  std::vector<std::list<descartes_trajectory::JointTrajectoryPt>> paths;
+  ASSERT_TRUE(graph.getShortestPaths(5, 0, 0, costs, paths));
+  ASSERT_EQ(1u, costs.size());
+  ASSERT_EQ(1u, paths.size());
+  EXPECT_EQ(cost, costs.front());
+  EXPECT_EQ(out.size(), paths.front().size());
+
+  graph.setImplicitEdges(true);
+  EXPECT_FALSE(graph.getShortestPaths(5, 0, 0, costs, paths));
+}
@@ -0,0 +1,190 @@
+/*
+ * Software License Agreement (Apache License)
+ *
+ * Copyright (c) 2018, Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <descartes_planner/task_pool.h>
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace descartes_planner;
+
+TEST(TaskPool, runs_every_index_once)
+{
+  TaskPool pool (4);
+  for (std::size_t n : { 0, 1, 3, 4, 1000 })
+  {
+    std::vector<std::atomic<int>> calls(n);
+    for (auto& c : calls)
+      c = 0;
+    pool.parallelFor(n, [&](std::size_t i) { ++calls[i]; });
+
+    for (std::size_t i = 0; i < n; ++i)
+      EXPECT_EQ(1, calls[i]) << "index " << i << " of " << n;
+    EXPECT_EQ(n, pool.lastStats().n_tasks);
+    EXPECT_EQ(n, pool.lastStats().task_seconds.size());
+    EXPECT_EQ(4u, pool.lastStats().thread_busy_seconds.size());
+  }
+}
+
+TEST(TaskPool, balances_uneven_tasks)
+{
+  // The first quarter of the indices is far slower than the rest, so the threads starting out with the others steal
+  TaskPool pool (4);
+  const std::size_t n = 64;
+  std::vector<std::atomic<int>> calls(n);
+  for (auto& c : calls)
+    c = 0;
+  pool.parallelFor(n, [&](std::size_t i) {
+    if (i < n / 4) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    ++calls[i];
+  });
+
+  for (std::size_t i = 0; i < n; ++i)
+    EXPECT_EQ(1, calls[i]);
+  EXPECT_GT(pool.lastStats().n_steals, 0u);
+}
+
+TEST(TaskPool, nested_loops_run_serially)
+{
+  TaskPool pool (3);
+  std::vector<std::atomic<int>> calls(30);
+  for (auto& c : calls)
+    c = 0;
+  pool.parallelFor(3, [&](std::size_t i) {
+    pool.parallelFor(10, [&](std::size_t j) { ++calls[i * 10 + j]; });
+  });
+
+  for (const auto& c : calls)
+    EXPECT_EQ(1, c);
+}
+
+TEST(TaskPool, current_slot)
+{
+  TaskPool pool (3);
+  EXPECT_EQ(0u, TaskPool::currentSlot());
+
+  // Each slot runs one task at a time, nested loops included
+  std::vector<std::atomic<int>> running(pool.threads());
+  for (auto& r : running)
+    r = 0;
+  std::atomic<int> overlaps(0), out_of_range(0);
+  pool.parallelFor(60, [&](std::size_t) {
+    const unsigned slot = TaskPool::currentSlot();
+    if (slot >= pool.threads())
+    {
+      ++out_of_range;
+      return;
+    }
+    if (running[slot]++ != 0) ++overlaps;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    pool.parallelFor(2, [&](std::size_t) {
+      if (TaskPool::currentSlot() != slot) ++out_of_range;
+    });
+    --running[slot];
+  });
+  EXPECT_EQ(0, overlaps);
+  EXPECT_EQ(0, out_of_range);
+  EXPECT_EQ(0u, TaskPool::currentSlot());
+}
+
+TEST(TaskPool, rethrows_the_first_exception)
+{
+  TaskPool pool (2);
+  std::atomic<int> calls(0);
+  EXPECT_THROW(pool.parallelFor(100, [&](std::size_t i) {
+                 ++calls;
+                 if (i == 10) throw std::runtime_error("task failed");
+               }),
+               std::runtime_error);
+  EXPECT_LT(calls, 100);
+
+  // The pool is still usable afterwards
+  calls = 0;
+  pool.parallelFor(100, [&](std::size_t) { ++calls; });
+  EXPECT_EQ(100, calls);
+}
+
+TEST(TaskPool, cancellation_skips_remaining_tasks)
+{
+  // On one thread the tasks run in order, so none runs after the cancelling one
+  TaskPool serial (1);
+  CancellationToken cancel;
+  std::atomic<int> calls(0);
+  serial.parallelFor(100, [&](std::size_t i) {
+    ++calls;
+    if (i == 10) cancel.cancel();
+  }, cancel);
+  EXPECT_EQ(11, calls);
+
+  TaskPool pool (4);
+  CancellationToken cancel_all;
+  calls = 0;
+  pool.parallelFor(1000, [&](std::size_t) {
+    ++calls;
+    cancel_all.cancel();
+  }, cancel_all);
+  EXPECT_LE(calls, 4);
+}
+
+TEST(TaskPool, cancellation_deadline_and_parent)
+{
+  using Clock = CancellationToken::Clock;
+  CancellationToken passed (Clock::now());
+  EXPECT_TRUE(passed.cancelled());
+  EXPECT_TRUE(passed.expired());
+
+  CancellationToken parent;
+  CancellationToken child (Clock::now() + std::chrono::hours(1), &parent);
+  EXPECT_FALSE(child.cancelled());
+  EXPECT_FALSE(child.expired());
+
+  // Cancelling the parent cancels the child, but not the other way around
+  parent.cancel();
+  EXPECT_TRUE(child.cancelled());
+  EXPECT_FALSE(child.expired());
+
+  CancellationToken other_parent;
+  CancellationToken linked (&other_parent), expired_child (Clock::now(), &linked);
+  expired_child.cancel();
+  EXPECT_FALSE(linked.cancelled());
+  EXPECT_FALSE(other_parent.cancelled());
+
+  // A parent's deadline reaches its children
+  CancellationToken grandchild (&passed);
+  EXPECT_TRUE(grandchild.expired());
+}
+
+TEST(TaskPool, parse_cpu_list)
+{
+  std::vector<int> cpus;
+  EXPECT_TRUE(parseCpuList("", cpus));
+  EXPECT_TRUE(cpus.empty());
+  EXPECT_TRUE(parseCpuList("0,2,4-7", cpus));
+  EXPECT_EQ(std::vector<int>({ 0, 2, 4, 5, 6, 7 }), cpus);
+  EXPECT_TRUE(parseCpuList("3", cpus));
+  EXPECT_EQ(std::vector<int>({ 3 }), cpus);
+
+  EXPECT_FALSE(parseCpuList("1-", cpus));
+  EXPECT_FALSE(parseCpuList("4-2", cpus));
+  EXPECT_FALSE(parseCpuList("-1", cpus));
+  EXPECT_FALSE(parseCpuList("1,,2", cpus));
+  EXPECT_FALSE(parseCpuList("1x", cpus));
+}